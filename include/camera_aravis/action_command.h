@@ -0,0 +1,94 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_ACTION_COMMAND
+#define CAMERA_ARAVIS_ACTION_COMMAND
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// GigE Vision action command, devices fire the action selected by matching keys and mask.
+struct ActionCommand
+{
+  uint32_t device_key = 0;   // must equal ActionDeviceKey of the device
+  uint32_t group_key = 0;    // must equal ActionGroupKey of the action
+  uint32_t group_mask = 0;   // must share a bit with ActionGroupMask of the action
+  bool scheduled = false;    // fire at action_time instead of on reception
+  uint64_t action_time = 0;  // device timestamp ticks, ns if the device runs PTP
+  bool acknowledge = false;  // ask devices for ACTION_ACK
+};
+
+// Plain copy of sender counters taken at diagnostics update time.
+struct ActionCommandStatisticsSample
+{
+  uint64_t n_sent = 0;
+  uint64_t n_failed = 0;
+};
+
+// Build the GVCP ACTION_CMD packet, without sockets so it can be checked against a fake device.
+std::vector<uint8_t> buildActionCommandPacket(const ActionCommand &command, uint16_t request_id);
+
+// Current time of the host clock that ptp4l/phc2sys keep in step with the devices (TAI, ns).
+uint64_t actionCommandPtpNow();
+
+// Sends action commands on the GVCP port as one broadcast (or unicast) datagram.
+//
+// A single datagram reaches every device on the subnet at once, which removes the per camera
+// command latency of TriggerSoftware. Commands are sent without waiting for acknowledges.
+class ActionCommandSender
+{
+public:
+  // interface_address selects the outgoing interface, empty for the default route
+  ActionCommandSender(const std::string &destination, const std::string &interface_address, uint16_t port = 3956);
+  ~ActionCommandSender();
+
+  ActionCommandSender(const ActionCommandSender &) = delete;
+  ActionCommandSender &operator=(const ActionCommandSender &) = delete;
+
+  // Create socket, false on failure.
+  bool open();
+  bool send(const ActionCommand &command);
+
+  ActionCommandStatisticsSample sample() const;
+
+private:
+  const std::string destination_;
+  const std::string interface_address_;
+  const uint16_t port_;
+
+  int socket_ = -1;
+  uint16_t request_id_ = 0;
+
+  std::atomic<uint64_t> n_sent_{0};
+  std::atomic<uint64_t> n_failed_{0};
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_ACTION_COMMAND */
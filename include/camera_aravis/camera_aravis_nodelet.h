@@ -41,11 +41,13 @@ extern "C" {
 #include <thread>
 #include <condition_variable>
 #include <chrono>
+#include <fstream>
 #include <unordered_map>
 
 #include <glib.h>
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <nodelet/nodelet.h>
 #include <nodelet/NodeletUnload.h>
 #include <ros/time.h>
@@ -58,12 +60,14 @@ extern "C" {
 
 #include <dynamic_reconfigure/server.h>
 #include <dynamic_reconfigure/SensorLevels.h>
+#include <diagnostic_updater/diagnostic_updater.h>
 #include <tf/transform_listener.h>
 #include <tf2_ros/static_transform_broadcaster.h>
 #include <tf2_ros/transform_broadcaster.h>
 #include <camera_aravis/CameraAravisConfig.h>
 #include <camera_aravis/CameraAutoInfo.h>
 #include <camera_aravis/ExtendedCameraInfo.h>
+#include <camera_aravis/FrameLatency.h>
 
 #include <camera_aravis/get_integer_feature_value.h>
 #include <camera_aravis/set_integer_feature_value.h>
@@ -73,9 +77,27 @@ extern "C" {
 #include <camera_aravis/set_string_feature_value.h>
 #include <camera_aravis/get_boolean_feature_value.h>
 #include <camera_aravis/set_boolean_feature_value.h>
+#include <camera_aravis/CapturePixelCorrection.h>
+#include <camera_aravis/FreezePreTrigger.h>
+#include <camera_aravis/GetFeatures.h>
+#include <camera_aravis/SetFeatures.h>
 
 #include <camera_aravis/camera_buffer_pool.h>
 #include <camera_aravis/conversion_utils.h>
+#include <camera_aravis/stream_statistics.h>
+#include <camera_aravis/frame_trace.h>
+#include <camera_aravis/sub_image.h>
+#include <camera_aravis/tone_mapping.h>
+#include <camera_aravis/pixel_correction.h>
+#include <camera_aravis/rectification.h>
+#include <camera_aravis/compression_workers.h>
+#include <camera_aravis/frame_recorder.h>
+#include <camera_aravis/frame_ring.h>
+#include <camera_aravis/recording_reader.h>
+#include <camera_aravis/gvsp_receiver.h>
+#include <camera_aravis/action_command.h>
+#include <camera_aravis/trigger_scheduler.h>
+#include <camera_aravis/control_channel.h>
 
 namespace camera_aravis
 {
@@ -97,6 +119,11 @@ private:
   ArvCamera *p_camera_ = NULL;
   ArvDevice *p_device_ = NULL;
 
+  // all feature access of the device is serialized here, by priority
+  std::unique_ptr<ControlChannel> control_channel_;
+  // telemetry reads repeated within this window are answered from the previous read, 0 disables
+  double control_coalesce_ms_ = 5.0;
+
   struct Sensor
   {
     int32_t width = 0;
@@ -117,6 +144,24 @@ private:
     int32_t height_max = 0;
   };
 
+  // named region of converted image, published as view into image without copy
+  struct SoftwareROI
+  {
+    std::string name;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+
+    ros::Publisher image_pub;
+    ros::Publisher camera_info_pub;
+
+    bool hasSubscribers() const
+    {
+      return image_pub.getNumSubscribers() > 0 || camera_info_pub.getNumSubscribers() > 0;
+    }
+  };
+
   // logically single kind of data (image/image chunk/image in multipart/depth map/...)
   struct Substream
   {
@@ -126,9 +171,48 @@ private:
     std::string frame_id;
     //pool for multipart path where images don't map 1:1 to aravis buffers
     CameraBufferPool::Ptr p_buffer_pool;
+    //pixel_format_internal override or GenICam pixel format, selects convert_format
+    std::string internal_pixel_format;
     ConversionFunction convert_format;
-
+    //conversion only relabels encoding, no pixel work
+    bool rename_only = false;
+    //conversion overwrites input image
+    bool convert_in_place = false;
+    //optional demosaicing of Bayer images after convert_format
+    ConversionFunction demosaic;
+    //16 to 8 bit mapping of converted image for display output
+    std::unique_ptr<ToneMapper> tone_mapper;
+    //native packed format straight to 8 bit display image, if available
+    ConversionFunction tone_map_native;
+    //dark, flat-field and defective pixel correction of mono/Bayer images, null for other formats
+    std::unique_ptr<PixelCorrection> pixel_correction;
+    std::string pixel_correction_file;
+    //correct native 8/16 bit container before conversion, otherwise converted image
+    bool correct_native = false;
+    bool correct_bayer = false;
+    uint32_t correction_max_value = 0xFFFF;
+    //remap tables of current calibration for rectified output
+    Rectifier rectifier;
+
+    //converted (image_raw), camera native (native/image_raw) and downscaled 8 bit (preview/image_raw) outputs
     image_transport::CameraPublisher cam_pub;
+    image_transport::CameraPublisher native_pub;
+    image_transport::CameraPublisher preview_pub;
+    //8 bit tone mapped image for visualization (display/image_raw)
+    image_transport::CameraPublisher display_pub;
+    //software binned levels of converted image, level i is downscaled by 2^(i+1) (bin<2^(i+1)>/image_raw)
+    std::vector<image_transport::CameraPublisher> pyramid_pubs;
+    //undistorted and rectified converted image (rect/image_rect)
+    image_transport::CameraPublisher rect_pub;
+    //converted image compressed by worker pool (encoded/compressed)
+    ros::Publisher compressed_pub;
+    //raw payloads written by frame recorder, substream index in recording
+    bool recorded = false;
+    uint32_t record_index = 0;
+    //last native frames kept for freeze_pre_trigger, null if disabled
+    std::unique_ptr<FrameRing> frame_ring;
+    //software ROIs of converted image (roi/<name>/image_raw)
+    std::vector<SoftwareROI> software_rois;
     std::unique_ptr<camera_info_manager::CameraInfoManager> p_camera_info_manager;
     std::unique_ptr<ros::NodeHandle> p_camera_info_node_handle;
     sensor_msgs::CameraInfoPtr camera_info;
@@ -136,12 +220,55 @@ private:
 
     std::thread buffer_thread;
     bool buffer_thread_stop;
+    //held while substream thread or inline publishing processes a frame, they never overlap
+    std::mutex processing_mutex;
     std::mutex buffer_data_mutex;
     std::condition_variable buffer_ready_condition;
 
     //ROS image wrapping around aravis buffer data and correspoding aravis buffer
     sensor_msgs::ImagePtr p_buffer_image;
     ArvBuffer *p_buffer;
+    uint64_t p_buffer_delegate_ns;
+
+    SubstreamStatistics statistics;
+    //previous diagnostics sample, accessed only from diagnostics timer
+    SubstreamStatisticsSample last_statistics;
+
+    //filled by substream thread, drained by trace timer
+    FrameTraceRing trace_ring;
+    FrameTraceStatistics trace_statistics;
+    ros::Publisher latency_pub;
+
+    //any output of substream subscribed
+    bool hasSubscribers() const
+    {
+      return cam_pub.getNumSubscribers() > 0 || native_pub.getNumSubscribers() > 0 ||
+             preview_pub.getNumSubscribers() > 0 || display_pub.getNumSubscribers() > 0 ||
+             rect_pub.getNumSubscribers() > 0 || compressed_pub.getNumSubscribers() > 0 ||
+             pyramidLevels() > 0 || softwareROISubscribed() || recorded ||
+             frame_ring || capturingCorrection();
+    }
+
+    //pixel correction map capture consumes frames without any subscriber
+    bool capturingCorrection() const
+    {
+      return pixel_correction && pixel_correction->capturing();
+    }
+
+    bool softwareROISubscribed() const
+    {
+      return std::any_of(software_rois.begin(), software_rois.end(),
+                         [](const SoftwareROI &roi) { return roi.hasSubscribers(); });
+    }
+
+    //number of pyramid levels to compute, up to deepest subscribed level
+    size_t pyramidLevels() const
+    {
+      for (size_t i = pyramid_pubs.size(); i > 0; --i)
+        if (pyramid_pubs[i - 1].getNumSubscribers() > 0)
+          return i;
+      return 0;
+    }
   };
 
   // a single stream may transfer multiple substreams (multipart/chunked data)
@@ -153,27 +280,131 @@ private:
     // typical image-like data or multipart/chunk with image-like data
     // each stream has at least 1 substream
     std::vector<Substream> substreams;
+
+    //previous diagnostics sample, accessed only from diagnostics timer
+    StreamStatisticsSample last_statistics;
+
+    //frame id continuity and loss reasons, heap allocated as Stream is moved
+    std::unique_ptr<FrameLossStatistics> frame_loss;
+    FrameLossSample last_frame_loss;
+
+    //pops buffers from aravis in pop delivery mode
+    std::thread delivery_thread;
+
+    //receives multicast stream channel instead of aravis stream
+    std::unique_ptr<GvspReceiver> gvsp_receiver;
   };
 
   std::vector<Stream> streams_;
 
   int32_t acquire_ = 0;
 
+  // aravis buffers queued per stream, in USB3 Vision async mode this is also transfers in flight
+  int32_t stream_buffer_count_ = 10;
+  // if set, derive buffer count from memory budget and payload size
+  double stream_buffer_memory_mb_ = 0.0;
+
+  // buffer delivery through aravis "new-buffer" signal (default) or dedicated thread per stream popping buffers
+  bool pop_buffer_delivery_ = false;
+  // in pop delivery mode process buffers in delivery thread instead of substream threads
+  bool process_inline_ = false;
+  // per stream CPU of pop delivery thread, -1 for no pinning
+  std::vector<int> delivery_cpus_;
+  std::atomic<bool> delivery_active_{false};
+  // publish rename-only image payloads directly from delivery thread
+  bool publish_inline_ = false;
+
+  // in-driver demosaicing of Bayer pixel formats: none, bilinear, edge_aware
+  std::string demosaic_ = "none";
+  // output encoding of demosaicing: rgb8, bgr8, rgb16, bgr16
+  std::string demosaic_encoding_ = sensor_msgs::image_encodings::BGR8;
+
+  // image_preview width and height divisor
+  int32_t preview_downscale_ = 4;
+  // number of software binned pyramid levels of converted image (2x, 4x, ...)
+  int32_t pyramid_levels_ = 0;
+
+  // display/image_raw tone mapping window, gamma and auto range
+  ToneMapper::Parameters tone_mapping_;
+
+  // encoded/compressed codecs and worker pool shared by all substreams, 0 threads disables
+  CodecParameters codec_params_;
+  int32_t compression_threads_ = 2;
+  std::unique_ptr<CompressionWorkers> compression_workers_;
+  // previous diagnostics sample, accessed only from diagnostics timer
+  CompressionStatisticsSample last_compression_statistics_;
+  int64_t last_compression_stamp_ns_ = 0;
+
+  // raw frame recording of all substreams to timestamped subdirectory of record_directory, if set
+  std::unique_ptr<FrameRecorder> frame_recorder_;
+  // previous diagnostics sample, accessed only from diagnostics timer
+  FrameRecorderStatisticsSample last_recorder_statistics_;
+  int64_t last_recorder_stamp_ns_ = 0;
+
+  // pre-trigger rings of all substreams, 0 seconds disables
+  double pre_trigger_seconds_ = 0.0;
+  size_t pre_trigger_bytes_ = 0;
+  std::string pre_trigger_directory_ = "pre_trigger";
+  // frozen rings being written in background, closed on next freeze or shutdown
+  std::mutex pre_trigger_mutex_;
+  std::vector<std::unique_ptr<FrameRecorder>> pre_trigger_flushes_;
+
+  // replay of recording instead of camera, each recorded substream becomes a single image stream
+  std::unique_ptr<RecordingReader> replay_reader_;
+  // playback speed relative to recorded stamps, 0 replays as fast as possible
+  double replay_rate_ = 1.0;
+  bool replay_loop_ = false;
+  // stamp replayed frames with current time instead of recorded stamps
+  bool replay_restamp_ = true;
+  std::atomic<bool> replay_active_{false};
+  std::thread replay_thread_;
+
+  // GigE Vision stream channels sent to multicast group, channel i uses multicast_port_ + i
+  std::string multicast_address_;
+  // host interface joining the group, empty lets the kernel choose by route
+  std::string multicast_interface_;
+  int32_t multicast_port_ = 20202;
+  // read-only instance receiving the multicast stream of another controlling driver
+  bool monitor_ = false;
+
+  // GigE Vision action command triggering, the master broadcasts one command for all cameras
+  ActionCommand action_command_;
+  // schedule action at PTP now + lead, 0 fires on reception
+  double action_schedule_lead_ms_ = 0.0;
+  std::unique_ptr<ActionCommandSender> action_sender_;
+  ActionCommandStatisticsSample last_action_statistics_;
+  int64_t last_action_stamp_ns_ = 0;
+
   virtual void onInit() override;
   std::vector<std::vector<std::string>> getFrameIds(const std::vector<std::vector<std::string>> &substream_names) const;
   void connectToCamera();
   int discoverStreams(size_t stream_names_size);
   void disableComponents();
   void initPixelFormats();
+  void initConversions(Substream &substream, const std::string &pixel_format);
+  void initReplay(const std::string &directory);
+  void initMonitor(const std::vector<std::vector<std::string>> &substream_names,
+                   const std::vector<std::vector<std::string>> &frame_ids);
+  bool initMulticast(size_t stream_id);
   void getBounds();
   void setUSBMode();
+  size_t streamBufferCount(size_t n_bytes_payload) const;
   void setCameraSettings();
   void readCameraSettings();
   void initCalibration();
   void printCameraInfo();
+  std::vector<RecordedSubstream> recordedSubstreams() const;
+  void initActionTrigger();
+  void initRecorder();
+  void initPreTrigger();
 
   void spawnStream();
 
+  void initDiagnostics();
+  void initTracing();
+  void initSoftwareROIs(Substream &substream, const std::string &topic_name,
+                        const ros::SubscriberStatusCallback &status_cb);
+
 protected:
   // reset PTP clock
   void resetPtpClock();
@@ -195,22 +426,48 @@ protected:
 
   // Start and stop camera on demand
   void rosConnectCallback();
+  bool anySubscribers() const;
 
   // Callback to wrap and send recorded image as ROS message
   static void newBufferReadyCallback(ArvStream *p_stream, gpointer can_instance);
 
-  // Buffer Callback Helper
-  void newBufferReady(ArvStream *p_stream, size_t stream_id);
+  // Pop delivery mode thread, loops on timed buffer pop
+  void deliveryThreadMain(const int stream_id);
+
+  // Replay mode thread, injects recorded frames in place of aravis buffers
+  void replayThreadMain();
+
+  // Multicast receiver callback, injects reassembled frame in place of aravis buffer
+  void multicastFrameReady(size_t stream_id, GvspFrame &frame);
+
+  // Buffer Callback Helper, takes ownership of popped p_buffer (may be null)
+  void newBufferReady(ArvStream *p_stream, ArvBuffer *p_buffer, size_t stream_id);
+
+  // publish current lighting settings if this camera is configured as master
+  void publishAutoParameters();
 
   // Delegate validated buffer to substream(s) thread(s)
   void delegateBuffer(ArvBuffer *p_buffer, size_t stream_id);
-  void delegateBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substreams);
+  void delegateBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substreams, bool process_inline);
+  // Frame needs only relabeling and publishing, cheap enough for the delivering thread
+  bool publishInline(const Substream &substream) const;
+  // Hand off image to substream(s), p_buffer is null for replayed and multicast received images
+  void delegateImage(ArvBuffer *p_buffer, const sensor_msgs::ImagePtr &msg_ptr, size_t stream_id,
+                     size_t substreams, bool process_inline);
   void delegateChunkDataBuffer(ArvBuffer *p_buffer, size_t stream_id);
 
   void substreamThreadMain(const int stream_id, const int substream_id);
 
-  void processImageBuffer(ArvBuffer *p_buffer, size_t stream_id, sensor_msgs::ImagePtr &msg_ptr);
-  void processPartBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id);
+  // Process buffer for substream, record statistics and trace
+  void processBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id,
+                     sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace);
+  void processImageBuffer(ArvBuffer *p_buffer, size_t stream_id, sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace);
+  void processPartBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id, FrameTrace &trace);
+  void processFilledImage(size_t stream_id, sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace);
+  void publishImage(Substream &substream, const CameraBufferPool::Ptr &p_pool, sensor_msgs::ImagePtr &msg_ptr,
+                    const ROI &roi, FrameTrace &trace);
+  void correctPixels(Substream &substream, const CameraBufferPool::Ptr &p_pool, sensor_msgs::ImagePtr &msg_ptr);
+  void recordFrame(const Substream &substream, const sensor_msgs::ImagePtr &msg_ptr, const ROI &roi);
 
   void adaptROI(ArvBuffer *p_buffer, ROI &roi, size_t stream_id = 0, size_t substream_id = 0);
   void fillImage(const sensor_msgs::ImagePtr &msg_ptr, ArvBuffer *p_buffer,
@@ -218,6 +475,17 @@ protected:
   void fillCameraInfo(Substream &substream, const std_msgs::Header &header, const ROI &roi);
   void publishExtendedCameraInfo(const Substream &substream,  size_t stream_id);
 
+  // Periodic stream statistics on /diagnostics
+  void diagnosticTimerCallback(const ros::TimerEvent &event);
+  void produceStreamDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat, size_t stream_id);
+  void produceCompressionDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+  void produceRecorderDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+  void produceActionDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+  void produceControlDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+
+  // Drain frame traces into latency histograms, publish and optionally dump them
+  void traceTimerCallback(const ros::TimerEvent &event);
+
   // Clean-up if aravis device is lost
   static void controlLostCallback(ArvDevice *p_gv_device, gpointer can_instance);
 
@@ -246,8 +514,32 @@ protected:
   ros::ServiceServer set_boolean_service_;
   bool setBooleanFeatureCallback(camera_aravis::set_boolean_feature_value::Request& request, camera_aravis::set_boolean_feature_value::Response& response);
 
-  // triggers a shot at regular intervals, sleeps in between
-  void softwareTriggerLoop();
+  // typed feature lists in a single call and control transaction, e.g. recipe switches
+  ros::ServiceServer get_features_service_;
+  bool getFeaturesCallback(camera_aravis::GetFeatures::Request& request, camera_aravis::GetFeatures::Response& response);
+
+  ros::ServiceServer set_features_service_;
+  bool setFeaturesCallback(camera_aravis::SetFeatures::Request& request, camera_aravis::SetFeatures::Response& response);
+
+  // read or write a single feature of a batch, error holds aravis message on failure
+  bool readFeature(camera_aravis::FeatureValue& value, std::string& error);
+  bool writeFeature(const camera_aravis::FeatureValue& value, std::string& error);
+
+  // averages frames into dark or flat map of substream and saves maps to its pixel correction file
+  // served by own spinner, capture waits for frames and would stall nodelet callback queue
+  ros::CallbackQueue capture_queue_;
+  std::unique_ptr<ros::AsyncSpinner> capture_spinner_;
+  ros::ServiceServer capture_pixel_correction_service_;
+  bool capturePixelCorrectionCallback(camera_aravis::CapturePixelCorrection::Request& request, camera_aravis::CapturePixelCorrection::Response& response);
+
+  ros::ServiceServer freeze_pre_trigger_service_;
+  bool freezePreTriggerCallback(camera_aravis::FreezePreTrigger::Request& request, camera_aravis::FreezePreTrigger::Response& response);
+
+  // trigger scheduler tick, TriggerSoftware if subscribed
+  // with action, broadcasts an action command for all cameras instead
+  void fireTrigger(bool action);
+  void startTrigger(bool action);
+  void produceTriggerDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
 
   void discoverFeatures();
 
@@ -274,6 +566,20 @@ protected:
 
   boost::recursive_mutex extended_camera_info_mutex_;
 
+  // diagnostics publishing rate in Hz, 0 disables
+  double diagnostic_rate_ = 1.0;
+  std::unique_ptr<diagnostic_updater::Updater> diagnostic_updater_;
+  ros::Timer diagnostic_timer_;
+
+  // per-stage latency tracing, switched at runtime by TraceLatency
+  std::atomic<bool> trace_latency_{false};
+  // pixel correction, switched at runtime by PixelCorrection
+  std::atomic<bool> pixel_correction_enabled_{false};
+  double trace_rate_ = 1.0;
+  std::string trace_file_;
+  std::ofstream trace_file_stream_;
+  ros::Timer trace_timer_;
+
   Config config_;
   Config config_min_;
   Config config_max_;
@@ -281,8 +587,15 @@ protected:
   std::atomic<bool> spawning_;
   std::thread       spawn_stream_thread_;
 
-  std::thread software_trigger_thread_;
-  std::atomic_bool software_trigger_active_;
+  // software or action trigger, exists while TriggerMode is On with either source
+  std::unique_ptr<TriggerScheduler> trigger_scheduler_;
+  // busy wait before trigger deadlines instead of sleeping, 0 only sleeps
+  int32_t trigger_spin_us_ = 0;
+  // SCHED_FIFO priority of trigger thread, 0 keeps normal scheduling
+  int32_t trigger_priority_ = 0;
+  uint64_t last_trigger_skipped_ = 0;
+  // any substream has subscribers, updated on (un)subscribe instead of per trigger
+  std::atomic<bool> subscribed_{false};
 
   std::unordered_map<std::string, const bool> implemented_features_;
 
@@ -0,0 +1,123 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_COMPRESSION_WORKERS
+#define CAMERA_ARAVIS_COMPRESSION_WORKERS
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CompressedImage.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include <camera_aravis/image_codecs.h>
+
+namespace camera_aravis
+{
+
+// Plain copy of compression counters taken at diagnostics update time.
+struct CompressionStatisticsSample
+{
+  uint64_t n_compressed = 0;
+  uint64_t n_dropped = 0;
+  uint64_t n_failed = 0;
+  uint64_t input_bytes = 0;
+  uint64_t output_bytes = 0;
+  // summed over workers
+  uint64_t compression_ns = 0;
+};
+
+// Bounded pool of threads compressing images and publishing sensor_msgs/CompressedImage.
+//
+// Images are queued by shared pointer, so pooled buffers are compressed in place and
+// return to their pool once compressed. Queue is bounded, frames are dropped when all
+// workers are busy and queue is full, keeping back-pressure off the acquisition path.
+// Workers finish out of order, each publisher still publishes in the order frames were pushed.
+class CompressionWorkers
+{
+public:
+  CompressionWorkers(const CodecParameters &params, size_t n_threads, size_t queue_size);
+  // waits until queued frames are published
+  ~CompressionWorkers();
+
+  // false if queue is full and frame was dropped
+  bool push(const sensor_msgs::ImageConstPtr &image, const ros::Publisher &publisher);
+
+  CompressionStatisticsSample sample() const;
+  size_t size() const { return workers_.size(); }
+
+private:
+  // compressed frames of a publisher waiting for earlier frames still in work
+  struct PublishOrder
+  {
+    uint64_t n_pushed = 0;
+    uint64_t n_released = 0;
+    // null for failed frames, they only advance the order
+    std::map<uint64_t, sensor_msgs::CompressedImagePtr> done;
+    // a worker is publishing released frames
+    bool publishing = false;
+  };
+
+  struct Job
+  {
+    sensor_msgs::ImageConstPtr image;
+    ros::Publisher publisher;
+    PublishOrder *order;
+    uint64_t seq;
+  };
+
+  void workerMain();
+  // publishes done frames of job's publisher in order, unless another worker does already
+  void release(const Job &job, const sensor_msgs::CompressedImagePtr &compressed);
+
+  const CodecParameters params_;
+  const size_t queue_size_;
+
+  std::mutex mutex_;
+  std::condition_variable job_ready_;
+  std::deque<Job> jobs_;
+  // by topic, entries are kept for node lifetime
+  std::map<std::string, PublishOrder> orders_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+
+  std::atomic<uint64_t> n_compressed_{0};
+  std::atomic<uint64_t> n_dropped_{0};
+  std::atomic<uint64_t> n_failed_{0};
+  std::atomic<uint64_t> input_bytes_{0};
+  std::atomic<uint64_t> output_bytes_{0};
+  std::atomic<uint64_t> compression_ns_{0};
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_COMPRESSION_WORKERS */
@@ -0,0 +1,164 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_CONTROL_CHANNEL
+#define CAMERA_ARAVIS_CONTROL_CHANNEL
+
+#include <camera_aravis/frame_trace.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Classes of control channel traffic, lower value is served first.
+enum ControlPriority
+{
+  CONTROL_PRIORITY_TRIGGER = 0, // TriggerSoftware of the trigger thread
+  CONTROL_PRIORITY_RECONFIGURE, // dynamic_reconfigure, set services, auto slave, initialization
+  CONTROL_PRIORITY_TELEMETRY,   // auto master, extended camera info, PTP status, get services
+  CONTROL_PRIORITY_COUNT
+};
+
+const char* controlPriorityName(ControlPriority priority);
+
+// Plain copy of channel counters taken at diagnostics update time.
+struct ControlChannelStatisticsSample
+{
+  std::array<uint64_t, CONTROL_PRIORITY_COUNT> n_transactions{};
+  // wait for the channel since previous sample
+  std::array<uint64_t, CONTROL_PRIORITY_COUNT> queue_p50_ns{};
+  std::array<uint64_t, CONTROL_PRIORITY_COUNT> queue_p99_ns{};
+  std::array<uint64_t, CONTROL_PRIORITY_COUNT> queue_max_ns{};
+  uint64_t n_reads = 0;
+  // telemetry reads answered from recent reads instead of the device
+  uint64_t n_coalesced = 0;
+};
+
+// Serializes GenICam access of one device across all threads.
+//
+// Threads are granted the channel one transaction at a time, waiting transactions are served by
+// priority and in arrival order within a priority. The granted thread runs its own transaction, a
+// thread can nest transactions. A transaction never preempts a running one, a trigger waits for the
+// feature access in progress at most. Telemetry reads repeated within the coalescing window return
+// the previous value. Cached values are keyed by feature and the selectors written so far, other
+// writes drop the cache.
+//
+// Device handles are attached to their channel, so the aravis wrappers find it without threading it
+// through every call.
+class ControlChannel
+{
+public:
+  // a value cached by read coalescing, only the member of the read type is used
+  struct Value
+  {
+    int64_t integer = 0;
+    double real = 0.0;
+    bool boolean = false;
+    std::string text;
+  };
+
+  explicit ControlChannel(uint64_t coalesce_window_ns);
+  ~ControlChannel();
+
+  ControlChannel(const ControlChannel &) = delete;
+  ControlChannel &operator=(const ControlChannel &) = delete;
+
+  // make handle (ArvCamera, ArvDevice) resolve to this channel
+  void attach(const void *handle);
+  // null if handle is not attached
+  static ControlChannel *find(const void *handle);
+
+  // blocks until granted, recursive for the owning thread
+  void acquire(ControlPriority priority);
+  void release();
+
+  // must hold the channel, false if read has to go to the device (always outside telemetry)
+  bool cachedRead(const std::string &feature, Value &value);
+  void storeRead(const std::string &feature, const Value &value);
+  // must hold the channel, tracks selector state and drops cached reads
+  void wrote(const std::string &feature, const std::string &value);
+
+  ControlChannelStatisticsSample sample();
+
+private:
+  std::string cacheKey(const std::string &feature) const;
+
+  const uint64_t coalesce_window_ns_;
+  std::vector<const void*> handles_;
+
+  std::mutex mutex_;
+  std::condition_variable granted_;
+  std::thread::id owner_;
+  int depth_ = 0;
+  uint64_t next_ticket_ = 0;
+  // (priority, ticket) of waiting transactions, begin() is served next
+  std::set<std::pair<int, uint64_t>> waiting_;
+
+  // owning thread only
+  std::map<std::string, std::string> selectors_;
+  std::map<std::string, std::pair<uint64_t, Value>> reads_;
+
+  // guarded by mutex_
+  std::array<uint64_t, CONTROL_PRIORITY_COUNT> n_transactions_{};
+  std::array<LatencyHistogram, CONTROL_PRIORITY_COUNT> queue_delay_;
+
+  std::atomic<uint64_t> n_reads_{0};
+  std::atomic<uint64_t> n_coalesced_{0};
+};
+
+// Holds the control channel for its scope, sets the priority of nested accesses of this thread.
+//
+// Without priority it inherits the priority of an enclosing transaction, or reconfigure. Null
+// channel (replay, before connecting) makes it a no-op.
+class ControlTransaction
+{
+public:
+  explicit ControlTransaction(ControlChannel *channel);
+  ControlTransaction(ControlChannel *channel, ControlPriority priority);
+  ~ControlTransaction();
+
+  ControlTransaction(const ControlTransaction &) = delete;
+  ControlTransaction &operator=(const ControlTransaction &) = delete;
+
+  static ControlPriority currentPriority();
+
+private:
+  ControlChannel *channel_;
+  ControlPriority previous_priority_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_CONTROL_CHANNEL */
@@ -52,71 +52,98 @@ void unpack12pImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const s
 void unpack12PackedImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const std::string out_format);
 void unpack565pImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const std::string out_format);
 
+// Demosaicing of 8/16 bit Bayer ROS images to rgb8/bgr8/rgb16/bgr16, bilinear or edge aware
+void demosaicImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const bool edge_aware, const std::string out_format);
+
+// Downscaled 8 bit preview (mono8/rgb8/bgr8/rgba8/bgra8) of 8/16 bit ROS images, Bayer is demosaiced.
+// Output is reset if input encoding has no preview.
+void previewImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const size_t downscale);
+
+// Half resolution of ROS image by 2x2 box filter (pyramid level), Bayer and YUV are not supported.
+// Output is reset if input encoding can't be downscaled.
+void pyrDownImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out);
+
+// OpenCV type of ROS encoding which can be filtered pixel by pixel, -1 otherwise (Bayer, YUV, ...)
+int filterableCvType(const std::string &encoding);
+
 // Non GenICam/GigE-Vision pixel formats ovverides used with `pixel_format_internal`
 //// Data adapters
 void float_to_uint(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const float scale, const std::string out_format);
 //// Quirk pixel formats that are not defined in GenICam/GigE-Vision and come disguised as other format
 void photoneoYCoCgR420(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const std::string out_format);
 
-const std::map<std::string, ConversionFunction> CONVERSIONS_DICTIONARY =
+// Pixel formats equivalent to ROS encodings.
+// Conversion only relabels the encoding of the input image, pixel data is untouched.
+const std::map<std::string, std::string> RENAME_DICTIONARY =
 {
  // equivalent to official ROS color encodings
- { "RGB8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::RGB8) },
- { "RGBa8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::RGBA8) },
- { "RGB16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::RGB16) },
- { "RGBa16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::RGBA16) },
- { "BGR8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BGR8) },
- { "BGRa8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BGRA8) },
- { "BGR16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BGR16) },
- { "BGRa16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BGRA16) },
- { "Mono8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO8) },
- { "Raw8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO8) },
- { "R8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO8) },
- { "G8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO8) },
- { "B8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO8) },
- { "Mono16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO16) },
- { "Raw16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO16) },
- { "R16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO16) },
- { "G16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO16) },
- { "B16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::MONO16) },
- { "BayerRG8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_RGGB8) },
- { "BayerBG8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_BGGR8) },
- { "BayerGB8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GBRG8) },
- { "BayerGR8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GRBG8) },
- { "BayerRG16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_RGGB16) },
- { "BayerBG16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_BGGR16) },
- { "BayerGB16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GBRG16) },
- { "BayerGR16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GRBG16) },
- { "YUV422_8_UYVY", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::YUV422) },
- { "YUV422_8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::YUV422) },
+ { "RGB8", sensor_msgs::image_encodings::RGB8 },
+ { "RGBa8", sensor_msgs::image_encodings::RGBA8 },
+ { "RGB16", sensor_msgs::image_encodings::RGB16 },
+ { "RGBa16", sensor_msgs::image_encodings::RGBA16 },
+ { "BGR8", sensor_msgs::image_encodings::BGR8 },
+ { "BGRa8", sensor_msgs::image_encodings::BGRA8 },
+ { "BGR16", sensor_msgs::image_encodings::BGR16 },
+ { "BGRa16", sensor_msgs::image_encodings::BGRA16 },
+ { "Mono8", sensor_msgs::image_encodings::MONO8 },
+ { "Raw8", sensor_msgs::image_encodings::MONO8 },
+ { "R8", sensor_msgs::image_encodings::MONO8 },
+ { "G8", sensor_msgs::image_encodings::MONO8 },
+ { "B8", sensor_msgs::image_encodings::MONO8 },
+ { "Mono16", sensor_msgs::image_encodings::MONO16 },
+ { "Raw16", sensor_msgs::image_encodings::MONO16 },
+ { "R16", sensor_msgs::image_encodings::MONO16 },
+ { "G16", sensor_msgs::image_encodings::MONO16 },
+ { "B16", sensor_msgs::image_encodings::MONO16 },
+ { "BayerRG8", sensor_msgs::image_encodings::BAYER_RGGB8 },
+ { "BayerBG8", sensor_msgs::image_encodings::BAYER_BGGR8 },
+ { "BayerGB8", sensor_msgs::image_encodings::BAYER_GBRG8 },
+ { "BayerGR8", sensor_msgs::image_encodings::BAYER_GRBG8 },
+ { "BayerRG16", sensor_msgs::image_encodings::BAYER_RGGB16 },
+ { "BayerBG16", sensor_msgs::image_encodings::BAYER_BGGR16 },
+ { "BayerGB16", sensor_msgs::image_encodings::BAYER_GBRG16 },
+ { "BayerGR16", sensor_msgs::image_encodings::BAYER_GRBG16 },
+ { "YUV422_8_UYVY", sensor_msgs::image_encodings::YUV422 },
+ { "YUV422_8", sensor_msgs::image_encodings::YUV422 },
  // non-color contents
- { "Data8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_8UC1) },
- { "Confidence8", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_8UC1) },
- { "Data8s", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_8SC1) },
- { "Data16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_16UC1) },
- { "Confidence16", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_16UC1) },
- { "Data16s", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_16SC1) },
- { "Data32s", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_32SC1) },
- { "Data32f", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_32FC1) },
- { "Confidence32f", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_32FC1) },
- { "Coord3D_C32f", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_32FC1) },
- { "Data64f", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::TYPE_64FC1) },
- // unthrifty formats. Shift away padding Bits for use with ROS.
- { "Mono10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::MONO16) },
- { "Mono12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::MONO16) },
- { "Mono14", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 2, sensor_msgs::image_encodings::MONO16) },
- { "RGB10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::RGB16) },
- { "RGB12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::RGB16) },
- { "BGR10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::BGR16) },
- { "BGR12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::BGR16) },
- { "BayerRG10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::BAYER_RGGB16) },
- { "BayerBG10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::BAYER_BGGR16) },
- { "BayerGB10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::BAYER_GBRG16) },
- { "BayerGR10", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::BAYER_GRBG16) },
- { "BayerRG12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::BAYER_RGGB16) },
- { "BayerBG12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::BAYER_BGGR16) },
- { "BayerGB12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::BAYER_GBRG16) },
- { "BayerGR12", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 4, sensor_msgs::image_encodings::BAYER_GRBG16) },
+ { "Data8", sensor_msgs::image_encodings::TYPE_8UC1 },
+ { "Confidence8", sensor_msgs::image_encodings::TYPE_8UC1 },
+ { "Data8s", sensor_msgs::image_encodings::TYPE_8SC1 },
+ { "Data16", sensor_msgs::image_encodings::TYPE_16UC1 },
+ { "Confidence16", sensor_msgs::image_encodings::TYPE_16UC1 },
+ { "Data16s", sensor_msgs::image_encodings::TYPE_16SC1 },
+ { "Data32s", sensor_msgs::image_encodings::TYPE_32SC1 },
+ { "Data32f", sensor_msgs::image_encodings::TYPE_32FC1 },
+ { "Confidence32f", sensor_msgs::image_encodings::TYPE_32FC1 },
+ { "Coord3D_C32f", sensor_msgs::image_encodings::TYPE_32FC1 },
+ { "Data64f", sensor_msgs::image_encodings::TYPE_64FC1 },
+ // GigE-Vision specific format naming
+ { "YUV422Packed", sensor_msgs::image_encodings::YUV422 }
+};
+
+// Unthrifty pixel formats. Shift away padding Bits for use with ROS.
+// Conversion works in-place on the input image.
+const std::map<std::string, std::pair<size_t, std::string>> SHIFT_DICTIONARY =
+{
+ { "Mono10", { 6, sensor_msgs::image_encodings::MONO16 } },
+ { "Mono12", { 4, sensor_msgs::image_encodings::MONO16 } },
+ { "Mono14", { 2, sensor_msgs::image_encodings::MONO16 } },
+ { "RGB10", { 6, sensor_msgs::image_encodings::RGB16 } },
+ { "RGB12", { 4, sensor_msgs::image_encodings::RGB16 } },
+ { "BGR10", { 6, sensor_msgs::image_encodings::BGR16 } },
+ { "BGR12", { 4, sensor_msgs::image_encodings::BGR16 } },
+ { "BayerRG10", { 6, sensor_msgs::image_encodings::BAYER_RGGB16 } },
+ { "BayerBG10", { 6, sensor_msgs::image_encodings::BAYER_BGGR16 } },
+ { "BayerGB10", { 6, sensor_msgs::image_encodings::BAYER_GBRG16 } },
+ { "BayerGR10", { 6, sensor_msgs::image_encodings::BAYER_GRBG16 } },
+ { "BayerRG12", { 4, sensor_msgs::image_encodings::BAYER_RGGB16 } },
+ { "BayerBG12", { 4, sensor_msgs::image_encodings::BAYER_BGGR16 } },
+ { "BayerGB12", { 4, sensor_msgs::image_encodings::BAYER_GBRG16 } },
+ { "BayerGR12", { 4, sensor_msgs::image_encodings::BAYER_GRBG16 } }
+};
+
+const std::map<std::string, ConversionFunction> CONVERSIONS_DICTIONARY =
+{
  // planar instead pixel-by-pixel encodings
  { "RGB8_Planar", std::bind(&interleaveImg, std::placeholders::_1, std::placeholders::_2, 0, sensor_msgs::image_encodings::RGB8) },
  { "RGB10_Planar", std::bind(&interleaveImg, std::placeholders::_1, std::placeholders::_2, 6, sensor_msgs::image_encodings::RGB16) },
@@ -158,7 +185,6 @@ const std::map<std::string, ConversionFunction> CONVERSIONS_DICTIONARY =
  { "BayerBG12Packed", std::bind(&unpack12PackedImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_BGGR16) },
  { "BayerGB12Packed", std::bind(&unpack12PackedImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GBRG16) },
  { "BayerGR12Packed", std::bind(&unpack12PackedImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::BAYER_GRBG16) },
- { "YUV422Packed", std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, sensor_msgs::image_encodings::YUV422) },
  //non GenICam/GigE-Vision pixel formats ovverides used with `pixel_format_internal`
  //// data adapters
  { "FloatToUint", std::bind(&float_to_uint, std::placeholders::_1, std::placeholders::_2, 1.0f, sensor_msgs::image_encodings::TYPE_16UC1) },
@@ -168,6 +194,12 @@ const std::map<std::string, ConversionFunction> CONVERSIONS_DICTIONARY =
  { "Mono8InMono16", std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2, 8 , sensor_msgs::image_encodings::MONO16) }
 };
 
+// Look up conversion of pixel format from RENAME_DICTIONARY, SHIFT_DICTIONARY or CONVERSIONS_DICTIONARY.
+// Returns empty function for unknown pixel format. If rename_only is given, it is set
+// when the conversion is in place relabeling of encoding without any pixel work.
+// If in_place is given, it is set when the conversion overwrites its input image.
+ConversionFunction getConversion(const std::string &pixel_format, bool *rename_only = nullptr, bool *in_place = nullptr);
+
 } // end namespace camera_aravis
 
 #endif /* CAMERA_ARAVIS_CONVERSION_UTILS */
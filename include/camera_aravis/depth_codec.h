@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_DEPTH_CODEC
+#define CAMERA_ARAVIS_DEPTH_CODEC
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// Lossless RVL (run length + variable length) coding of 16 bit depth,
+// after A. D. Wilson, "Fast Lossless Depth Image Compression", ISS 2017.
+//
+// Pixels are coded as alternating runs of zeros (invalid depth) and non-zeros,
+// non-zero values as zigzag coded deltas to previous non-zero value.
+// Run lengths and deltas are written as 4 bit nibbles (3 value bits + continuation bit)
+// packed into 32 bit words, 8 nibbles per word starting from most significant.
+
+// Append RVL stream of contiguous pixels to output.
+void encodeRVL(const uint16_t *pixels, size_t n_pixels, std::vector<uint8_t> &out);
+
+// Decode n_pixels from RVL stream, false if stream is corrupted or too short.
+bool decodeRVL(const uint8_t *in, size_t size, uint16_t *pixels, size_t n_pixels);
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_DEPTH_CODEC */
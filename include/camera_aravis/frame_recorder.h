@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_FRAME_RECORDER
+#define CAMERA_ARAVIS_FRAME_RECORDER
+
+#include <sensor_msgs/Image.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Recording directory layout:
+//   recording.yaml  substreams (name, frame_id, pixel format the driver converts from, bits per pixel)
+//   frames.raw      raw payloads as delivered by camera, back to back
+//   index.bin       FrameRecord per frame, in write order
+//
+// Records are little endian and fixed size, index may be read while recording.
+struct FrameRecord
+{
+  // payload position in frames.raw
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  // image header stamp and sequence (aravis frame id)
+  uint64_t stamp_ns = 0;
+  uint64_t frame_id = 0;
+  // region of interest of payload
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t step = 0;
+  // index of substream in recording.yaml
+  uint32_t substream = 0;
+};
+
+struct RecordedSubstream
+{
+  std::string name;
+  std::string frame_id;
+  // GenICam or pixel_format_internal name, selects conversion to ROS encoding
+  std::string pixel_format;
+  uint32_t bits_per_pixel = 0;
+};
+
+// Plain copy of recorder counters taken at diagnostics update time.
+struct FrameRecorderStatisticsSample
+{
+  uint64_t n_written = 0;
+  uint64_t n_dropped = 0;
+  uint64_t bytes_written = 0;
+  uint64_t queued_bytes = 0;
+  // time spent in write calls
+  uint64_t write_ns = 0;
+};
+
+// Raw frame recorder bypassing ROS serialization.
+//
+// Frames are queued by shared pointer to pooled image, so the camera buffer stays out of
+// the aravis queue until its payload is copied into the write block. Dedicated writer thread
+// writes large blocks aligned for O_DIRECT (falls back to buffered writes on file systems
+// without O_DIRECT support). Back-pressure is bounded by queued bytes, above that limit
+// frames are dropped instead of holding more camera buffers.
+class FrameRecorder
+{
+public:
+  FrameRecorder(const std::string &directory, const std::vector<RecordedSubstream> &substreams,
+                size_t max_queued_bytes, size_t block_size);
+  // writes queued frames and closes files
+  ~FrameRecorder();
+
+  bool isOpen() const { return writer_.joinable(); }
+  const std::string& directory() const { return directory_; }
+
+  // Queue frame, record offset and size are filled by recorder.
+  // False if queue is full or recorder failed and frame was dropped.
+  bool push(const FrameRecord &record, const sensor_msgs::ImageConstPtr &image);
+
+  FrameRecorderStatisticsSample sample() const;
+
+  // all queued frames are written
+  bool idle() const;
+
+  static const size_t ALIGNMENT = 4096;
+
+private:
+  struct Job
+  {
+    FrameRecord record;
+    sensor_msgs::ImageConstPtr image;
+  };
+
+  bool writeMetadata(const std::vector<RecordedSubstream> &substreams) const;
+  void writerMain();
+  void append(const uint8_t *data, size_t size);
+  void writeBlock(size_t size);
+  void close();
+
+  const std::string directory_;
+  const size_t max_queued_bytes_;
+  const size_t block_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable job_ready_;
+  std::deque<Job> jobs_;
+  size_t queued_bytes_ = 0;
+  bool stop_ = false;
+
+  // writer thread only
+  int data_fd_ = -1;
+  std::ofstream index_;
+  uint8_t *block_ = nullptr;
+  size_t block_fill_ = 0;
+  uint64_t data_offset_ = 0;
+  std::atomic<bool> failed_{false};
+
+  std::atomic<uint64_t> n_written_{0};
+  std::atomic<uint64_t> n_dropped_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint64_t> write_ns_{0};
+
+  std::thread writer_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_FRAME_RECORDER */
@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_FRAME_RING
+#define CAMERA_ARAVIS_FRAME_RING
+
+#include <camera_aravis/frame_recorder.h>
+
+#include <sensor_msgs/Image.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+struct RingFrame
+{
+  FrameRecord record;
+  sensor_msgs::ImageConstPtr image;
+  // bytes of pool memory pinned by image
+  size_t charge = 0;
+};
+
+// Pre-trigger ring of last frames of a substream, kept as native pooled images without conversion.
+//
+// Frames are evicted oldest first when ring spans more than max_duration_ns or pins more than
+// max_bytes of buffer pool memory. Camera buffers held here are out of the aravis queue,
+// so the budget bounds how far the stream buffer pool grows. Frozen frames count against the
+// budget until their images are released, the ring refills only as a flush writes them.
+class FrameRing
+{
+public:
+  FrameRing(uint64_t max_duration_ns, size_t max_bytes) : max_duration_ns_(max_duration_ns), max_bytes_(max_bytes) {}
+
+  void push(const FrameRecord &record, const sensor_msgs::ImageConstPtr &image, size_t charge);
+
+  // Take all frames out of the ring, oldest first, ring continues empty.
+  std::deque<RingFrame> freeze();
+
+  size_t size() const;
+  size_t bytes() const;
+  // bytes of frozen frames not released yet
+  size_t frozenBytes() const { return frozen_bytes_->load(std::memory_order_relaxed); }
+  uint64_t durationNs() const;
+  size_t maxBytes() const { return max_bytes_; }
+
+private:
+  const uint64_t max_duration_ns_;
+  const size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+  std::deque<RingFrame> frames_;
+  size_t bytes_ = 0;
+  // shared with release of frozen images, they may outlive the ring
+  const std::shared_ptr<std::atomic<size_t>> frozen_bytes_ = std::make_shared<std::atomic<size_t>>(0);
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_FRAME_RING */
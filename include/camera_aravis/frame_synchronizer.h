@@ -0,0 +1,103 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_FRAME_SYNCHRONIZER
+#define CAMERA_ARAVIS_FRAME_SYNCHRONIZER
+
+#include <camera_aravis/frame_trace.h>
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+struct SyncFrame
+{
+  sensor_msgs::ImageConstPtr image;
+  sensor_msgs::CameraInfoConstPtr camera_info;
+};
+
+// Plain copy of synchronizer counters taken at diagnostics update time.
+struct FrameSynchronizerStatisticsSample
+{
+  uint64_t n_sets = 0;
+  // sets abandoned because some camera had no frame within tolerance
+  uint64_t n_incomplete = 0;
+  // frames dropped per camera, unmatched or queue overflow
+  std::vector<uint64_t> n_dropped;
+  // skew of sets since previous sample
+  uint64_t skew_p50_ns = 0;
+  uint64_t skew_p99_ns = 0;
+  uint64_t skew_max_ns = 0;
+};
+
+// Groups frames of several cameras whose header stamps lie within tolerance.
+//
+// Cameras deliver frames in stamp order, so matching looks only at queue heads: if heads span
+// at most tolerance they form a set, otherwise the earliest heads can never be completed and
+// are dropped as incomplete set. Matching adds no delay beyond the last frame of a set.
+// Frames are kept as shared pointers and never copied.
+class FrameSynchronizer
+{
+public:
+  // frames in camera order, skew is latest minus earliest stamp
+  typedef std::function<void(const std::vector<SyncFrame> &frames, uint64_t skew_ns)> SetCallback;
+
+  FrameSynchronizer(size_t n_cameras, uint64_t tolerance_ns, size_t queue_size, SetCallback on_set);
+
+  // Set callback runs on the calling thread.
+  void push(size_t camera, const SyncFrame &frame);
+
+  // Counters are cumulative, skew percentiles cover the period since previous sample.
+  FrameSynchronizerStatisticsSample sample();
+
+private:
+  void match();
+  void dropIncomplete(uint64_t earliest_ns);
+
+  const uint64_t tolerance_ns_;
+  const size_t queue_size_;
+  const SetCallback on_set_;
+
+  std::mutex mutex_;
+  std::vector<std::deque<SyncFrame>> queues_;
+  std::vector<SyncFrame> set_;
+
+  uint64_t n_sets_ = 0;
+  uint64_t n_incomplete_ = 0;
+  std::vector<uint64_t> n_dropped_;
+  LatencyHistogram skew_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_FRAME_SYNCHRONIZER */
@@ -0,0 +1,83 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_FRAME_SYNCHRONIZER_NODELET
+#define CAMERA_ARAVIS_FRAME_SYNCHRONIZER_NODELET
+
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <image_transport/image_transport.h>
+#include <diagnostic_updater/diagnostic_updater.h>
+
+#include <camera_aravis/FrameBundle.h>
+#include <camera_aravis/frame_synchronizer.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace camera_aravis
+{
+
+// Groups frames of several camera nodelets by stamp and republishes them as time-aligned sets.
+//
+// Loaded into the same manager as the cameras, images pass through as shared pointers:
+// synchronized/<camera>/image_raw carries the very messages the cameras published,
+// synchronized/bundle lists headers of each set. With PTP stamps (use_ptp_timestamp)
+// tolerance can be well below frame period.
+class FrameSynchronizerNodelet : public nodelet::Nodelet
+{
+public:
+  FrameSynchronizerNodelet();
+  virtual ~FrameSynchronizerNodelet();
+
+private:
+  virtual void onInit() override;
+
+  void frameCallback(size_t camera, const sensor_msgs::ImageConstPtr &image,
+                     const sensor_msgs::CameraInfoConstPtr &camera_info);
+  void publishSet(const std::vector<SyncFrame> &frames, uint64_t skew_ns);
+
+  void produceDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+  void diagnosticTimerCallback(const ros::TimerEvent &event);
+
+  // output names, last component of camera namespaces
+  std::vector<std::string> camera_names_;
+  std::unique_ptr<FrameSynchronizer> synchronizer_;
+
+  std::unique_ptr<image_transport::ImageTransport> p_transport_;
+  std::vector<image_transport::CameraSubscriber> camera_subs_;
+  std::vector<image_transport::CameraPublisher> camera_pubs_;
+  ros::Publisher bundle_pub_;
+
+  double diagnostic_rate_ = 1.0;
+  std::unique_ptr<diagnostic_updater::Updater> diagnostic_updater_;
+  ros::Timer diagnostic_timer_;
+  // previous diagnostics sample, accessed only from diagnostics timer
+  FrameSynchronizerStatisticsSample last_statistics_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_FRAME_SYNCHRONIZER_NODELET */
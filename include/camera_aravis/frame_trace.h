@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_FRAME_TRACE
+#define CAMERA_ARAVIS_FRAME_TRACE
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Host timestamps in wall clock nanoseconds, same clock as arv_buffer_get_system_timestamp.
+inline uint64_t frameTraceNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Duration between two trace timestamps, 0 if missing or out of order.
+inline uint64_t frameTraceInterval(uint64_t begin_ns, uint64_t end_ns)
+{
+  return (begin_ns && end_ns > begin_ns) ? end_ns - begin_ns : 0;
+}
+
+// Timestamps of a single frame through buffer processing pipeline.
+struct FrameTrace
+{
+  uint64_t frame_id = 0;
+  // device clock, comparable with host clock only with PTP
+  uint64_t camera_ns = 0;
+  // aravis received last packet of the buffer
+  uint64_t arrival_ns = 0;
+  // buffer handed over to substream thread
+  uint64_t delegate_ns = 0;
+  // substream thread picked up the buffer
+  uint64_t dequeue_ns = 0;
+  uint64_t convert_begin_ns = 0;
+  uint64_t convert_end_ns = 0;
+  // publish call returned
+  uint64_t publish_ns = 0;
+
+  static void writeCsvHeader(std::ostream &out);
+  void writeCsv(std::ostream &out, const std::string &substream) const;
+};
+
+enum FrameTraceStage
+{
+  TRACE_STAGE_DELIVERY = 0, // arrival -> delegate
+  TRACE_STAGE_QUEUE,        // delegate -> dequeue
+  TRACE_STAGE_PREPARE,      // dequeue -> conversion begin
+  TRACE_STAGE_CONVERSION,   // conversion begin -> end
+  TRACE_STAGE_PUBLISH,      // conversion end -> publish
+  TRACE_STAGE_TOTAL,        // arrival -> publish
+  TRACE_STAGE_COUNT
+};
+
+const char* frameTraceStageName(FrameTraceStage stage);
+
+// Multi producer single consumer ring of frame traces.
+//
+// Producers are the substream processing thread and, with inline publishing, the delivery thread,
+// consumer is the trace timer. Producers serialize on a mutex that is uncontended in practice,
+// consumer stays lock-free. Full ring drops new traces instead of blocking the producer.
+class FrameTraceRing
+{
+public:
+  // capacity is rounded up to power of 2
+  explicit FrameTraceRing(size_t capacity = 1024);
+
+  bool push(const FrameTrace &trace);
+  bool pop(FrameTrace &trace);
+
+  uint64_t dropped() const { return n_dropped_.load(std::memory_order_relaxed); }
+
+private:
+  std::vector<FrameTrace> ring_;
+  size_t mask_;
+  std::mutex push_mutex_;
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<uint64_t> n_dropped_{0};
+};
+
+// Log-linear latency histogram.
+//
+// Each power of 2 of nanoseconds is split into 2^SUB_BUCKET_BITS buckets,
+// that bounds relative error of reported percentiles to ~6%.
+class LatencyHistogram
+{
+public:
+  LatencyHistogram() { reset(); }
+
+  void add(uint64_t ns);
+  void reset();
+
+  // p in [0, 1], returns upper bound of the bucket containing percentile
+  uint64_t percentile(double p) const;
+  uint64_t max() const { return max_ns_; }
+  uint64_t count() const { return count_; }
+
+private:
+  static const int SUB_BUCKET_BITS = 4;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+  static size_t bucketIndex(uint64_t ns);
+  static uint64_t bucketUpperBound(size_t index);
+
+  std::array<uint64_t, (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS> buckets_;
+  uint64_t count_;
+  uint64_t max_ns_;
+};
+
+// Per-stage latency histograms of a substream.
+struct FrameTraceStatistics
+{
+  std::array<LatencyHistogram, TRACE_STAGE_COUNT> stages;
+
+  void add(const FrameTrace &trace);
+  void reset();
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_FRAME_TRACE */
@@ -0,0 +1,126 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_GVSP_RECEIVER
+#define CAMERA_ARAVIS_GVSP_RECEIVER
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Image block reassembled from GVSP leader, data and trailer packets.
+struct GvspFrame
+{
+  uint64_t block_id = 0;
+  // camera timestamp of leader, ns if camera runs PTP
+  uint64_t timestamp = 0;
+  // host wall clock at leader arrival, same clock as arv_buffer_get_system_timestamp
+  uint64_t arrival_ns = 0;
+  uint32_t pixel_format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  std::vector<uint8_t> data;
+};
+
+// Plain copy of receiver counters taken at diagnostics update time.
+struct GvspReceiverStatisticsSample
+{
+  uint64_t n_completed = 0;
+  // frames with missing packets, no resend is requested
+  uint64_t n_incomplete = 0;
+  // non image payloads (multipart, chunk, H.264) and malformed packets
+  uint64_t n_ignored = 0;
+};
+
+// Receives GigE Vision stream channel sent to a multicast group, without the control channel.
+//
+// Any number of receivers on the host can join the same group and port, which makes this the stream
+// path of read-only monitors next to the controlling driver. Only image payloads are reassembled, one
+// block at a time, and packets are never requested again. A new block abandons the previous one if it
+// is incomplete. Callbacks run on the receiving thread, a frame may swap its data out to avoid a copy.
+class GvspReceiver
+{
+public:
+  typedef std::function<void(GvspFrame &frame)> FrameCallback;
+  typedef std::function<void(uint64_t block_id)> LossCallback;
+
+  // packet_size is GevSCPSPacketSize (IP and UDP headers included), 0 to learn data size from packets
+  GvspReceiver(const std::string &group, const std::string &interface_address, uint16_t port,
+               uint32_t packet_size, FrameCallback on_frame, LossCallback on_loss);
+  ~GvspReceiver();
+
+  GvspReceiver(const GvspReceiver &) = delete;
+  GvspReceiver &operator=(const GvspReceiver &) = delete;
+
+  // Bind, join group and start receiving thread, false on failure.
+  bool start();
+  void stop();
+
+  GvspReceiverStatisticsSample sample() const;
+
+private:
+  void threadMain();
+  void handlePacket(const uint8_t *packet, size_t size);
+  void finishBlock();
+
+  const std::string group_;
+  const std::string interface_address_;
+  const uint16_t port_;
+  const uint32_t packet_size_;
+  const FrameCallback on_frame_;
+  const LossCallback on_loss_;
+
+  int socket_ = -1;
+  std::atomic<bool> active_{false};
+  std::thread thread_;
+
+  // receiving thread only
+  uint32_t data_size_ = 0;       // payload bytes per full data packet, learned if packet_size_ is 0
+  bool block_open_ = false;      // frame_.block_id is the current block
+  bool block_done_ = false;      // current block delivered or ignored, late packets are dropped
+  bool leader_received_ = false;
+  bool trailer_received_ = false;
+  uint32_t n_data_packets_ = 0;  // trailer packet id - 1
+  uint32_t n_received_ = 0;      // distinct data packets of current block
+  size_t extent_ = 0;            // end of received data in frame_.data
+  std::vector<bool> received_;
+  GvspFrame frame_;
+
+  std::atomic<uint64_t> n_completed_{0};
+  std::atomic<uint64_t> n_incomplete_{0};
+  std::atomic<uint64_t> n_ignored_{0};
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_GVSP_RECEIVER */
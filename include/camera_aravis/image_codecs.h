@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_IMAGE_CODECS
+#define CAMERA_ARAVIS_IMAGE_CODECS
+
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/Image.h>
+
+#include <string>
+
+namespace camera_aravis
+{
+
+// Codecs of compressed outputs, usable without the nodelet (camera_aravis_codecs library).
+//
+// CompressedImage format follows compressed_image_transport where possible:
+//   "<encoding>; jpeg compressed <bgr8|mono8>"  - lossy, mono8/bgr8/rgb8 images
+//   "<encoding>; png compressed <encoding>"     - lossless, 8/16 bit images with 1, 3 or 4 channels
+//   "<encoding>; zstd compressed"               - lossless, any encoding (if built with libzstd),
+//                                                 ZstdHeader followed by zstd frame of pixel rows,
+//                                                 16 bit pixels are split into low and high byte planes
+//   "<16UC1|32FC1>; rvl compressed"              - depth, RvlHeader followed by RVL stream (depth_codec.h),
+//                                                 32FC1 is quantized to 16 bit, 0 is invalid depth
+struct CodecParameters
+{
+  // lossy codec of mono8/bgr8/rgb8 images, "jpeg" or "none" to use lossless codec for all images
+  std::string codec = "jpeg";
+  // codec of other images, "png" or "zstd"
+  std::string lossless_codec = "png";
+  int jpeg_quality = 90;
+  int png_level = 1;
+  int zstd_level = 1;
+  // codec of depth images (16UC1, 32FC1), "rvl" or "none" to use lossless codec
+  std::string depth_codec = "rvl";
+  // 32FC1 depth is stored as round(depth * depth_scale), e.g. 1000 for meters to millimeters
+  double depth_scale = 1000.0;
+};
+
+// header of zstd payload, little endian
+struct ZstdHeader
+{
+  static const uint32_t MAGIC = 0x315a4143; // "CAZ1"
+  static const uint32_t FLAG_BYTE_PLANES = 1;
+
+  uint32_t magic = MAGIC;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t step = 0;
+  uint32_t flags = 0;
+};
+
+// header of rvl payload, little endian
+struct RvlHeader
+{
+  static const uint32_t MAGIC = 0x31524143; // "CAR1"
+
+  uint32_t magic = MAGIC;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // quantization of 32FC1 depth, 0 for 16UC1
+  float depth_scale = 0.0f;
+};
+
+// codec was compiled in
+bool codecAvailable(const std::string &codec);
+
+// Compress image with codec chosen by parameters and image encoding, false if encoding can't be compressed.
+bool encodeImage(const sensor_msgs::Image &image, const CodecParameters &params, sensor_msgs::CompressedImage &compressed);
+
+// Decompress image of any format produced by encodeImage, false on unknown format or corrupted data.
+bool decodeImage(const sensor_msgs::CompressedImage &compressed, sensor_msgs::Image &image);
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_IMAGE_CODECS */
@@ -0,0 +1,110 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_PIXEL_CORRECTION
+#define CAMERA_ARAVIS_PIXEL_CORRECTION
+
+#include <sensor_msgs/Image.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Per-pixel dark frame subtraction, flat-field gain and defective pixel replacement
+// of single channel 8/16 bit images (mono or Bayer), in one pass.
+//
+// Maps are stored with cv::FileStorage:
+//   dark         CV_16UC1 offset subtracted from each pixel
+//   gain         CV_32FC1 flat-field gain applied after dark subtraction
+//   hot_pixels   CV_32SC1 Nx2 (x, y) of pixels found bright in dark frame
+//   dead_pixels  CV_32SC1 Nx2 (x, y) of pixels found unresponsive in flat frame
+// Defective pixels are replaced by mean of horizontal neighbours of same color.
+//
+// Maps are captured by averaging frames at the same pipeline stage where they are applied.
+// Apply and capture run on substream processing thread, loading and capture requests
+// on service threads, all map access is serialized by internal mutex.
+class PixelCorrection
+{
+public:
+  enum CaptureKind { CAPTURE_DARK, CAPTURE_FLAT };
+
+  // load maps, false if file can't be read or holds no maps
+  bool load(const std::string &path);
+  bool save(const std::string &path) const;
+  bool empty() const;
+
+  // Corrected copy of in, values clamped to max_value. False if there are no maps
+  // or maps don't match image size, out is untouched then.
+  bool apply(const sensor_msgs::Image &in, sensor_msgs::Image &out, uint32_t max_value, bool bayer) const;
+
+  // Start averaging n_frames frames passed to addCaptureFrame into dark or flat map.
+  void startCapture(CaptureKind kind, size_t n_frames);
+  // Accumulate frame if capture is in progress, returns true if capture is in progress.
+  bool addCaptureFrame(const sensor_msgs::Image &image);
+  bool capturing() const;
+  // Wait for capture to complete, false on timeout (capture is cancelled).
+  bool waitCapture(double timeout_s);
+
+private:
+  // Q4.12 fixed point gain, 16 bit product with 16 bit value fits 32 bit
+  static const int GAIN_FRACTION_BITS = 12;
+  // hot pixel threshold in standard deviations of dark frame
+  static constexpr double HOT_PIXEL_SIGMA = 6.0;
+  // dead pixel response relative to mean flat response
+  static constexpr double DEAD_PIXEL_LOW = 0.5;
+  static constexpr double DEAD_PIXEL_HIGH = 1.5;
+
+  template<typename T>
+  void applyRows(const sensor_msgs::Image &in, sensor_msgs::Image &out, uint32_t max_value, bool bayer) const;
+  void finishCapture();
+  void ensureMaps(int rows, int cols);
+
+  mutable std::mutex mutex_;
+  std::condition_variable capture_done_;
+
+  cv::Mat dark_;
+  cv::Mat gain_;
+  std::vector<cv::Point> hot_pixels_;
+  std::vector<cv::Point> dead_pixels_;
+
+  // capture state
+  bool capturing_ = false;
+  CaptureKind capture_kind_ = CAPTURE_DARK;
+  size_t capture_frames_ = 0;
+  size_t captured_frames_ = 0;
+  std::vector<double> capture_sum_;
+  int capture_rows_ = 0;
+  int capture_cols_ = 0;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_PIXEL_CORRECTION */
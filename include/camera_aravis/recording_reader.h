@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_RECORDING_READER
+#define CAMERA_ARAVIS_RECORDING_READER
+
+#include <camera_aravis/frame_recorder.h>
+
+#include <sensor_msgs/Image.h>
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Reader of FrameRecorder directories.
+//
+// frames.raw is memory mapped, payloads are valid while reader is open.
+// Frames are reconstructed to ROS images with the same conversions the driver applies.
+class RecordingReader
+{
+public:
+  RecordingReader() = default;
+  RecordingReader(const RecordingReader&) = delete;
+  RecordingReader& operator=(const RecordingReader&) = delete;
+  ~RecordingReader();
+
+  bool open(const std::string &directory);
+  void close();
+
+  size_t size() const { return records_.size(); }
+  const FrameRecord& record(size_t i) const { return records_[i]; }
+  const std::vector<RecordedSubstream>& substreams() const { return substreams_; }
+
+  // payload of frame i in mapped frames.raw
+  const uint8_t* payload(size_t i) const { return data_ + records_[i].offset; }
+
+  // image as delivered by camera, pixel format of substream as encoding
+  sensor_msgs::ImagePtr nativeImage(size_t i) const;
+  // image converted to ROS encoding, null if pixel format has no conversion
+  sensor_msgs::ImagePtr image(size_t i) const;
+
+private:
+  bool readMetadata(const std::string &path);
+
+  std::vector<RecordedSubstream> substreams_;
+  std::vector<FrameRecord> records_;
+  const uint8_t *data_ = nullptr;
+  size_t data_size_ = 0;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_RECORDING_READER */
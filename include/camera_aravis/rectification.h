@@ -0,0 +1,80 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_RECTIFICATION
+#define CAMERA_ARAVIS_RECTIFICATION
+
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Undistortion and rectification of ROS images by precomputed fixed point remap tables.
+//
+// Tables are built from CameraInfo (plumb_bob, rational_polynomial or equidistant model)
+// for actual image size, respecting binning and image offset in calibrated sensor image,
+// and rebuilt only if any of them changes. Remapping is bilinear, split into bands of rows
+// processed in parallel, so that each thread works on cache resident part of tables.
+// Bayer and YUV images are not supported (demosaic first).
+//
+// Not thread safe, intended to be owned by single substream.
+class Rectifier
+{
+public:
+  // Rebuild tables if calibration, image size or offset changed,
+  // false if image can't be rectified (e.g. uncalibrated camera).
+  bool update(const sensor_msgs::CameraInfo &info, uint32_t width, uint32_t height,
+              uint32_t x_offset, uint32_t y_offset);
+
+  // Rectified copy of in, output is reset if tables don't match input image or encoding is not supported.
+  void rectify(const sensor_msgs::ImagePtr &in, sensor_msgs::ImagePtr &out) const;
+
+  // CameraInfo of rectified image, no distortion and identity rotation
+  static sensor_msgs::CameraInfoPtr rectifiedCameraInfo(const sensor_msgs::CameraInfo &info);
+
+private:
+  static const int BAND_ROWS = 16;
+
+  bool sameCalibration(const sensor_msgs::CameraInfo &info) const;
+
+  // calibration and image geometry of current tables
+  sensor_msgs::CameraInfo info_;
+  cv::Size size_;
+  uint32_t x_offset_ = 0;
+  uint32_t y_offset_ = 0;
+  bool valid_ = false;
+
+  // CV_16SC2 integer source coordinates and CV_16UC1 interpolation weights index
+  cv::Mat map_xy_;
+  cv::Mat map_fraction_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_RECTIFICATION */
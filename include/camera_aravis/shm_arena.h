@@ -0,0 +1,154 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_SHM_ARENA
+#define CAMERA_ARAVIS_SHM_ARENA
+
+#include <camera_aravis/ShmImage.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Layout at the start of the arena, slot data follows page aligned.
+struct ShmArenaHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t n_slots;
+  uint32_t reserved;
+  uint64_t slot_size;    // bytes of data per slot
+  uint64_t data_offset;  // offset of first slot data from arena start
+};
+
+struct ShmSlot
+{
+  // reader count, WRITER_BIT while the publisher fills the slot
+  std::atomic<uint32_t> refs;
+  // bumped on every reuse so stale descriptors can be detected
+  std::atomic<uint32_t> generation;
+  uint64_t size;  // bytes written in current generation
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shm arena needs address free lock-free atomics");
+
+// Fixed size slots of image data in a POSIX shared memory object.
+//
+// Slot ownership is tracked lock-free in shared memory. The publisher claims only slots
+// without readers (refs 0 -> WRITER_BIT), readers pin a slot by incrementing refs and
+// back off if the slot is being written or its generation moved on. A slot returns to
+// the publisher when the last reader releases it. A reader process dying with a pinned
+// slot leaks that slot until the arena is recreated.
+class ShmArena
+{
+public:
+  static const uint32_t MAGIC = 0x4d485343;  // "CSHM"
+  static const uint32_t VERSION = 1;
+  static const uint32_t WRITER_BIT = 0x80000000u;
+
+  // Create arena as publisher, replacing stale object of the same name. Returns nullptr on failure.
+  static std::unique_ptr<ShmArena> create(const std::string &name, uint32_t n_slots, size_t slot_size);
+  // Map existing arena as reader. Returns nullptr on failure.
+  static std::unique_ptr<ShmArena> open(const std::string &name);
+
+  ~ShmArena();
+
+  ShmArena(const ShmArena &) = delete;
+  ShmArena &operator=(const ShmArena &) = delete;
+
+  // Publisher: claim the next free slot round robin, -1 if all slots are pinned by readers.
+  int32_t beginWrite(uint32_t &generation);
+  uint8_t *slotData(uint32_t slot);
+  // Publisher: make size bytes of slot visible to readers.
+  void endWrite(uint32_t slot, size_t size);
+
+  // Reader: pin slot if it still holds generation, false if it was recycled or is being written.
+  bool acquire(uint32_t slot, uint32_t generation);
+  void release(uint32_t slot);
+  const uint8_t *slotData(uint32_t slot) const;
+  size_t dataSize(uint32_t slot) const;
+
+  const std::string &name() const { return name_; }
+  uint32_t slots() const { return header_->n_slots; }
+  size_t slotSize() const { return header_->slot_size; }
+
+private:
+  ShmArena(const std::string &name, void *base, size_t length, bool owner);
+
+  ShmSlot &slot(uint32_t index) const;
+
+  std::string name_;
+  void *base_ = nullptr;
+  size_t length_ = 0;
+  bool owner_ = false;  // publisher unlinks the name on destruction
+  ShmArenaHeader *header_ = nullptr;
+  uint32_t next_slot_ = 0;
+};
+
+// Slot pinned by a reader, released on destruction. Data is valid for the lifetime of the lease.
+class ShmLease
+{
+public:
+  ShmLease(const std::shared_ptr<ShmArena> &arena, uint32_t slot, size_t size) :
+    arena_(arena), slot_(slot), size_(size) {}
+  ~ShmLease() { arena_->release(slot_); }
+
+  ShmLease(const ShmLease &) = delete;
+  ShmLease &operator=(const ShmLease &) = delete;
+
+  const uint8_t *data() const { return arena_->slotData(slot_); }
+  size_t size() const { return size_; }
+
+private:
+  std::shared_ptr<ShmArena> arena_;
+  uint32_t slot_;
+  size_t size_;
+};
+
+// Reader side of the shm image transport for same host consumers.
+//
+// Maps the arena named by descriptors of a topic, remapping when the publisher recreates it.
+// Native readers may keep the returned lease instead of copying, the slot is not reused
+// by the publisher until the lease is destroyed.
+class ShmReader
+{
+public:
+  // Pin data of descriptor, nullptr if arena is not reachable or the frame was already recycled.
+  std::shared_ptr<const ShmLease> acquire(const ShmImage &image);
+
+private:
+  std::mutex mutex_;
+  std::shared_ptr<ShmArena> arena_;
+  std::string unreachable_;  // arena that failed to map, e.g. publisher on another host
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_SHM_ARENA */
@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_SHM_TRANSPORT
+#define CAMERA_ARAVIS_SHM_TRANSPORT
+
+#include <camera_aravis/shm_arena.h>
+#include <camera_aravis/ShmImage.h>
+
+#include <image_transport/simple_publisher_plugin.h>
+#include <image_transport/simple_subscriber_plugin.h>
+
+#include <memory>
+#include <mutex>
+
+namespace camera_aravis
+{
+
+// image_transport "shm" publisher, same host subscribers read pixel data from a shared memory arena.
+//
+// Each frame is copied once into a free arena slot and only a ShmImage descriptor goes over
+// TCPROS. The arena is created on the first frame and recreated when frames outgrow its slots.
+class ShmPublisher : public image_transport::SimplePublisherPlugin<ShmImage>
+{
+public:
+  virtual std::string getTransportName() const { return "shm"; }
+
+protected:
+  virtual void publish(const sensor_msgs::Image &image, const PublishFn &publish_fn) const;
+
+private:
+  bool initArena(size_t slot_size) const;
+
+  mutable std::mutex mutex_;
+  mutable std::unique_ptr<ShmArena> arena_;
+  mutable uint32_t arena_count_ = 0;
+};
+
+// image_transport "shm" subscriber, copies pinned slot data into sensor_msgs::Image.
+//
+// Consumers that want to avoid the copy can subscribe to the ShmImage descriptor topic
+// directly and keep a ShmLease from ShmReader instead.
+class ShmSubscriber : public image_transport::SimpleSubscriberPlugin<ShmImage>
+{
+public:
+  virtual std::string getTransportName() const { return "shm"; }
+
+protected:
+  virtual void internalCallback(const ShmImage::ConstPtr &message, const Callback &user_cb);
+
+private:
+  ShmReader reader_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_SHM_TRANSPORT */
@@ -0,0 +1,168 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_STREAM_STATISTICS
+#define CAMERA_ARAVIS_STREAM_STATISTICS
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Plain copy of substream counters taken at diagnostics update time.
+struct SubstreamStatisticsSample
+{
+  uint64_t n_published = 0;
+  uint64_t n_queue_drops = 0;
+  uint64_t conversion_ns = 0;
+  uint64_t publish_latency_ns = 0;
+  // maximum since previous sample
+  uint64_t publish_latency_max_ns = 0;
+};
+
+// Substream counters.
+//
+// Written from buffer delivery and substream processing threads,
+// read from diagnostics timer. Lock-free, relaxed ordering is enough
+// as counters are independent and only used for reporting.
+class SubstreamStatistics
+{
+public:
+  // frame was overwritten in substream queue before it could be processed
+  inline void addQueueDrop()
+  {
+    n_queue_drops_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // conversion_ns - time spent in pixel format conversion
+  // latency_ns    - time from host buffer arrival to publishing
+  void addPublished(uint64_t conversion_ns, uint64_t latency_ns);
+
+  // Read counters, resets interval maximum.
+  SubstreamStatisticsSample sample();
+
+private:
+  std::atomic<uint64_t> n_published_{0};
+  std::atomic<uint64_t> n_queue_drops_{0};
+  std::atomic<uint64_t> conversion_ns_{0};
+  std::atomic<uint64_t> publish_latency_ns_{0};
+  std::atomic<uint64_t> publish_latency_max_ns_{0};
+};
+
+// Aravis stream level counters, see arv_stream_get_statistics and arv_gv_stream_get_statistics.
+struct StreamStatisticsSample
+{
+  uint64_t n_completed_buffers = 0;
+  uint64_t n_failures = 0;
+  uint64_t n_underruns = 0;
+  uint64_t n_resent = 0;
+  uint64_t n_missing = 0;
+  // monotonic time of sample
+  int64_t stamp_ns = 0;
+};
+
+// Frame id continuity tracking.
+//
+// GigE Vision 1.x block ids are 16 bit and skip 0 on wraparound,
+// GigE Vision 2.x extended ids and USB3 Vision ids are 64 bit.
+// The tracker starts with 16 bit wraparound and switches to 64 bit
+// once it sees id above 16 bit range. Backward jumps which are not
+// a plausible wraparound are treated as device counter reset.
+class FrameIdTracker
+{
+public:
+  // number of frame ids skipped between previous and this frame id
+  uint64_t update(uint64_t frame_id);
+  void reset() { has_last_ = false; }
+
+private:
+  static const uint64_t MAX_ID_16BIT = 0xFFFF;
+  // backward jump must come from this close to 16 bit end to be considered a wraparound
+  static const uint64_t WRAP_WINDOW = 0x1000;
+
+  bool has_last_ = false;
+  bool wide_ids_ = false;
+  uint64_t last_ = 0;
+};
+
+enum FrameLossReason
+{
+  LOSS_TIMEOUT = 0,      // aravis buffer timeout, incomplete frame
+  LOSS_MISSING_PACKETS,  // missing or wrong packets on the link
+  LOSS_SIZE_MISMATCH,    // payload doesn't fit the buffer
+  LOSS_OTHER,            // other aravis buffer failures
+  LOSS_GAP,              // frame id never received (link or no free buffer in host)
+  LOSS_QUEUE_DROP,       // overwritten in substream queue (downstream backpressure)
+  LOSS_NO_SUBSCRIBER,    // received and deliberately not processed
+  LOSS_REASON_COUNT
+};
+
+const char* frameLossReasonName(FrameLossReason reason);
+
+struct FrameLossSample
+{
+  uint64_t n_received = 0;
+  uint64_t n_delivered = 0;
+  std::array<uint64_t, LOSS_REASON_COUNT> n_lost{};
+  // consecutive runs of lost frames (failures and gaps)
+  uint64_t n_bursts = 0;
+  // longest burst since previous sample
+  uint64_t max_burst = 0;
+};
+
+// Stream level frame loss counters split by reason.
+//
+// receive/deliver/failure accounting is called only from the stream buffer
+// delivery thread, sample() from diagnostics timer.
+class FrameLossStatistics
+{
+public:
+  // buffer received from aravis, returns number of frames in gap before it
+  uint64_t addReceived(uint64_t frame_id, bool track_id);
+  // received buffer handed over for processing, ends current loss burst
+  void addDelivered();
+  void addLost(FrameLossReason reason, uint64_t n = 1);
+
+  FrameLossSample sample();
+
+private:
+  void extendBurst(uint64_t n);
+
+  // delivery thread only
+  FrameIdTracker id_tracker_;
+  uint64_t burst_length_ = 0;
+
+  std::atomic<uint64_t> n_received_{0};
+  std::atomic<uint64_t> n_delivered_{0};
+  std::array<std::atomic<uint64_t>, LOSS_REASON_COUNT> n_lost_{};
+  std::atomic<uint64_t> n_bursts_{0};
+  std::atomic<uint64_t> max_burst_{0};
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_STREAM_STATISTICS */
@@ -0,0 +1,123 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_SUB_IMAGE
+#define CAMERA_ARAVIS_SUB_IMAGE
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+
+#include <string.h> //memcpy
+
+namespace camera_aravis
+{
+
+// Rectangular region of ROS image without copy of pixel data.
+//
+// Published in place of sensor_msgs::Image and serialized as sensor_msgs/Image,
+// region rows are copied straight from parent image into outgoing message buffer.
+// Holds parent image (and pooled buffer behind it) until all subscribers are served.
+struct SubImage
+{
+  typedef boost::shared_ptr<SubImage> Ptr;
+  typedef boost::shared_ptr<SubImage const> ConstPtr;
+
+  sensor_msgs::ImageConstPtr parent;
+  uint32_t x_offset = 0;
+  uint32_t y_offset = 0;
+  uint32_t height = 0;
+  uint32_t width = 0;
+  // bytes per region row without padding
+  uint32_t step = 0;
+
+  inline const uint8_t* row(uint32_t r) const
+  {
+    return parent->data.data() + (y_offset + r) * parent->step + x_offset * (step / width);
+  }
+};
+
+// Region of image clipped to image bounds. Offsets are aligned to 2 pixels for
+// Bayer and YUV422 to keep color pattern. Returns empty pointer if nothing is left
+// or pixel size of encoding is unknown.
+SubImage::Ptr cropImage(const sensor_msgs::ImageConstPtr &image,
+                        uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height);
+
+} // end namespace camera_aravis
+
+namespace ros
+{
+namespace message_traits
+{
+
+template<> struct MD5Sum<camera_aravis::SubImage>
+{
+  static const char* value() { return MD5Sum<sensor_msgs::Image>::value(); }
+  static const char* value(const camera_aravis::SubImage&) { return value(); }
+};
+
+template<> struct DataType<camera_aravis::SubImage>
+{
+  static const char* value() { return DataType<sensor_msgs::Image>::value(); }
+  static const char* value(const camera_aravis::SubImage&) { return value(); }
+};
+
+template<> struct Definition<camera_aravis::SubImage>
+{
+  static const char* value() { return Definition<sensor_msgs::Image>::value(); }
+  static const char* value(const camera_aravis::SubImage&) { return value(); }
+};
+
+} // end namespace message_traits
+
+namespace serialization
+{
+
+// Publish only, field layout of sensor_msgs/Image.
+template<> struct Serializer<camera_aravis::SubImage>
+{
+  template<typename Stream>
+  inline static void write(Stream &stream, const camera_aravis::SubImage &img)
+  {
+    stream.next(img.parent->header);
+    stream.next(img.height);
+    stream.next(img.width);
+    stream.next(img.parent->encoding);
+    stream.next(img.parent->is_bigendian);
+    stream.next(img.step);
+    stream.next(img.step * img.height);
+    for (uint32_t r = 0; r < img.height; ++r)
+      memcpy(stream.advance(img.step), img.row(r), img.step);
+  }
+
+  inline static uint32_t serializedLength(const camera_aravis::SubImage &img)
+  {
+    return serializationLength(img.parent->header) + 4 + 4 + serializationLength(img.parent->encoding) +
+           1 + 4 + 4 + img.step * img.height;
+  }
+};
+
+} // end namespace serialization
+} // end namespace ros
+
+#endif /* CAMERA_ARAVIS_SUB_IMAGE */
@@ -0,0 +1,98 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_TONE_MAPPING
+#define CAMERA_ARAVIS_TONE_MAPPING
+
+#include <sensor_msgs/Image.h>
+
+#include <array>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <camera_aravis/conversion_utils.h>
+
+namespace camera_aravis
+{
+
+// 16 to 8 bit tone mapping through look-up table, for visualization.
+//
+// Full scale 16 bit values (MSB aligned, as produced by conversions) are mapped through
+// linear window [low, high], fixed or adapted to image content by sampled histogram,
+// followed by gamma. Packed 12 bit formats can be unpacked straight to 8 bit,
+// skipping 16 bit intermediate image.
+//
+// Not thread safe, intended to be owned by single substream.
+class ToneMapper
+{
+public:
+  struct Parameters
+  {
+    // window as fraction of full scale
+    double low = 0.0;
+    double high = 1.0;
+    // > 1 brightens dark tones
+    double gamma = 1.0;
+    // adapt window to histogram percentiles of each frame
+    bool auto_range = false;
+    double auto_low_percentile = 0.01;
+    double auto_high_percentile = 0.99;
+  };
+
+  explicit ToneMapper(const Parameters &parameters);
+
+  // 16 bit unsigned image to its 8 bit counterpart (e.g. mono16 -> mono8, bayer_rggb16 -> bayer_rggb8),
+  // 8 bit images are passed through. Output is reset if encoding can't be mapped.
+  void map(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out);
+
+  // Fused unpack and tone mapping of packed 12 bit pixel format to 8 bit encoding,
+  // empty function if pixel format has no fused variant.
+  ConversionFunction getFusedConversion(const std::string &pixel_format);
+
+private:
+  static const size_t N_HISTOGRAM_BINS = 256;
+  typedef std::array<uint32_t, N_HISTOGRAM_BINS> Histogram;
+
+  // every n-th value is sampled for histogram, prime to avoid aliasing with color patterns
+  static const size_t HISTOGRAM_SAMPLE_STRIDE = 61;
+
+  void unpack12p(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const bool gige_packed,
+                 const std::string out_format);
+  void updateRange(const Histogram &histogram);
+  void rebuild();
+
+  Parameters parameters_;
+  // current window, differs from parameters in auto range mode
+  double low_;
+  double high_;
+  // indexed by full scale 16 bit value
+  std::vector<uint8_t> lut_;
+  // indexed by 12 bit value, 4 KiB stays in L1 cache
+  std::vector<uint8_t> lut12_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_TONE_MAPPING */
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#ifndef CAMERA_ARAVIS_TRIGGER_SCHEDULER
+#define CAMERA_ARAVIS_TRIGGER_SCHEDULER
+
+#include <camera_aravis/frame_trace.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+namespace camera_aravis
+{
+
+// Counters and lateness percentiles since previous sample, taken at diagnostics update time.
+struct TriggerSchedulerStatisticsSample
+{
+  uint64_t n_fired = 0;
+  // ticks dropped after the thread overran more than a whole period
+  uint64_t n_skipped = 0;
+  // time from deadline to tick callback, since previous sample
+  uint64_t lateness_p50_ns = 0;
+  uint64_t lateness_p99_ns = 0;
+  uint64_t lateness_max_ns = 0;
+};
+
+// Fires a callback at a fixed rate from its own thread.
+//
+// Deadlines are absolute on the steady clock, tick k is due at origin + k * period with the period
+// kept in fractional nanoseconds, so any rate is met without rounding or drift. The thread sleeps
+// until spin_ns before a deadline and busy waits the rest, which trades a core for wake-up jitter.
+// A tick late by less than a period fires immediately; after a longer overrun the missed ticks are
+// skipped and the next one fires late, the grid of deadlines is kept.
+class TriggerScheduler
+{
+public:
+  typedef std::function<void()> TickCallback;
+
+  // priority is SCHED_FIFO priority of the thread, 0 keeps normal scheduling
+  TriggerScheduler(double rate_hz, uint64_t spin_ns, int priority, TickCallback on_tick);
+  ~TriggerScheduler();
+
+  TriggerScheduler(const TriggerScheduler &) = delete;
+  TriggerScheduler &operator=(const TriggerScheduler &) = delete;
+
+  void start();
+  void stop();
+
+  // takes effect after the pending tick, phase continues from its deadline
+  void setRate(double rate_hz);
+
+  TriggerSchedulerStatisticsSample sample();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  void threadMain();
+  // false if stopped before deadline
+  bool waitUntil(Clock::time_point deadline);
+
+  const uint64_t spin_ns_;
+  const int priority_;
+  const TickCallback on_tick_;
+
+  std::atomic<double> period_ns_;
+
+  std::atomic<bool> active_{false};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::thread thread_;
+
+  std::atomic<uint64_t> n_fired_{0};
+  std::atomic<uint64_t> n_skipped_{0};
+  std::mutex lateness_mutex_;
+  LatencyHistogram lateness_;
+};
+
+} // end namespace camera_aravis
+
+#endif /* CAMERA_ARAVIS_TRIGGER_SCHEDULER */
@@ -0,0 +1,189 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/action_command.h>
+
+#include <ros/ros.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h> //clock_gettime
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring> //memset, strerror
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+// GigE Vision control protocol, all fields big endian
+const uint8_t GVCP_KEY = 0x42;
+const uint8_t GVCP_FLAG_ACKNOWLEDGE = 0x01;
+const uint8_t GVCP_FLAG_SCHEDULED_ACTION = 0x80;
+const uint16_t GVCP_ACTION_CMD = 0x0100;
+const size_t GVCP_HEADER_SIZE = 8;
+
+void putBe16(std::vector<uint8_t> &packet, uint16_t value)
+{
+  packet.push_back(uint8_t(value >> 8));
+  packet.push_back(uint8_t(value));
+}
+
+void putBe32(std::vector<uint8_t> &packet, uint32_t value)
+{
+  putBe16(packet, uint16_t(value >> 16));
+  putBe16(packet, uint16_t(value));
+}
+
+} // end anonymous namespace
+
+std::vector<uint8_t> buildActionCommandPacket(const ActionCommand &command, uint16_t request_id)
+{
+  const uint16_t payload_size = command.scheduled ? 20 : 12;
+
+  std::vector<uint8_t> packet;
+  packet.reserve(GVCP_HEADER_SIZE + payload_size);
+
+  packet.push_back(GVCP_KEY);
+  packet.push_back((command.acknowledge ? GVCP_FLAG_ACKNOWLEDGE : 0) |
+                   (command.scheduled ? GVCP_FLAG_SCHEDULED_ACTION : 0));
+  putBe16(packet, GVCP_ACTION_CMD);
+  putBe16(packet, payload_size);
+  putBe16(packet, request_id);
+
+  putBe32(packet, command.device_key);
+  putBe32(packet, command.group_key);
+  putBe32(packet, command.group_mask);
+  if (command.scheduled)
+  {
+    putBe32(packet, uint32_t(command.action_time >> 32));
+    putBe32(packet, uint32_t(command.action_time));
+  }
+
+  return packet;
+}
+
+uint64_t actionCommandPtpNow()
+{
+  // PTP runs on TAI, phc2sys steers CLOCK_TAI to the grandmaster when the kernel tai offset is set
+  timespec now;
+  clock_gettime(CLOCK_TAI, &now);
+  return uint64_t(now.tv_sec) * 1000000000ull + uint64_t(now.tv_nsec);
+}
+
+ActionCommandSender::ActionCommandSender(const std::string &destination, const std::string &interface_address,
+                                         uint16_t port) :
+    destination_(destination), interface_address_(interface_address), port_(port)
+{
+}
+
+ActionCommandSender::~ActionCommandSender()
+{
+  if (socket_ >= 0)
+    close(socket_);
+}
+
+bool ActionCommandSender::open()
+{
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0)
+  {
+    ROS_ERROR("Failed to create GVCP action socket: %s", strerror(errno));
+    return false;
+  }
+
+  const int broadcast = 1;
+  setsockopt(socket_, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_);
+  if (inet_pton(AF_INET, destination_.c_str(), &address.sin_addr) != 1)
+  {
+    ROS_ERROR("%s is not an IPv4 address for action commands", destination_.c_str());
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  // leave through the camera network even if the default route points elsewhere
+  if (!interface_address_.empty())
+  {
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    if (inet_pton(AF_INET, interface_address_.c_str(), &local.sin_addr) != 1 ||
+        bind(socket_, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0)
+    {
+      ROS_ERROR("Failed to bind action commands to %s", interface_address_.c_str());
+      close(socket_);
+      socket_ = -1;
+      return false;
+    }
+  }
+
+  // fixed destination, send() then skips the address lookup
+  if (connect(socket_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    ROS_ERROR("Failed to address action commands to %s:%u: %s", destination_.c_str(), port_, strerror(errno));
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  ROS_INFO("Sending action commands to %s:%u", destination_.c_str(), port_);
+  return true;
+}
+
+bool ActionCommandSender::send(const ActionCommand &command)
+{
+  // 0 is not a valid GVCP request id
+  if (++request_id_ == 0)
+    request_id_ = 1;
+
+  const std::vector<uint8_t> packet = buildActionCommandPacket(command, request_id_);
+  if (socket_ < 0 || ::send(socket_, packet.data(), packet.size(), 0) != ssize_t(packet.size()))
+  {
+    n_failed_++;
+    return false;
+  }
+
+  n_sent_++;
+  return true;
+}
+
+ActionCommandStatisticsSample ActionCommandSender::sample() const
+{
+  ActionCommandStatisticsSample sample;
+  sample.n_sent = n_sent_;
+  sample.n_failed = n_failed_;
+  return sample;
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,797 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// Standalone benchmark of aravis buffer delivery, without ROS.
+//
+// Usage: cam_aravis_benchmark <mode> [--option=value ...]
+//
+// Modes:
+//   transfer  sweep stream buffer count (and USB mode for USB3 Vision devices),
+//             report achieved frame rate, throughput and CPU use
+//   delivery  compare buffer delivery through "new-buffer" signal (inline and
+//             dispatched to worker thread like substream threads) with
+//             dedicated thread on timed buffer pop, report wake-up latency
+//             (buffer system timestamp to consumer) and CPU use
+//   demosaic  throughput of in-driver Bayer demosaicing on synthetic 5, 12 and
+//             20 MP frames, 8 and 16 bit, against plain frame copy baseline
+//   depth     lossless depth compression, RVL against PNG and zstd, on recorded
+//             depth frames (--frames) or synthetic 16 bit depth with holes
+//
+// Options:
+//   --device=ID        camera to open, default is aravis fake camera "Fake_1"
+//   --duration=S       seconds per run, default 5
+//   --width=W          region width, default camera setting
+//   --height=H         region height, default camera setting
+//   --frame-rate=F     acquisition frame rate, default camera setting
+//   --buffers=N,N,...  stream buffer counts to sweep, default 2,4,8,16,32
+//   --iterations=N     frames per demosaic and depth run, default 50
+//   --frames=F,F,...   recorded depth frames for depth mode, 16 bit PNG/TIFF (16UC1)
+//                      or 32 bit float TIFF (32FC1, quantized by --depth-scale)
+//   --depth-scale=S    32FC1 depth quantization for RVL, default 1000 (m to mm)
+//
+// The fake camera serves as a loopback source for host side measurements,
+// connect a real device to measure link limits.
+
+extern "C" {
+#include <arv.h>
+}
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstring>
+
+#include <sensor_msgs/image_encodings.h>
+
+#include <camera_aravis/conversion_utils.h>
+#include <camera_aravis/frame_trace.h>
+#include <camera_aravis/image_codecs.h>
+
+#include <opencv2/imgcodecs.hpp> //cv::imread
+
+namespace camera_aravis
+{
+namespace benchmark
+{
+
+struct Options
+{
+  std::string device = "Fake_1";
+  double duration = 5.0;
+  int width = 0;
+  int height = 0;
+  double frame_rate = 0.0;
+  std::vector<int> buffers = {2, 4, 8, 16, 32};
+  int iterations = 50;
+  std::vector<std::string> frames;
+  double depth_scale = 1000.0;
+};
+
+struct RunResult
+{
+  uint64_t n_frames = 0;
+  uint64_t n_bytes = 0;
+  uint64_t n_failures = 0;
+  uint64_t n_underruns = 0;
+  double wall_s = 0.0;
+  double cpu_s = 0.0;
+};
+
+// Wall and process CPU time (all threads, including aravis stream thread).
+class CpuTimer
+{
+public:
+  CpuTimer() : wall_begin_(std::chrono::steady_clock::now()), cpu_begin_(processCpuSeconds()) {}
+
+  double wallSeconds() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_begin_).count();
+  }
+
+  double cpuSeconds() const
+  {
+    return processCpuSeconds() - cpu_begin_;
+  }
+
+private:
+  static double processCpuSeconds()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+  }
+
+  std::chrono::steady_clock::time_point wall_begin_;
+  double cpu_begin_;
+};
+
+bool checkError(GError *error, const char *what)
+{
+  if (!error)
+    return true;
+
+  fprintf(stderr, "%s failed: %s\n", what, error->message);
+  g_error_free(error);
+  return false;
+}
+
+std::vector<int> parseIntList(const std::string &list)
+{
+  std::vector<int> values;
+  size_t begin = 0;
+
+  while (begin < list.size())
+  {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos)
+      end = list.size();
+    values.push_back(std::atoi(list.substr(begin, end - begin).c_str()));
+    begin = end + 1;
+  }
+
+  return values;
+}
+
+std::vector<std::string> parseStringList(const std::string &list)
+{
+  std::vector<std::string> values;
+  size_t begin = 0;
+
+  while (begin < list.size())
+  {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos)
+      end = list.size();
+    values.push_back(list.substr(begin, end - begin));
+    begin = end + 1;
+  }
+
+  return values;
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 2; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos)
+    {
+      fprintf(stderr, "Unrecognized argument %s\n", arg.c_str());
+      return false;
+    }
+
+    const std::string key = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+
+    if (key == "device")
+      options.device = value;
+    else if (key == "duration")
+      options.duration = std::atof(value.c_str());
+    else if (key == "width")
+      options.width = std::atoi(value.c_str());
+    else if (key == "height")
+      options.height = std::atoi(value.c_str());
+    else if (key == "frame-rate")
+      options.frame_rate = std::atof(value.c_str());
+    else if (key == "buffers")
+    {
+      options.buffers = parseIntList(value);
+      if (options.buffers.empty() ||
+          std::any_of(options.buffers.begin(), options.buffers.end(), [](int n) { return n < 1; }))
+      {
+        fprintf(stderr, "Buffer counts have to be at least 1: %s\n", value.c_str());
+        return false;
+      }
+    }
+    else if (key == "iterations")
+      options.iterations = std::atoi(value.c_str());
+    else if (key == "frames")
+      options.frames = parseStringList(value);
+    else if (key == "depth-scale")
+      options.depth_scale = std::atof(value.c_str());
+    else
+    {
+      fprintf(stderr, "Unrecognized option %s\n", key.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+ArvCamera* openCamera(const Options &options)
+{
+  GError *error = nullptr;
+
+  if (options.device.compare(0, 5, "Fake_") == 0)
+    arv_enable_interface("Fake");
+
+  ArvCamera *p_camera = arv_camera_new(options.device.c_str(), &error);
+  if (!checkError(error, "Opening camera"))
+    return nullptr;
+
+  if (options.width > 0 && options.height > 0)
+  {
+    arv_camera_set_region(p_camera, 0, 0, options.width, options.height, &error);
+    checkError(error, "Setting region");
+    error = nullptr;
+  }
+
+  if (options.frame_rate > 0.0)
+  {
+    arv_camera_set_frame_rate(p_camera, options.frame_rate, &error);
+    checkError(error, "Setting frame rate");
+  }
+
+  return p_camera;
+}
+
+// Acquire for given duration with n_buffers queued, consuming buffers as fast as possible.
+bool runTransfer(ArvCamera *p_camera, size_t n_buffers, double duration, RunResult &result)
+{
+  GError *error = nullptr;
+
+  ArvStream *p_stream = arv_camera_create_stream(p_camera, nullptr, nullptr, &error);
+  if (!checkError(error, "Creating stream"))
+    return false;
+
+  const size_t payload = arv_camera_get_payload(p_camera, &error);
+  if (!checkError(error, "Reading payload"))
+  {
+    g_object_unref(p_stream);
+    return false;
+  }
+
+  for (size_t i = 0; i < n_buffers; ++i)
+    arv_stream_push_buffer(p_stream, arv_buffer_new(payload, nullptr));
+
+  arv_camera_start_acquisition(p_camera, &error);
+  if (!checkError(error, "Starting acquisition"))
+  {
+    g_object_unref(p_stream);
+    return false;
+  }
+
+  const guint64 POP_TIMEOUT_US = 100000;
+  CpuTimer timer;
+
+  while (timer.wallSeconds() < duration)
+  {
+    ArvBuffer *p_buffer = arv_stream_timeout_pop_buffer(p_stream, POP_TIMEOUT_US);
+    if (!p_buffer)
+      continue;
+
+    if (arv_buffer_get_status(p_buffer) == ARV_BUFFER_STATUS_SUCCESS)
+    {
+      size_t size = 0;
+      arv_buffer_get_data(p_buffer, &size);
+      ++result.n_frames;
+      result.n_bytes += size;
+    }
+
+    arv_stream_push_buffer(p_stream, p_buffer);
+  }
+
+  result.wall_s = timer.wallSeconds();
+  result.cpu_s = timer.cpuSeconds();
+
+  arv_camera_stop_acquisition(p_camera, &error);
+  checkError(error, "Stopping acquisition");
+
+  guint64 n_completed = 0, n_failures = 0, n_underruns = 0;
+  arv_stream_get_statistics(p_stream, &n_completed, &n_failures, &n_underruns);
+  result.n_failures = n_failures;
+  result.n_underruns = n_underruns;
+
+  g_object_unref(p_stream);
+  return true;
+}
+
+void printResultHeader()
+{
+  printf("%-8s %8s %10s %10s %8s %10s %10s\n",
+         "mode", "buffers", "fps", "MB/s", "CPU %", "failures", "underruns");
+}
+
+void printResult(const char *mode, size_t n_buffers, const RunResult &result)
+{
+  const double BYTES_IN_MB = 1024.0 * 1024.0;
+
+  printf("%-8s %8zu %10.1f %10.1f %8.1f %10lu %10lu\n", mode, n_buffers,
+         result.n_frames / result.wall_s,
+         result.n_bytes / BYTES_IN_MB / result.wall_s,
+         100.0 * result.cpu_s / result.wall_s,
+         (unsigned long)result.n_failures, (unsigned long)result.n_underruns);
+}
+
+enum DeliveryMode
+{
+  DELIVERY_SIGNAL,          // consume in signal callback
+  DELIVERY_SIGNAL_DISPATCH, // signal callback hands over to worker thread
+  DELIVERY_POP              // dedicated thread on timed pop
+};
+
+struct DeliveryContext
+{
+  ArvStream *p_stream = nullptr;
+  LatencyHistogram latency;
+  uint64_t n_frames = 0;
+
+  // signal dispatch handover, same pattern as driver substream threads
+  std::mutex mutex;
+  std::condition_variable ready;
+  ArvBuffer *p_pending = nullptr;
+  std::atomic<bool> stop{false};
+};
+
+void consumeBuffer(DeliveryContext &ctx, ArvBuffer *p_buffer)
+{
+  if (arv_buffer_get_status(p_buffer) == ARV_BUFFER_STATUS_SUCCESS)
+  {
+    ctx.latency.add(frameTraceInterval(arv_buffer_get_system_timestamp(p_buffer), frameTraceNow()));
+    ++ctx.n_frames;
+  }
+  arv_stream_push_buffer(ctx.p_stream, p_buffer);
+}
+
+void signalCallback(ArvStream *p_stream, gpointer user_data)
+{
+  DeliveryContext &ctx = *static_cast<DeliveryContext*>(user_data);
+  ArvBuffer *p_buffer = arv_stream_try_pop_buffer(p_stream);
+  if (p_buffer)
+    consumeBuffer(ctx, p_buffer);
+}
+
+void signalDispatchCallback(ArvStream *p_stream, gpointer user_data)
+{
+  DeliveryContext &ctx = *static_cast<DeliveryContext*>(user_data);
+  ArvBuffer *p_buffer = arv_stream_try_pop_buffer(p_stream);
+  if (!p_buffer)
+    return;
+
+  ArvBuffer *p_dropped = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(ctx.mutex);
+    p_dropped = ctx.p_pending;
+    ctx.p_pending = p_buffer;
+  }
+  ctx.ready.notify_one();
+
+  if (p_dropped)
+    arv_stream_push_buffer(p_stream, p_dropped);
+}
+
+void dispatchWorkerMain(DeliveryContext &ctx)
+{
+  using namespace std::chrono_literals;
+
+  while (!ctx.stop)
+  {
+    std::unique_lock<std::mutex> lock(ctx.mutex);
+    if (!ctx.ready.wait_for(lock, 100ms, [&ctx] { return ctx.p_pending != nullptr; }))
+      continue;
+
+    ArvBuffer *p_buffer = ctx.p_pending;
+    ctx.p_pending = nullptr;
+    lock.unlock();
+
+    consumeBuffer(ctx, p_buffer);
+  }
+}
+
+void popThreadMain(DeliveryContext &ctx)
+{
+  const guint64 POP_TIMEOUT_US = 100000;
+
+  while (!ctx.stop)
+  {
+    ArvBuffer *p_buffer = arv_stream_timeout_pop_buffer(ctx.p_stream, POP_TIMEOUT_US);
+    if (p_buffer)
+      consumeBuffer(ctx, p_buffer);
+  }
+}
+
+bool runDelivery(ArvCamera *p_camera, DeliveryMode mode, size_t n_buffers, double duration,
+                 DeliveryContext &ctx, RunResult &result)
+{
+  GError *error = nullptr;
+
+  ctx.p_stream = arv_camera_create_stream(p_camera, nullptr, nullptr, &error);
+  if (!checkError(error, "Creating stream"))
+    return false;
+
+  const size_t payload = arv_camera_get_payload(p_camera, &error);
+  if (!checkError(error, "Reading payload"))
+  {
+    g_object_unref(ctx.p_stream);
+    return false;
+  }
+
+  for (size_t i = 0; i < n_buffers; ++i)
+    arv_stream_push_buffer(ctx.p_stream, arv_buffer_new(payload, nullptr));
+
+  std::thread worker;
+
+  if (mode == DELIVERY_POP)
+    worker = std::thread(popThreadMain, std::ref(ctx));
+  else
+  {
+    if (mode == DELIVERY_SIGNAL_DISPATCH)
+      worker = std::thread(dispatchWorkerMain, std::ref(ctx));
+
+    g_signal_connect(ctx.p_stream, "new-buffer",
+                     mode == DELIVERY_SIGNAL ? (GCallback)signalCallback : (GCallback)signalDispatchCallback, &ctx);
+    arv_stream_set_emit_signals(ctx.p_stream, TRUE);
+  }
+
+  arv_camera_start_acquisition(p_camera, &error);
+  const bool started = checkError(error, "Starting acquisition");
+  error = nullptr;
+
+  CpuTimer timer;
+
+  if (started)
+    std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+
+  result.wall_s = timer.wallSeconds();
+  result.cpu_s = timer.cpuSeconds();
+
+  arv_camera_stop_acquisition(p_camera, &error);
+  checkError(error, "Stopping acquisition");
+
+  arv_stream_set_emit_signals(ctx.p_stream, FALSE);
+  ctx.stop = true;
+  if (worker.joinable())
+    worker.join();
+
+  if (ctx.p_pending)
+    arv_stream_push_buffer(ctx.p_stream, ctx.p_pending);
+
+  result.n_frames = ctx.n_frames;
+
+  g_object_unref(ctx.p_stream);
+  return started;
+}
+
+int benchmarkDelivery(const Options &options)
+{
+  const double NS_IN_US = 1000.0;
+
+  ArvCamera *p_camera = openCamera(options);
+  if (!p_camera)
+    return EXIT_FAILURE;
+
+  const std::vector<std::pair<const char*, DeliveryMode>> modes = {
+    {"signal", DELIVERY_SIGNAL},
+    {"dispatch", DELIVERY_SIGNAL_DISPATCH},
+    {"pop", DELIVERY_POP},
+  };
+
+  printf("%-8s %8s %10s %10s %10s %10s %8s\n",
+         "mode", "buffers", "fps", "p50 us", "p99 us", "max us", "CPU %");
+
+  for (int n_buffers : options.buffers)
+  {
+    for (const auto &mode : modes)
+    {
+      DeliveryContext ctx;
+      RunResult result;
+
+      if (!runDelivery(p_camera, mode.second, n_buffers, options.duration, ctx, result))
+      {
+        g_object_unref(p_camera);
+        return EXIT_FAILURE;
+      }
+
+      printf("%-8s %8d %10.1f %10.1f %10.1f %10.1f %8.1f\n", mode.first, n_buffers,
+             result.n_frames / result.wall_s,
+             ctx.latency.percentile(0.5) / NS_IN_US,
+             ctx.latency.percentile(0.99) / NS_IN_US,
+             ctx.latency.max() / NS_IN_US,
+             100.0 * result.cpu_s / result.wall_s);
+    }
+  }
+
+  g_object_unref(p_camera);
+  return EXIT_SUCCESS;
+}
+
+int benchmarkTransfer(const Options &options)
+{
+  ArvCamera *p_camera = openCamera(options);
+  if (!p_camera)
+    return EXIT_FAILURE;
+
+  std::vector<std::pair<const char*, int>> usb_modes = {{"default", -1}};
+
+#if ARAVIS_CHECK_VERSION(0, 8, 17)
+  if (arv_camera_is_uv_device(p_camera))
+    usb_modes = {{"sync", ARV_UV_USB_MODE_SYNC}, {"async", ARV_UV_USB_MODE_ASYNC}};
+#endif
+
+  printResultHeader();
+
+  for (const auto &usb_mode : usb_modes)
+  {
+#if ARAVIS_CHECK_VERSION(0, 8, 17)
+    if (usb_mode.second >= 0)
+      arv_uv_device_set_usb_mode(ARV_UV_DEVICE(arv_camera_get_device(p_camera)),
+                                 static_cast<ArvUvUsbMode>(usb_mode.second));
+#endif
+
+    for (int n_buffers : options.buffers)
+    {
+      RunResult result;
+      if (!runTransfer(p_camera, n_buffers, options.duration, result))
+      {
+        g_object_unref(p_camera);
+        return EXIT_FAILURE;
+      }
+      printResult(usb_mode.first, n_buffers, result);
+    }
+  }
+
+  g_object_unref(p_camera);
+  return EXIT_SUCCESS;
+}
+
+int benchmarkDemosaic(const Options &options)
+{
+  namespace enc = sensor_msgs::image_encodings;
+  const double NS_IN_MS = 1e6;
+
+  const std::vector<std::pair<const char*, std::pair<uint32_t, uint32_t>>> sizes = {
+    {"5MP", {2592, 1944}},
+    {"12MP", {4000, 3000}},
+    {"20MP", {5472, 3648}},
+  };
+
+  const std::vector<std::pair<std::string, std::string>> depths = {
+    {enc::BAYER_RGGB8, enc::BGR8},
+    {enc::BAYER_RGGB16, enc::BGR16},
+  };
+
+  // copy is the baseline of a full frame pass over memory
+  const std::vector<std::string> methods = {"copy", "bilinear", "edge_aware"};
+
+  printf("%-6s %-14s %-10s %10s %10s %8s\n", "size", "encoding", "method", "ms/frame", "MP/s", "CPU %");
+
+  for (const auto &size : sizes)
+  {
+    for (const auto &depth : depths)
+    {
+      sensor_msgs::ImagePtr in(new sensor_msgs::Image);
+      in->encoding = depth.first;
+      in->width = size.second.first;
+      in->height = size.second.second;
+      in->step = in->width * (enc::bitDepth(depth.first) / 8);
+      in->data.resize(in->height * in->step);
+
+      // deterministic noise, content does not change demosaicing cost
+      uint32_t state = 1;
+      for (uint8_t &byte : in->data)
+      {
+        state = state * 1664525u + 1013904223u;
+        byte = state >> 24;
+      }
+
+      for (const auto &method : methods)
+      {
+        ConversionFunction demosaic;
+        if (method != "copy")
+          demosaic = std::bind(&demosaicImg, std::placeholders::_1, std::placeholders::_2,
+                               method == "edge_aware", depth.second);
+
+        sensor_msgs::ImagePtr out(new sensor_msgs::Image);
+        LatencyHistogram frame_time;
+        CpuTimer timer;
+
+        for (int i = 0; i < options.iterations; ++i)
+        {
+          const uint64_t begin = frameTraceNow();
+          if (demosaic)
+            demosaic(in, out);
+          else
+          {
+            out->data.resize(in->data.size());
+            memcpy(out->data.data(), in->data.data(), in->data.size());
+          }
+          frame_time.add(frameTraceInterval(begin, frameTraceNow()));
+        }
+
+        const double wall_s = timer.wallSeconds();
+        const double megapixels = in->width * in->height * 1e-6;
+
+        printf("%-6s %-14s %-10s %10.2f %10.1f %8.1f\n", size.first, depth.first.c_str(), method.c_str(),
+               frame_time.percentile(0.5) / NS_IN_MS,
+               megapixels * options.iterations / wall_s,
+               100.0 * timer.cpuSeconds() / wall_s);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Recorded depth frames, or synthetic tilted surface with ripples and invalid (zero) blobs
+std::vector<std::pair<std::string, sensor_msgs::ImagePtr>> loadDepthFrames(const Options &options)
+{
+  namespace enc = sensor_msgs::image_encodings;
+  std::vector<std::pair<std::string, sensor_msgs::ImagePtr>> frames;
+
+  for (const std::string &path : options.frames)
+  {
+    const cv::Mat mat = cv::imread(path, cv::IMREAD_UNCHANGED);
+    if (mat.empty() || (mat.type() != CV_16UC1 && mat.type() != CV_32FC1))
+    {
+      fprintf(stderr, "Skipping %s, expected single channel 16 bit or float image\n", path.c_str());
+      continue;
+    }
+
+    sensor_msgs::ImagePtr image(new sensor_msgs::Image);
+    image->encoding = mat.type() == CV_16UC1 ? enc::TYPE_16UC1 : enc::TYPE_32FC1;
+    image->width = mat.cols;
+    image->height = mat.rows;
+    image->step = mat.cols * mat.elemSize();
+    image->data.resize(image->height * image->step);
+    for (int r = 0; r < mat.rows; ++r)
+      memcpy(image->data.data() + r * image->step, mat.ptr<uint8_t>(r), image->step);
+
+    const size_t slash = path.find_last_of('/');
+    frames.push_back({slash == std::string::npos ? path : path.substr(slash + 1), image});
+  }
+
+  if (!options.frames.empty())
+    return frames;
+
+  // Photoneo MotionCam-3D M+ resolutions
+  const std::vector<std::pair<const char*, std::pair<uint32_t, uint32_t>>> sizes = {
+    {"synthetic-0.5MP", {1120, 800}},
+    {"synthetic-2MP", {1680, 1200}},
+  };
+
+  for (const auto &size : sizes)
+  {
+    sensor_msgs::ImagePtr image(new sensor_msgs::Image);
+    image->encoding = enc::TYPE_16UC1;
+    image->width = size.second.first;
+    image->height = size.second.second;
+    image->step = image->width * sizeof(uint16_t);
+    image->data.resize(image->height * image->step);
+
+    uint16_t *depth = reinterpret_cast<uint16_t*>(image->data.data());
+    for (uint32_t y = 0; y < image->height; ++y)
+      for (uint32_t x = 0; x < image->width; ++x)
+      {
+        const bool hole = std::sin(x * 0.013) * std::cos(y * 0.021) > 0.8;
+        depth[y * image->width + x] = hole ? 0 : 800 + x / 4 + y / 8 + 5 * std::sin(x * 0.05 + y * 0.03);
+      }
+
+    frames.push_back({size.first, image});
+  }
+
+  return frames;
+}
+
+int benchmarkDepth(const Options &options)
+{
+  const double NS_IN_MS = 1e6;
+
+  std::vector<std::string> codecs = {"rvl", "png"};
+  if (codecAvailable("zstd"))
+    codecs.push_back("zstd");
+
+  const std::vector<std::pair<std::string, sensor_msgs::ImagePtr>> frames = loadDepthFrames(options);
+  if (frames.empty())
+    return EXIT_FAILURE;
+
+  printf("%-24s %-6s %-6s %10s %10s %8s %10s\n", "frame", "enc", "codec", "enc ms", "dec ms", "ratio", "enc MB/s");
+
+  for (const auto &frame : frames)
+  {
+    for (const std::string &codec : codecs)
+    {
+      CodecParameters params;
+      params.depth_codec = codec == "rvl" ? "rvl" : "none";
+      params.lossless_codec = codec == "rvl" ? "png" : codec;
+      params.depth_scale = options.depth_scale;
+
+      sensor_msgs::CompressedImage compressed;
+      sensor_msgs::Image decoded;
+      LatencyHistogram encode_time, decode_time;
+      bool ok = true;
+
+      for (int i = 0; i < options.iterations && ok; ++i)
+      {
+        uint64_t begin = frameTraceNow();
+        ok = encodeImage(*frame.second, params, compressed);
+        encode_time.add(frameTraceInterval(begin, frameTraceNow()));
+
+        begin = frameTraceNow();
+        ok = ok && decodeImage(compressed, decoded);
+        decode_time.add(frameTraceInterval(begin, frameTraceNow()));
+      }
+
+      if (!ok)
+      {
+        printf("%-24s %-6s %-6s %10s\n", frame.first.c_str(), frame.second->encoding.c_str(), codec.c_str(), "n/a");
+        continue;
+      }
+
+      const double encode_ms = encode_time.percentile(0.5) / NS_IN_MS;
+      printf("%-24s %-6s %-6s %10.2f %10.2f %8.2f %10.1f\n", frame.first.c_str(), frame.second->encoding.c_str(),
+             codec.c_str(), encode_ms, decode_time.percentile(0.5) / NS_IN_MS,
+             double(frame.second->data.size()) / compressed.data.size(),
+             frame.second->data.size() / (1024.0 * 1024.0) / (encode_ms * 1e-3));
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+} // end namespace benchmark
+} // end namespace camera_aravis
+
+int main(int argc, char **argv)
+{
+  using namespace camera_aravis::benchmark;
+
+  const std::map<std::string, std::function<int(const Options&)>> modes = {
+    {"transfer", benchmarkTransfer},
+    {"delivery", benchmarkDelivery},
+    {"demosaic", benchmarkDemosaic},
+    {"depth", benchmarkDepth},
+  };
+
+  Options options;
+
+  if (argc < 2 || !modes.count(argv[1]) || !parseOptions(argc, argv, options))
+  {
+    fprintf(stderr, "Usage: %s <mode> [--option=value ...]\nModes:", argv[0]);
+    for (const auto &mode : modes)
+      fprintf(stderr, " %s", mode.first.c_str());
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+  }
+
+  const int res = modes.at(argv[1])(options);
+  arv_shutdown();
+  return res;
+}
@@ -25,10 +25,11 @@
 #include <memory>
 #include <unordered_set>
 #include <chrono>
+#include <ctime> //std::strftime
 
-//Enable simple buffer processing benchmark output
-//This covers color conversion + ROS publishing + ...
-//#define ARAVIS_BUFFER_PROCESSING_BENCHMARK
+#include <pthread.h>
+#include <sys/stat.h> //mkdir
+#include <arpa/inet.h> //inet_pton
 
 #define ROS_ASSERT_ENABLED
 #include <ros/console.h>
@@ -65,6 +66,141 @@ namespace camera_aravis
 {
   using GErrorGuard = std::unique_ptr<GError*, void (*)(GError**)>;
 
+  FrameLossReason frameLossReasonFromStatus(ArvBufferStatus status) {
+    switch(status)
+    {
+      case ARV_BUFFER_STATUS_TIMEOUT:
+        return LOSS_TIMEOUT;
+      case ARV_BUFFER_STATUS_MISSING_PACKETS:
+      case ARV_BUFFER_STATUS_WRONG_PACKET_ID:
+        return LOSS_MISSING_PACKETS;
+      case ARV_BUFFER_STATUS_SIZE_MISMATCH:
+        return LOSS_SIZE_MISMATCH;
+      default:
+        return LOSS_OTHER;
+    }
+  }
+
+  // CameraInfo of image binned in software by factor, binning 0 is same as 1
+  sensor_msgs::CameraInfoPtr binnedCameraInfo(const sensor_msgs::CameraInfo &camera_info, uint32_t factor) {
+    sensor_msgs::CameraInfoPtr binned(new sensor_msgs::CameraInfo(camera_info));
+    binned->binning_x = std::max<uint32_t>(binned->binning_x, 1) * factor;
+    binned->binning_y = std::max<uint32_t>(binned->binning_y, 1) * factor;
+    return binned;
+  }
+
+  // pixel correction maps of camera_info_url calibration, [name].yaml -> [name]_correction.yml,
+  // only file:// and plain paths are resolved
+  std::string pixelCorrectionPath(const std::string &calib_url) {
+    std::string path = calib_url;
+    if (path.compare(0, 7, "file://") == 0)
+      path.erase(0, 7);
+    else if (path.find("://") != std::string::npos)
+      return std::string();
+
+    const size_t extension = path.find_last_of('.');
+    if (extension != std::string::npos && path.find('/', extension) == std::string::npos)
+      path.erase(extension);
+    return path.empty() ? path : path + "_correction.yml";
+  }
+
+  // new recording directory [parent]/[YYYYmmdd_HHMMSS_mmm], parent is created if missing
+  std::string timestampedDirectory(const std::string &parent) {
+    const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+    const std::time_t now_s = std::chrono::system_clock::to_time_t(now);
+    const long ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+
+    char stamp[32];
+    const size_t n = std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now_s));
+    snprintf(stamp + n, sizeof(stamp) - n, "_%03ld", ms);
+    mkdir(parent.c_str(), 0755);
+    return parent + "/" + stamp;
+  }
+
+  bool endsWith(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  bool isSelectorFeature(const std::string &feature) {
+    return endsWith(feature, "Selector");
+  }
+
+  // batch write stage: switches gating other features, then formats bounding the image size, then size
+  int featureWriteRank(const std::string &feature) {
+    if (endsWith(feature, "Auto") || endsWith(feature, "Enable"))
+      return 0;
+    if (feature == "PixelFormat" || feature.compare(0, 7, "Binning") == 0 || feature.compare(0, 10, "Decimation") == 0)
+      return 1;
+    if (feature == "Width" || feature == "Height")
+      return 2;
+    return 3;
+  }
+
+  // Split batch into groups of a selector run with the values following it, ordered by write stage.
+  // A group keeps request order, so GainSelector Red, Gain, GainSelector Blue, Gain stays intact.
+  // Next selector ends the group, so does a feature with its own write stage unless it is named after
+  // the selector (ChunkSelector, ChunkEnable) or selected by RegionSelector, it is written on its own then.
+  std::vector<std::vector<size_t>> featureWriteGroups(const std::vector<FeatureValue> &features) {
+    std::vector<std::vector<size_t>> groups;
+    std::vector<std::string> selected; // feature name stems of current selector run
+    bool after_selector = false;
+    for (size_t i = 0; i < features.size(); i++)
+    {
+      const std::string &feature = features[i].feature;
+      if (isSelectorFeature(feature))
+      {
+        if (!after_selector)
+        {
+          groups.emplace_back();
+          selected.clear();
+        }
+        selected.push_back(feature.substr(0, feature.size() - 8));
+        after_selector = true;
+      }
+      else
+      {
+        const bool dependent = std::any_of(selected.begin(), selected.end(),
+                                           [&feature](const std::string &stem)
+                                           { return stem == "Region" ||
+                                                    (!stem.empty() && feature.compare(0, stem.size(), stem) == 0); });
+        if (selected.empty() || (featureWriteRank(feature) < 3 && !dependent))
+        {
+          groups.emplace_back();
+          selected.clear();
+        }
+        after_selector = false;
+      }
+      groups.back().push_back(i);
+    }
+
+    auto rank = [&features](const std::vector<size_t> &group) {
+      int r = 3;
+      for (size_t i : group)
+        r = std::min(r, featureWriteRank(features[i].feature));
+      return r;
+    };
+    std::stable_sort(groups.begin(), groups.end(),
+                     [&rank](const std::vector<size_t> &a, const std::vector<size_t> &b) { return rank(a) < rank(b); });
+    return groups;
+  }
+
+  bool sameFeatureValue(const FeatureValue &a, const FeatureValue &b) {
+    switch (a.type)
+    {
+      case FeatureValue::INTEGER:
+        return a.integer_value == b.integer_value;
+      case FeatureValue::FLOAT:
+        // float features read back with the device's own rounding
+        return std::abs(a.float_value - b.float_value) <= 1e-9 * std::max(1.0, std::abs(b.float_value));
+      case FeatureValue::STRING:
+        return a.string_value == b.string_value;
+      case FeatureValue::BOOLEAN:
+        return a.boolean_value == b.boolean_value;
+      default:
+        return false;
+    }
+  }
+
   GErrorGuard makeGErrorGuard() {
       return GErrorGuard(nullptr, [](GErrorGuard::pointer error) {
           if (error && *error) g_error_free(*error);
@@ -108,77 +244,136 @@ namespace camera_aravis
 namespace aravis {
   const std::string logger_suffix = "aravis";
 
+  // Feature access goes through the control channel the device handle is attached to (if any).
+  // Reads return the cached value of a coalesced telemetry read, writes update selector state.
+  template<class Read>
+  ControlChannel::Value control_read(const void* handle, const char* feat, Read read) {
+    ControlChannel* channel = ControlChannel::find(handle);
+    ControlTransaction transaction(channel);
+    ControlChannel::Value value;
+    if (channel && channel->cachedRead(feat, value))
+      return value;
+    if (read(value) && channel)
+      channel->storeRead(feat, value);
+    return value;
+  }
+
+  // selector state follows only writes the device accepted
+  template<class Write>
+  void control_write(const void* handle, const char* feat, const std::string& val, Write write) {
+    ControlChannel* channel = ControlChannel::find(handle);
+    ControlTransaction transaction(channel);
+    if (write() && channel)
+      channel->wrote(feat, val);
+  }
+
+  // access without caching, e.g. bounds and enumerations
+  template<class Access>
+  void control_access(const void* handle, Access access) {
+    ControlTransaction transaction(ControlChannel::find(handle));
+    access();
+  }
+
   namespace device {
+    // commands leave cached reads, TriggerSoftware at frame rate would defeat coalescing otherwise
     void execute_command(ArvDevice* dev, const char* cmd) {
+      control_access(dev, [&] {
         GuardedGError err;
         arv_device_execute_command(dev, cmd, err.storeError());
         LOG_GERROR_ARAVIS(err);
+      });
     }
 
     namespace feature {          
       gboolean get_boolean(ArvDevice* dev, const char* feat) {
-        GuardedGError err;
-        gboolean res = arv_device_get_boolean_feature_value(dev, feat, err.storeError());
-        LOG_GERROR_ARAVIS(err);
-        return res;
+        return control_read(dev, feat, [&](ControlChannel::Value& value) {
+          GuardedGError err;
+          value.boolean = arv_device_get_boolean_feature_value(dev, feat, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        }).boolean;
       }
 
       void set_boolean(ArvDevice* dev, const char* feat, gboolean val) {
-        GuardedGError err;
-        arv_device_set_boolean_feature_value(dev, feat, val, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_write(dev, feat, val ? "true" : "false", [&] {
+          GuardedGError err;
+          arv_device_set_boolean_feature_value(dev, feat, val, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        });
       }
 
       gint64 get_integer(ArvDevice* dev, const char* feat) {
-        GuardedGError err;
-        gint64 res = arv_device_get_integer_feature_value(dev, feat, err.storeError());
-        LOG_GERROR_ARAVIS(err);
-        return res;
+        return control_read(dev, feat, [&](ControlChannel::Value& value) {
+          GuardedGError err;
+          value.integer = arv_device_get_integer_feature_value(dev, feat, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        }).integer;
       }
 
       void set_integer(ArvDevice* dev, const char* feat, gint64 val) {
-        GuardedGError err;
-        arv_device_set_integer_feature_value(dev, feat, val, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_write(dev, feat, std::to_string(val), [&] {
+          GuardedGError err;
+          arv_device_set_integer_feature_value(dev, feat, val, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        });
       }
 
       double get_float(ArvDevice* dev, const char* feat) {
-        GuardedGError err;
-        double res = arv_device_get_float_feature_value(dev, feat, err.storeError());
-        LOG_GERROR_ARAVIS(err);
-        return res;
+        return control_read(dev, feat, [&](ControlChannel::Value& value) {
+          GuardedGError err;
+          value.real = arv_device_get_float_feature_value(dev, feat, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        }).real;
       }
 
       void set_float(ArvDevice* dev, const char* feat, double val) {
-        GuardedGError err;
-        arv_device_set_float_feature_value(dev, feat, val, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_write(dev, feat, std::to_string(val), [&] {
+          GuardedGError err;
+          arv_device_set_float_feature_value(dev, feat, val, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        });
       }
 
-      const char* get_string(ArvDevice* dev, const char* feat) {
-        GuardedGError err;
-        const char* res = arv_device_get_string_feature_value(dev, feat, err.storeError());
-        LOG_GERROR_ARAVIS(err);
-        return res;
+      // copied out, aravis reuses its string once another thread accesses the feature
+      std::string get_string(ArvDevice* dev, const char* feat) {
+        return control_read(dev, feat, [&](ControlChannel::Value& value) {
+          GuardedGError err;
+          const char* res = arv_device_get_string_feature_value(dev, feat, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          value.text = res ? res : "";
+          return !err;
+        }).text;
       }
 
       void set_string(ArvDevice* dev, const char* feat, const char* val) {
-        GuardedGError err;
-        arv_device_set_string_feature_value(dev, feat, val, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_write(dev, feat, val, [&] {
+          GuardedGError err;
+          arv_device_set_string_feature_value(dev, feat, val, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        });
       }
 
       namespace bounds {
         void get_integer(ArvDevice* dev, const char* feat, gint64* min, gint64* max) {
-          GuardedGError err;
-          arv_device_get_integer_feature_bounds(dev, feat, min, max, err.storeError());
-          LOG_GERROR_ARAVIS(err);
+          control_access(dev, [&] {
+            GuardedGError err;
+            arv_device_get_integer_feature_bounds(dev, feat, min, max, err.storeError());
+            LOG_GERROR_ARAVIS(err);
+          });
         }
 
         void get_float(ArvDevice* dev, const char* feat, double* min, double* max) {
+          control_access(dev, [&] {
             GuardedGError err;
             arv_device_get_float_feature_bounds(dev, feat, min, max, err.storeError());
             LOG_GERROR_ARAVIS(err);
+          });
         }
       }
     }
@@ -195,93 +390,130 @@ namespace aravis {
   namespace camera {
 
     const char* get_vendor_name(ArvCamera *cam) {
-      GuardedGError err;
-      const char* res = arv_camera_get_vendor_name(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      const char* res = nullptr;
+      control_access(cam, [&] {
+        GuardedGError err;
+        res = arv_camera_get_vendor_name(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+      });
       return res;
     }
 
     gint64 get_payload(ArvCamera *cam) {
-      GuardedGError err;
-      gint64 res = arv_camera_get_payload(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
-      return res;
+      return control_read(cam, "PayloadSize", [&](ControlChannel::Value& value) {
+        GuardedGError err;
+        value.integer = arv_camera_get_payload(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      }).integer;
     }
 
     double get_frame_rate(ArvCamera *cam) {
-      GuardedGError err;
-      double res = arv_camera_get_frame_rate(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
-      return res;
+      return control_read(cam, "AcquisitionFrameRate", [&](ControlChannel::Value& value) {
+        GuardedGError err;
+        value.real = arv_camera_get_frame_rate(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      }).real;
     }
 
     void set_frame_rate(ArvCamera *cam, double val) {
-      GuardedGError err;
-      arv_camera_set_frame_rate(cam, val, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "AcquisitionFrameRate", std::to_string(val), [&] {
+        GuardedGError err;
+        arv_camera_set_frame_rate(cam, val, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     double get_exposure_time(ArvCamera *cam){
-      GuardedGError err;
-      double res = arv_camera_get_exposure_time(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
-      return res;
+      return control_read(cam, "ExposureTime", [&](ControlChannel::Value& value) {
+        GuardedGError err;
+        value.real = arv_camera_get_exposure_time(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      }).real;
     }
 
     void set_exposure_time(ArvCamera *cam, double val){
-      GuardedGError err;
-      arv_camera_set_exposure_time(cam, val, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "ExposureTime", std::to_string(val), [&] {
+        GuardedGError err;
+        arv_camera_set_exposure_time(cam, val, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     double get_gain(ArvCamera *cam){
-      GuardedGError err;
-      double res = arv_camera_get_gain(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
-      return res;
+      return control_read(cam, "Gain", [&](ControlChannel::Value& value) {
+        GuardedGError err;
+        value.real = arv_camera_get_gain(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      }).real;
     }
 
     void set_gain(ArvCamera *cam, double val){
-      GuardedGError err;
-      arv_camera_set_gain(cam, val, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "Gain", std::to_string(val), [&] {
+        GuardedGError err;
+        arv_camera_set_gain(cam, val, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     void get_region(ArvCamera* cam, gint* x, gint* y, gint* width, gint* height) {
+      control_access(cam, [&] {
         GuardedGError err;
         arv_camera_get_region(cam, x, y, width, height, err.storeError());
         LOG_GERROR_ARAVIS(err);
+      });
     }
 
     void set_region(ArvCamera* cam, gint x, gint y, gint width, gint height) {
-      GuardedGError err;
-      arv_camera_set_region(cam, x, y, width, height, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "Region", "", [&] {
+        GuardedGError err;
+        arv_camera_set_region(cam, x, y, width, height, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     void get_sensor_size(ArvCamera* cam, gint* width, gint* height) {
+      control_access(cam, [&] {
         GuardedGError err;
         arv_camera_get_sensor_size(cam, width, height, err.storeError());
         LOG_GERROR_ARAVIS(err);
+      });
     }
 
     ArvStream* create_stream(ArvCamera* cam, ArvStreamCallback callback, void* user_data) {
-      GuardedGError err;
-      ArvStream* res = arv_camera_create_stream(cam, callback, user_data, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      ArvStream* res = nullptr;
+      control_write(cam, "StreamCreate", "", [&] {
+        GuardedGError err;
+        res = arv_camera_create_stream(cam, callback, user_data, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
       return res;
     }
 
     void start_acquisition(ArvCamera* cam) {
-      GuardedGError err;
-      arv_camera_start_acquisition(cam, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "AcquisitionStart", "", [&] {
+        GuardedGError err;
+        arv_camera_start_acquisition(cam, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     void set_multipart_output_format(ArvCamera *cam, bool enable) {
-      GuardedGError err;
-      arv_camera_gv_set_multipart(cam, enable, err.storeError());
-      LOG_GERROR_ARAVIS(err);
+      control_write(cam, "GevSCCFGMultiPartEnable", enable ? "true" : "false", [&] {
+        GuardedGError err;
+        arv_camera_gv_set_multipart(cam, enable, err.storeError());
+        LOG_GERROR_ARAVIS(err);
+        return !err;
+      });
     }
 
     std::vector<std::string> get_enumeration_strings(ArvCamera *cam, const char *feature)
@@ -289,7 +521,10 @@ namespace aravis {
       std::vector<std::string> str_vals;
       GuardedGError err;
       guint num_values = -1;
-      const char **vals = arv_camera_dup_available_enumerations_as_strings(cam, feature, &num_values, err.storeError());
+      const char **vals = nullptr;
+      control_access(cam, [&] {
+        vals = arv_camera_dup_available_enumerations_as_strings(cam, feature, &num_values, err.storeError());
+      });
       LOG_GERROR_ARAVIS(err);
 
       if(!vals)
@@ -306,33 +541,43 @@ namespace aravis {
     namespace bounds {
 
       void get_width(ArvCamera *cam, gint* min, gint* max) {
-        GuardedGError err;
-        arv_camera_get_width_bounds(cam, min, max, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_access(cam, [&] {
+          GuardedGError err;
+          arv_camera_get_width_bounds(cam, min, max, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+        });
       }
 
       void get_height(ArvCamera *cam, gint* min, gint* max) {
-        GuardedGError err;
-        arv_camera_get_height_bounds(cam, min, max, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_access(cam, [&] {
+          GuardedGError err;
+          arv_camera_get_height_bounds(cam, min, max, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+        });
       }
 
       void get_exposure_time(ArvCamera *cam, double* min, double* max) {
-        GuardedGError err;
-        arv_camera_get_exposure_time_bounds(cam, min, max, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_access(cam, [&] {
+          GuardedGError err;
+          arv_camera_get_exposure_time_bounds(cam, min, max, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+        });
       }
 
       void get_gain(ArvCamera *cam, double* min, double* max) {
-        GuardedGError err;
-        arv_camera_get_gain_bounds(cam, min, max, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_access(cam, [&] {
+          GuardedGError err;
+          arv_camera_get_gain_bounds(cam, min, max, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+        });
       }
 
       void get_frame_rate(ArvCamera *cam, double* min, double* max) {
-        GuardedGError err;
-        arv_camera_get_frame_rate_bounds(cam, min, max, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_access(cam, [&] {
+          GuardedGError err;
+          arv_camera_get_frame_rate_bounds(cam, min, max, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+        });
       }
 
 
@@ -340,9 +585,12 @@ namespace aravis {
 
     namespace gv {
       void select_stream_channel(ArvCamera* cam, gint channel_id){
-        GuardedGError err;
-        arv_camera_gv_select_stream_channel(cam, channel_id, err.storeError());
-        LOG_GERROR_ARAVIS(err);
+        control_write(cam, "GevStreamChannelSelector", std::to_string(channel_id), [&] {
+          GuardedGError err;
+          arv_camera_gv_select_stream_channel(cam, channel_id, err.storeError());
+          LOG_GERROR_ARAVIS(err);
+          return !err;
+        });
       }
     }
   }
@@ -354,19 +602,34 @@ CameraAravisNodelet::CameraAravisNodelet()
 
 CameraAravisNodelet::~CameraAravisNodelet()
 {
+  diagnostic_timer_.stop();
+  trace_timer_.stop();
+  capture_spinner_.reset();
+
   for(int i=0; i < streams_.size(); i++)
     if(streams_[i].p_stream)
       arv_stream_set_emit_signals(streams_[i].p_stream, FALSE);
 
+  delivery_active_ = false;
+
+  for(int i=0; i < streams_.size(); i++)
+    if(streams_[i].delivery_thread.joinable())
+      streams_[i].delivery_thread.join();
+
+  replay_active_ = false;
+
+  if (replay_thread_.joinable())
+    replay_thread_.join();
+
+  for(int i=0; i < streams_.size(); i++)
+    streams_[i].gvsp_receiver.reset();
+
   spawning_ = false;
 
   if (spawn_stream_thread_.joinable())
     spawn_stream_thread_.join();
 
-  software_trigger_active_ = false;
-
-  if (software_trigger_thread_.joinable())
-    software_trigger_thread_.join();
+  trigger_scheduler_.reset();
 
   for(int i=0; i < streams_.size(); i++)
     for(int j=0; j < streams_[i].substreams.size(); j++)
@@ -377,8 +640,20 @@ CameraAravisNodelet::~CameraAravisNodelet()
         ROS_INFO_STREAM("Joined thread for stream " << i << " substream " << j);
       }
 
+  // finish compression of queued frames while streams still exist
+  compression_workers_.reset();
+  // write queued frames, their buffers go back to streams
+  frame_recorder_.reset();
+  pre_trigger_flushes_.clear();
   for(int i=0; i < streams_.size(); i++)
+    for(int j=0; j < streams_[i].substreams.size(); j++)
+      streams_[i].substreams[j].frame_ring.reset();
+
+  for(int i=0; i < streams_.size() && p_camera_; i++)
   {
+    if (!streams_[i].p_stream)
+      continue;
+
     guint64 n_completed_buffers = 0;
     guint64 n_failures = 0;
     guint64 n_underruns = 0;
@@ -397,13 +672,16 @@ CameraAravisNodelet::~CameraAravisNodelet()
   }
 
 
-  if (p_device_)
+  // monitor leaves acquisition to the controlling driver
+  if (p_device_ && !monitor_)
     aravis::device::execute_command(p_device_, "AcquisitionStop");
 
   for(int i = 0; i < streams_.size(); i++)
+    if (streams_[i].p_stream)
       g_object_unref(streams_[i].p_stream);
 
-  g_object_unref(p_camera_);
+  if (p_camera_)
+    g_object_unref(p_camera_);
 }
 
 void CameraAravisNodelet::onInit()
@@ -415,6 +693,104 @@ void CameraAravisNodelet::onInit()
   guid_ = pnh.param<std::string>("guid", guid_); // Get the camera guid as a parameter or use the first device.
   use_ptp_stamp_ = pnh.param<bool>("use_ptp_timestamp", use_ptp_stamp_);
   pub_ext_camera_info_ = pnh.param<bool>("ExtendedCameraInfo", pub_ext_camera_info_); // publish an extended camera info message
+  diagnostic_rate_ = pnh.param<double>("diagnostic_rate", diagnostic_rate_); // stream statistics on /diagnostics, 0 disables
+  trace_rate_ = pnh.param<double>("trace_rate", trace_rate_); // latency histograms publishing rate
+  trace_file_ = pnh.param<std::string>("trace_file", trace_file_); // optional csv dump of raw frame traces
+  stream_buffer_count_ = pnh.param<int>("stream_buffer_count", stream_buffer_count_);
+  stream_buffer_memory_mb_ = pnh.param<double>("stream_buffer_memory_mb", stream_buffer_memory_mb_);
+
+  std::string buffer_delivery = pnh.param<std::string>("buffer_delivery", "signal");
+  pop_buffer_delivery_ = buffer_delivery == "pop";
+  if (!pop_buffer_delivery_ && buffer_delivery != "signal")
+    ROS_WARN("Unrecognized buffer_delivery %s (recognized: signal, pop), using signal", buffer_delivery.c_str());
+
+  process_inline_ = pnh.param<bool>("process_inline", process_inline_);
+  publish_inline_ = pnh.param<bool>("publish_inline", publish_inline_);
+  if (process_inline_ && !pop_buffer_delivery_)
+  {
+    // aravis emits signal from its receiving thread, don't block it with processing
+    ROS_WARN("process_inline requires buffer_delivery pop, ignoring");
+    process_inline_ = false;
+  }
+
+  preview_downscale_ = std::max(pnh.param<int>("preview_downscale", preview_downscale_), 1);
+  pyramid_levels_ = std::max(pnh.param<int>("pyramid_levels", pyramid_levels_), 0);
+  tone_mapping_.low = pnh.param<double>("display_low", tone_mapping_.low);
+  tone_mapping_.high = pnh.param<double>("display_high", tone_mapping_.high);
+  tone_mapping_.gamma = pnh.param<double>("display_gamma", tone_mapping_.gamma);
+  tone_mapping_.auto_range = pnh.param<bool>("display_auto_range", tone_mapping_.auto_range);
+  tone_mapping_.auto_low_percentile = pnh.param<double>("display_auto_low", tone_mapping_.auto_low_percentile);
+  tone_mapping_.auto_high_percentile = pnh.param<double>("display_auto_high", tone_mapping_.auto_high_percentile);
+  demosaic_ = pnh.param<std::string>("demosaic", demosaic_);
+  demosaic_encoding_ = pnh.param<std::string>("demosaic_encoding", demosaic_encoding_);
+  if (demosaic_ != "none" && demosaic_ != "bilinear" && demosaic_ != "edge_aware")
+  {
+    ROS_WARN("Unrecognized demosaic %s (recognized: none, bilinear, edge_aware), using none", demosaic_.c_str());
+    demosaic_ = "none";
+  }
+  if (demosaic_encoding_ != sensor_msgs::image_encodings::RGB8 && demosaic_encoding_ != sensor_msgs::image_encodings::BGR8 &&
+      demosaic_encoding_ != sensor_msgs::image_encodings::RGB16 && demosaic_encoding_ != sensor_msgs::image_encodings::BGR16)
+  {
+    ROS_WARN("Unrecognized demosaic_encoding %s (recognized: rgb8, bgr8, rgb16, bgr16), using bgr8", demosaic_encoding_.c_str());
+    demosaic_encoding_ = sensor_msgs::image_encodings::BGR8;
+  }
+
+  codec_params_.codec = pnh.param<std::string>("compression_codec", codec_params_.codec);
+  codec_params_.lossless_codec = pnh.param<std::string>("compression_lossless_codec", codec_params_.lossless_codec);
+  codec_params_.jpeg_quality = pnh.param<int>("compression_jpeg_quality", codec_params_.jpeg_quality);
+  codec_params_.png_level = pnh.param<int>("compression_png_level", codec_params_.png_level);
+  codec_params_.zstd_level = pnh.param<int>("compression_zstd_level", codec_params_.zstd_level);
+  codec_params_.depth_codec = pnh.param<std::string>("compression_depth_codec", codec_params_.depth_codec);
+  codec_params_.depth_scale = pnh.param<double>("compression_depth_scale", codec_params_.depth_scale);
+  compression_threads_ = std::max(pnh.param<int>("compression_threads", compression_threads_), 0);
+  if (codec_params_.codec != "jpeg" && codec_params_.codec != "none")
+  {
+    ROS_WARN("Unrecognized compression_codec %s (recognized: jpeg, none), using jpeg", codec_params_.codec.c_str());
+    codec_params_.codec = "jpeg";
+  }
+  if (codec_params_.depth_codec != "rvl" && codec_params_.depth_codec != "none")
+  {
+    ROS_WARN("Unrecognized compression_depth_codec %s (recognized: rvl, none), using rvl", codec_params_.depth_codec.c_str());
+    codec_params_.depth_codec = "rvl";
+  }
+  if ((codec_params_.lossless_codec != "png" && codec_params_.lossless_codec != "zstd") ||
+      !codecAvailable(codec_params_.lossless_codec))
+  {
+    ROS_WARN("Compression codec %s is not available (recognized: png, zstd if built with libzstd), using png",
+             codec_params_.lossless_codec.c_str());
+    codec_params_.lossless_codec = "png";
+  }
+  if (compression_threads_ > 0)
+    compression_workers_.reset(new CompressionWorkers(codec_params_, compression_threads_,
+                                                      pnh.param<int>("compression_queue_size", 2 * compression_threads_)));
+
+  std::string delivery_cpu_args;
+  if (pnh.getParam("delivery_cpu_affinity", delivery_cpu_args))
+  {
+    std::vector<std::string> delivery_cpus;
+    parseStringArgs(delivery_cpu_args, delivery_cpus);
+    for(const std::string &cpu : delivery_cpus)
+      delivery_cpus_.push_back(cpu.empty() ? -1 : std::stoi(cpu));
+  }
+
+  // replay recorded frames through the pipeline instead of connecting to camera
+  const std::string replay_directory = pnh.param<std::string>("replay_directory", "");
+  if (!replay_directory.empty())
+  {
+    initReplay(replay_directory);
+    return;
+  }
+
+  multicast_address_ = pnh.param<std::string>("multicast_address", multicast_address_);
+  multicast_interface_ = pnh.param<std::string>("multicast_interface", multicast_interface_);
+  multicast_port_ = pnh.param<int>("multicast_port", multicast_port_);
+  monitor_ = pnh.param<bool>("monitor", monitor_);
+  if (monitor_ && multicast_address_.empty())
+  {
+    ROS_FATAL("monitor mode receives the stream of controlling driver, it requires multicast_address");
+    ros::shutdown();
+    return;
+  }
 
   std::string stream_channel_args;
   std::vector<std::vector<std::string>> substream_names;
@@ -428,6 +804,25 @@ void CameraAravisNodelet::onInit()
 
   connectToCamera();
 
+  // from here on feature access of all threads is serialized by priority
+  control_coalesce_ms_ = std::max(pnh.param<double>("control_coalesce_ms", control_coalesce_ms_), 0.0);
+  control_channel_.reset(new ControlChannel(uint64_t(control_coalesce_ms_ * 1e6)));
+  control_channel_->attach(p_camera_);
+  control_channel_->attach(p_device_);
+
+  if (!multicast_address_.empty() && !arv_camera_is_gv_device(p_camera_))
+  {
+    ROS_FATAL("multicast_address requires a GigE Vision camera");
+    ros::shutdown();
+    return;
+  }
+
+  if (monitor_)
+  {
+    initMonitor(substream_names, frame_ids);
+    return;
+  }
+
   // Start the dynamic_reconfigure server.
   reconfigure_server_.reset(new dynamic_reconfigure::Server<Config>(reconfigure_mutex_, pnh));
   reconfigure_server_->getConfigDefault(config_);
@@ -440,15 +835,18 @@ void CameraAravisNodelet::onInit()
   int num_streams = discoverStreams(substream_names.size());
 
   // initialize the sensor structs
+  uint32_t record_index = 0;
   for(int i = 0; i < num_streams; i++)
   {
     streams_.push_back({nullptr, CameraBufferPool::Ptr() });
     streams_[i].substreams = std::vector<Substream>(substream_names[i].size());
+    streams_[i].frame_loss.reset(new FrameLossStatistics);
     for(int j = 0; j < substream_names[i].size();++j)
     {
       Substream &sub = streams_[i].substreams[j];
       sub.name = substream_names[i][j];
       sub.frame_id = frame_ids[i][j];
+      sub.record_index = record_index++;
     }
   }
 
@@ -465,6 +863,7 @@ void CameraAravisNodelet::onInit()
   setUSBMode();
 
   setCameraSettings();
+  initActionTrigger();
 
   // set automatic rosparam features before camera readout
   // we do it second time here (!)
@@ -475,6 +874,8 @@ void CameraAravisNodelet::onInit()
 
   // Get other (non GenIcam) parameter current values.
   pnh.param<double>("softwaretriggerrate", config_.softwaretriggerrate, config_.softwaretriggerrate);
+  trigger_spin_us_ = std::max(pnh.param<int>("trigger_spin_us", trigger_spin_us_), 0);
+  trigger_priority_ = pnh.param<int>("trigger_priority", trigger_priority_);
   pnh.param<bool>("auto_master", config_.AutoMaster, config_.AutoMaster);
   pnh.param<bool>("auto_slave", config_.AutoSlave, config_.AutoSlave);
 
@@ -493,14 +894,26 @@ void CameraAravisNodelet::onInit()
 
   printCameraInfo();
 
+  initRecorder();
+  initPreTrigger();
+
   // Reset PTP clock
   if (use_ptp_stamp_)
     resetPtpClock();
 
   // enable multipart data
   // chunked data is not implemented yet so we use multipart
-  ROS_INFO("Enabling multipart data (chunked is not implemented yet)");
-  aravis::camera::set_multipart_output_format(p_camera_, true);
+  // multicast receiver reassembles image payloads only
+  if (multicast_address_.empty())
+  {
+    ROS_INFO("Enabling multipart data (chunked is not implemented yet)");
+    aravis::camera::set_multipart_output_format(p_camera_, true);
+  }
+  else
+  {
+    ROS_INFO("Disabling multipart data (multicast receiver supports image payloads only)");
+    aravis::camera::set_multipart_output_format(p_camera_, false);
+  }
 
   // spawn camera stream in thread, so onInit() is not blocked
   spawning_ = true;
@@ -572,7 +985,7 @@ void CameraAravisNodelet::connectToCamera()
 
   p_device_ = arv_camera_get_device(p_camera_);
   ROS_INFO("Opened: %s-%s", aravis::camera::get_vendor_name(p_camera_),
-  aravis::device::feature::get_string(p_device_, "DeviceSerialNumber"));
+  aravis::device::feature::get_string(p_device_, "DeviceSerialNumber").c_str());
 }
 
 int CameraAravisNodelet::discoverStreams(size_t stream_names_size)
@@ -672,13 +1085,7 @@ void CameraAravisNodelet::initPixelFormats()
         pixel_format = pixel_formats_internal[i][j];
         ROS_WARN_STREAM("overriding internally GenICam pixel format " << sensor.pixel_format << " with " << pixel_format);
       }
-
-      const auto sensor_iter = CONVERSIONS_DICTIONARY.find(pixel_format);
-
-      if (sensor_iter!=CONVERSIONS_DICTIONARY.end())
-        substream.convert_format = sensor_iter->second;
-      else
-        ROS_WARN_STREAM("There is no known conversion from " << pixel_format << " to a usual ROS image encoding. Likely you need to implement one.");
+      initConversions(substream, pixel_format);
 
       if (implemented_features_["PixelFormat"])
         sensor.n_bits_pixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(
@@ -690,6 +1097,40 @@ void CameraAravisNodelet::initPixelFormats()
   }
 }
 
+void CameraAravisNodelet::initConversions(Substream &substream, const std::string &pixel_format)
+{
+  substream.internal_pixel_format = pixel_format;
+
+  substream.convert_format = getConversion(pixel_format, &substream.rename_only, &substream.convert_in_place);
+
+  if (!substream.convert_format)
+    ROS_WARN_STREAM("There is no known conversion from " << pixel_format << " to a usual ROS image encoding. Likely you need to implement one.");
+
+  if (demosaic_ != "none" && pixel_format.compare(0, 5, "Bayer") == 0)
+  {
+    ROS_INFO_STREAM("Demosaicing " << pixel_format << " to " << demosaic_encoding_ << " (" << demosaic_ << ")");
+    substream.demosaic = std::bind(&demosaicImg, std::placeholders::_1, std::placeholders::_2,
+                                   demosaic_ == "edge_aware", demosaic_encoding_);
+  }
+  else
+    substream.demosaic = nullptr;
+
+  // correction works on single channel images, on native data if it is 8/16 bit container already
+  const bool mono = pixel_format.compare(0, 4, "Mono") == 0;
+  substream.correct_bayer = pixel_format.compare(0, 5, "Bayer") == 0;
+  substream.pixel_correction.reset((mono || substream.correct_bayer) ? new PixelCorrection : nullptr);
+  substream.correct_native = substream.pixel_correction && substream.convert_in_place;
+  substream.correction_max_value = 0xFFFF;
+  const size_t digits_pos = pixel_format.find_first_of("0123456789");
+  if (substream.correct_native && digits_pos != std::string::npos)
+    substream.correction_max_value = (1u << std::stoi(pixel_format.substr(digits_pos))) - 1;
+
+  substream.tone_mapper.reset(new ToneMapper(tone_mapping_));
+  // fused unpacking to 8 bit matches converted image only without demosaicing
+  substream.tone_map_native = substream.demosaic ? ConversionFunction() :
+                                                   substream.tone_mapper->getFusedConversion(pixel_format);
+}
+
 void CameraAravisNodelet::getBounds()
 {
   // Get parameter bounds.
@@ -760,6 +1201,35 @@ void CameraAravisNodelet::setUSBMode()
 #endif
 }
 
+size_t CameraAravisNodelet::streamBufferCount(size_t n_bytes_payload) const
+{
+  const size_t MIN_BUFFERS = 2;
+  const size_t BYTES_IN_MB = 1024 * 1024;
+
+  size_t n_buffers = std::max<int32_t>(stream_buffer_count_, MIN_BUFFERS);
+
+  if (stream_buffer_memory_mb_ > 0.0 && n_bytes_payload > 0)
+    n_buffers = std::max<size_t>(stream_buffer_memory_mb_ * BYTES_IN_MB / n_bytes_payload, MIN_BUFFERS);
+
+  ROS_INFO_STREAM("Using " << n_buffers << " stream buffers of " << n_bytes_payload << " bytes");
+
+  // aravis async USB mode submits transfers for all queued buffers,
+  // the kernel usbfs memory limit caps how much of that can be in flight
+  if (arv_camera_is_uv_device(p_camera_))
+  {
+    std::ifstream usbfs_limit_file("/sys/module/usbcore/parameters/usbfs_memory_mb");
+    size_t usbfs_memory_mb = 0;
+
+    if (usbfs_limit_file >> usbfs_memory_mb && usbfs_memory_mb > 0 &&
+        n_buffers * n_bytes_payload > usbfs_memory_mb * BYTES_IN_MB)
+      ROS_WARN_STREAM("Stream buffers (" << n_buffers * n_bytes_payload / BYTES_IN_MB << " MB) exceed usbfs_memory_mb ("
+                      << usbfs_memory_mb << " MB), transfers may fail. Raise it, e.g. "
+                      << "echo 1000 > /sys/module/usbcore/parameters/usbfs_memory_mb");
+  }
+
+  return n_buffers;
+}
+
 void CameraAravisNodelet::setCameraSettings()
 {
   for(int i = 0; i < streams_.size(); i++) {
@@ -842,8 +1312,14 @@ void CameraAravisNodelet::initCalibration()
   pnh.param("camera_info_url", calib_url_args, calib_url_args);
   parseStringArgs2D(calib_url_args, calib_urls);
 
-  // default calibration url is [DeviceSerialNumber/DeviceID].yaml
-  if(calib_urls[0].empty() || calib_urls[0][0].empty()) {
+  // pixel correction maps, by default next to calibration YAML
+  std::string correction_url_args;
+  std::vector<std::vector<std::string>> correction_urls;
+  pnh.param("pixel_correction_url", correction_url_args, correction_url_args);
+  parseStringArgs2D(correction_url_args, correction_urls);
+
+  // default calibration url is [DeviceSerialNumber/DeviceID].yaml, replay has no device to ask
+  if(p_device_ && (calib_urls[0].empty() || calib_urls[0][0].empty())) {
     ArvGcNode *p_gc_node = arv_device_get_feature(p_device_, "DeviceSerialNumber");
 
     GuardedGError error;
@@ -873,19 +1349,34 @@ void CameraAravisNodelet::initCalibration()
     for(int j = 0; j< src.substreams.size() ;++j)
     {
       Substream &sub = src.substreams[j];
+      // replayed recordings may have more substreams than listed urls
+      const std::string calib_url = (i < calib_urls.size() && j < calib_urls[i].size()) ? calib_urls[i][j] : std::string();
 
       // Use separate node handles for CameraInfoManagers when using a Multisource/Multistream Camera
       if(!sub.name.empty())
       {
         sub.p_camera_info_node_handle.reset(new ros::NodeHandle(pnh, sub.name));
-        sub.p_camera_info_manager.reset(new camera_info_manager::CameraInfoManager(*sub.p_camera_info_node_handle, sub.frame_id, calib_urls[i][j]));
+        sub.p_camera_info_manager.reset(new camera_info_manager::CameraInfoManager(*sub.p_camera_info_node_handle, sub.frame_id, calib_url));
 
       }
       else
-        sub.p_camera_info_manager.reset(new camera_info_manager::CameraInfoManager(pnh, sub.frame_id, calib_urls[i][j]));
+        sub.p_camera_info_manager.reset(new camera_info_manager::CameraInfoManager(pnh, sub.frame_id, calib_url));
 
       ROS_INFO("Reset %s Camera Info Manager", sub.name.c_str());
-      ROS_INFO("%s Calib URL: %s", sub.name.c_str(), calib_urls[i][j].c_str());
+      ROS_INFO("%s Calib URL: %s", sub.name.c_str(), calib_url.c_str());
+
+      if (sub.pixel_correction)
+      {
+        sub.pixel_correction_file = (i < correction_urls.size() && j < correction_urls[i].size()) ?
+                                    correction_urls[i][j] : std::string();
+        if (sub.pixel_correction_file.empty())
+          sub.pixel_correction_file = pixelCorrectionPath(calib_url);
+        if (sub.pixel_correction_file.compare(0, 7, "file://") == 0)
+          sub.pixel_correction_file.erase(0, 7);
+
+        if (!sub.pixel_correction_file.empty() && sub.pixel_correction->load(sub.pixel_correction_file))
+          ROS_INFO("%s pixel correction: %s", sub.name.c_str(), sub.pixel_correction_file.c_str());
+      }
 
       // publish an ExtendedCameraInfo message
       setExtendedCameraInfo(sub.name, i, j);
@@ -893,21 +1384,292 @@ void CameraAravisNodelet::initCalibration()
   }
 }
 
-void CameraAravisNodelet::printCameraInfo()
+void CameraAravisNodelet::initReplay(const std::string &directory)
 {
-  // Print information.
-  ROS_INFO("    Using Camera Configuration:");
-  ROS_INFO("    ---------------------------");
-  ROS_INFO("    Vendor name          = %s", aravis::device::feature::get_string(p_device_, "DeviceVendorName"));
-  ROS_INFO("    Model name           = %s", aravis::device::feature::get_string(p_device_, "DeviceModelName"));
-  ROS_INFO("    Device id            = %s", aravis::device::feature::get_string(p_device_, "DeviceUserID"));
-  ROS_INFO("    Serial number        = %s", aravis::device::feature::get_string(p_device_, "DeviceSerialNumber"));
-  ROS_INFO(
-      "    Type                 = %s",
-      arv_camera_is_uv_device(p_camera_) ? "USB3Vision" :
-          (arv_camera_is_gv_device(p_camera_) ? "GigEVision" : "Other"));
+  ros::NodeHandle pnh = getPrivateNodeHandle();
 
-  for(int i=0;i<streams_.size();++i)
+  replay_rate_ = std::max(pnh.param<double>("replay_rate", replay_rate_), 0.0);
+  replay_loop_ = pnh.param<bool>("replay_loop", replay_loop_);
+  replay_restamp_ = pnh.param<bool>("replay_restamp", replay_restamp_);
+
+  // nothing to synchronize with or query from
+  use_ptp_stamp_ = false;
+  pub_ext_camera_info_ = false;
+
+  replay_reader_.reset(new RecordingReader);
+  if (!replay_reader_->open(directory) || replay_reader_->size() == 0)
+  {
+    ROS_FATAL("Can't replay recording %s", directory.c_str());
+    replay_reader_.reset();
+    ros::shutdown();
+    return;
+  }
+
+  const std::vector<RecordedSubstream> &recorded = replay_reader_->substreams();
+  for (size_t i = 0; i < recorded.size(); ++i)
+  {
+    streams_.push_back({nullptr, CameraBufferPool::Ptr() });
+    streams_[i].substreams = std::vector<Substream>(1);
+    streams_[i].frame_loss.reset(new FrameLossStatistics);
+
+    Substream &sub = streams_[i].substreams[0];
+    sub.name = recorded[i].name;
+    sub.frame_id = recorded[i].frame_id;
+    sub.record_index = i;
+    sub.sensor.pixel_format = recorded[i].pixel_format;
+    sub.sensor.n_bits_pixel = recorded[i].bits_per_pixel;
+    initConversions(sub, recorded[i].pixel_format);
+  }
+
+  // geometry of first frame of each substream, replayed frames update it
+  for (size_t i = replay_reader_->size(); i > 0; --i)
+  {
+    const FrameRecord &record = replay_reader_->record(i - 1);
+    ROI &roi = streams_[record.substream].substreams[0].roi;
+    roi.x = record.x;
+    roi.y = record.y;
+    roi.width = roi.width_min = roi.width_max = record.width;
+    roi.height = roi.height_min = roi.height_max = record.height;
+  }
+
+  initCalibration();
+  initPreTrigger();
+
+  ROS_INFO("Replaying %zu frames of %zu substream(s) from %s at %s", replay_reader_->size(), recorded.size(),
+           directory.c_str(), replay_rate_ > 0.0 ? (std::to_string(replay_rate_) + "x speed").c_str() : "full speed");
+
+  spawning_ = true;
+  spawn_stream_thread_ = std::thread(&CameraAravisNodelet::spawnStream, this);
+}
+
+void CameraAravisNodelet::initMonitor(const std::vector<std::vector<std::string>> &substream_names,
+                                      const std::vector<std::vector<std::string>> &frame_ids)
+{
+  // camera belongs to the controlling driver, monitor only reads features
+  ArvGvDevice *p_gv_device = ARV_GV_DEVICE(p_device_);
+  if (arv_gv_device_is_controller(p_gv_device))
+  {
+    GuardedGError error;
+    arv_gv_device_leave_control(p_gv_device, error.storeError());
+    LOG_GERROR_ARAVIS(error);
+  }
+
+  // nothing to query per frame without control
+  pub_ext_camera_info_ = false;
+
+  discoverFeatures();
+
+  const int num_streams = discoverStreams(substream_names.size());
+
+  for(int i = 0; i < num_streams; i++)
+  {
+    if (substream_names[i].size() > 1)
+      ROS_WARN("Stream %i: multicast receiver supports image payloads only, using first of %zu substreams",
+               i, substream_names[i].size());
+
+    streams_.push_back({nullptr, CameraBufferPool::Ptr() });
+    streams_[i].substreams = std::vector<Substream>(1);
+    streams_[i].frame_loss.reset(new FrameLossStatistics);
+
+    Substream &sub = streams_[i].substreams[0];
+    sub.name = substream_names[i][0];
+    sub.frame_id = frame_ids[i][0];
+    sub.record_index = i;
+
+    aravis::camera::gv::select_stream_channel(p_camera_, i);
+
+    if (implemented_features_["PixelFormat"])
+    {
+      sub.sensor.pixel_format = aravis::device::feature::get_string(p_device_, "PixelFormat");
+      sub.sensor.n_bits_pixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(
+        aravis::device::feature::get_integer(p_device_, "PixelFormat"));
+    }
+    initConversions(sub, sub.sensor.pixel_format);
+
+    aravis::camera::get_sensor_size(p_camera_, &sub.sensor.width, &sub.sensor.height);
+    aravis::camera::get_region(p_camera_, &sub.roi.x, &sub.roi.y, &sub.roi.width, &sub.roi.height);
+    sub.roi.width_min = sub.roi.width_max = sub.roi.width;
+    sub.roi.height_min = sub.roi.height_max = sub.roi.height;
+  }
+
+  initCalibration();
+  initRecorder();
+  initPreTrigger();
+
+  ROS_INFO("Monitoring %zu stream(s) of %s through multicast group %s", streams_.size(), guid_.c_str(),
+           multicast_address_.c_str());
+
+  spawning_ = true;
+  spawn_stream_thread_ = std::thread(&CameraAravisNodelet::spawnStream, this);
+}
+
+bool CameraAravisNodelet::initMulticast(size_t stream_id)
+{
+  Stream &stream = streams_[stream_id];
+  const uint16_t port = multicast_port_ + stream_id;
+
+  aravis::camera::gv::select_stream_channel(p_camera_, stream_id);
+
+  // controller points stream channel at the group, receivers just join it
+  if (!monitor_)
+  {
+    in_addr group;
+    if (inet_pton(AF_INET, multicast_address_.c_str(), &group) != 1)
+    {
+      ROS_ERROR("Invalid multicast_address %s", multicast_address_.c_str());
+      return false;
+    }
+
+    if (stream.substreams.size() > 1)
+      ROS_WARN("Stream %zu: multicast receiver supports image payloads only, publishing first substream",
+               stream_id);
+
+    aravis::device::feature::set_integer(p_device_, "GevSCDA", ntohl(group.s_addr));
+    aravis::device::feature::set_integer(p_device_, "GevSCPHostPort", port);
+  }
+
+  // data packet size, receiver learns it from packets otherwise
+  const uint32_t packet_size = implemented_features_["GevSCPSPacketSize"] ?
+                               aravis::device::feature::get_integer(p_device_, "GevSCPSPacketSize") : 0;
+
+  stream.gvsp_receiver.reset(new GvspReceiver(
+    multicast_address_, multicast_interface_, port, packet_size,
+    [this, stream_id](GvspFrame &frame) { multicastFrameReady(stream_id, frame); },
+    [this, stream_id](uint64_t block_id)
+    {
+      streams_[stream_id].frame_loss->addReceived(block_id, true);
+      streams_[stream_id].frame_loss->addLost(LOSS_MISSING_PACKETS);
+    }));
+
+  return stream.gvsp_receiver->start();
+}
+
+std::vector<RecordedSubstream> CameraAravisNodelet::recordedSubstreams() const
+{
+  // in record_index order
+  std::vector<RecordedSubstream> substreams;
+  for (const Stream &stream : streams_)
+    for (const Substream &substream : stream.substreams)
+    {
+      RecordedSubstream recorded;
+      recorded.name = substream.name;
+      recorded.frame_id = substream.frame_id;
+      recorded.pixel_format = substream.internal_pixel_format;
+      recorded.bits_per_pixel = substream.sensor.n_bits_pixel;
+      substreams.push_back(recorded);
+    }
+  return substreams;
+}
+
+void CameraAravisNodelet::initActionTrigger()
+{
+  ros::NodeHandle pnh = getPrivateNodeHandle();
+
+  // cameras without action keys keep TriggerSoftware and hardware lines
+  if (!pnh.hasParam("action_device_key"))
+    return;
+
+  // ros integer params are signed 32 bit, keys above 0x7fffffff are given negative
+  action_command_.device_key = static_cast<uint32_t>(pnh.param<int>("action_device_key", 0));
+  action_command_.group_key = static_cast<uint32_t>(pnh.param<int>("action_group_key", 1));
+  action_command_.group_mask = static_cast<uint32_t>(pnh.param<int>("action_group_mask", 1));
+  const int action_selector = pnh.param<int>("action_selector", 1);
+
+  if (implemented_features_["ActionDeviceKey"] && implemented_features_["ActionGroupKey"] &&
+      implemented_features_["ActionGroupMask"])
+  {
+    // TriggerSource Action<n> fires on action n
+    if (implemented_features_["ActionSelector"])
+      aravis::device::feature::set_integer(p_device_, "ActionSelector", action_selector);
+    aravis::device::feature::set_integer(p_device_, "ActionDeviceKey", action_command_.device_key);
+    aravis::device::feature::set_integer(p_device_, "ActionGroupKey", action_command_.group_key);
+    aravis::device::feature::set_integer(p_device_, "ActionGroupMask", action_command_.group_mask);
+    ROS_INFO("Action %d keys set (device 0x%08x, group 0x%08x, mask 0x%08x)", action_selector,
+             action_command_.device_key, action_command_.group_key, action_command_.group_mask);
+  }
+  else
+  {
+    ROS_WARN("Camera does not support action commands.");
+  }
+
+  // a single master per camera group sends the commands, the other cameras only listen
+  if (!pnh.param<bool>("action_trigger_master", false))
+    return;
+
+  action_schedule_lead_ms_ = std::max(pnh.param<double>("action_schedule_lead_ms", action_schedule_lead_ms_), 0.0);
+  action_command_.scheduled = action_schedule_lead_ms_ > 0.0;
+
+  action_sender_.reset(new ActionCommandSender(pnh.param<std::string>("action_address", "255.255.255.255"),
+                                               pnh.param<std::string>("action_interface", "")));
+  if (!action_sender_->open())
+    action_sender_.reset();
+}
+
+void CameraAravisNodelet::initRecorder()
+{
+  ros::NodeHandle pnh = getPrivateNodeHandle();
+
+  const std::string record_directory = pnh.param<std::string>("record_directory", "");
+  if (record_directory.empty())
+    return;
+
+  const size_t BYTES_IN_MB = 1024 * 1024;
+  const size_t max_queued_bytes = std::max(pnh.param<int>("record_max_queued_mb", 512), 1) * BYTES_IN_MB;
+  const size_t block_size = std::max(pnh.param<int>("record_block_mb", 8), 1) * BYTES_IN_MB;
+
+  // each run goes to its own subdirectory
+  frame_recorder_.reset(new FrameRecorder(timestampedDirectory(record_directory), recordedSubstreams(),
+                                          max_queued_bytes, block_size));
+  if (!frame_recorder_->isOpen())
+  {
+    frame_recorder_.reset();
+    return;
+  }
+
+  for (Stream &stream : streams_)
+    for (Substream &substream : stream.substreams)
+      substream.recorded = true;
+
+  ROS_INFO("Recording raw frames to %s", frame_recorder_->directory().c_str());
+}
+
+void CameraAravisNodelet::initPreTrigger()
+{
+  ros::NodeHandle pnh = getPrivateNodeHandle();
+
+  pre_trigger_seconds_ = std::max(pnh.param<double>("pre_trigger_seconds", pre_trigger_seconds_), 0.0);
+  pre_trigger_bytes_ = std::max(pnh.param<int>("pre_trigger_mb", 256), 1) * size_t(1024 * 1024);
+  pre_trigger_directory_ = pnh.param<std::string>("pre_trigger_directory", pre_trigger_directory_);
+  if (pre_trigger_seconds_ <= 0.0)
+    return;
+
+  size_t n_substreams = 0;
+  for (const Stream &stream : streams_)
+    n_substreams += stream.substreams.size();
+
+  // memory budget is shared equally by substreams
+  for (Stream &stream : streams_)
+    for (Substream &substream : stream.substreams)
+      substream.frame_ring.reset(new FrameRing(uint64_t(pre_trigger_seconds_ * 1e9), pre_trigger_bytes_ / n_substreams));
+
+  ROS_INFO("Pre-trigger ring of %.1f s, at most %zu MB", pre_trigger_seconds_, pre_trigger_bytes_ / (1024 * 1024));
+}
+
+void CameraAravisNodelet::printCameraInfo()
+{
+  // Print information.
+  ROS_INFO("    Using Camera Configuration:");
+  ROS_INFO("    ---------------------------");
+  ROS_INFO("    Vendor name          = %s", aravis::device::feature::get_string(p_device_, "DeviceVendorName").c_str());
+  ROS_INFO("    Model name           = %s", aravis::device::feature::get_string(p_device_, "DeviceModelName").c_str());
+  ROS_INFO("    Device id            = %s", aravis::device::feature::get_string(p_device_, "DeviceUserID").c_str());
+  ROS_INFO("    Serial number        = %s", aravis::device::feature::get_string(p_device_, "DeviceSerialNumber").c_str());
+  ROS_INFO(
+      "    Type                 = %s",
+      arv_camera_is_uv_device(p_camera_) ? "USB3Vision" :
+          (arv_camera_is_gv_device(p_camera_) ? "GigEVision" : "Other"));
+
+  for(int i=0;i<streams_.size();++i)
   {
     ROS_INFO_STREAM("stream: " << i);
     for(int j=0;j<streams_[i].substreams.size();++j)
@@ -977,6 +1739,27 @@ void CameraAravisNodelet::spawnStream()
     while (spawning_) {
       Stream &stream = streams_[i];
 
+      if (replay_reader_)
+      {
+        // replayed frames are copied into recyclable images, there is no aravis stream
+        stream.p_buffer_pool.reset(new CameraBufferPool(nullptr, 0, 0));
+        stream.substreams[0].p_buffer_pool.reset(new CameraBufferPool(nullptr, 0, 0));
+        stream.substreams[0].buffer_thread = std::thread(&CameraAravisNodelet::substreamThreadMain, this, i, 0);
+        break;
+      }
+
+      if (!multicast_address_.empty())
+      {
+        // reassembled frames are swapped into recyclable images, aravis stream would redirect channel to this host
+        stream.p_buffer_pool.reset(new CameraBufferPool(nullptr, 0, 0));
+        stream.substreams[0].p_buffer_pool.reset(new CameraBufferPool(nullptr, 0, 0));
+        stream.substreams[0].buffer_thread = std::thread(&CameraAravisNodelet::substreamThreadMain, this, i, 0);
+
+        if (!initMulticast(i))
+          ROS_ERROR("Stream %i: Could not receive multicast stream of %s.", i, guid_.c_str());
+        break;
+      }
+
       if (arv_camera_is_gv_device(p_camera_)) aravis::camera::gv::select_stream_channel(p_camera_, i);
 
       stream.p_stream = aravis::camera::create_stream(p_camera_, NULL, NULL);
@@ -987,7 +1770,13 @@ void CameraAravisNodelet::spawnStream()
 
         const gint n_bytes_payload_stream_ = aravis::camera::get_payload(p_camera_);
 
-        stream.p_buffer_pool.reset(new CameraBufferPool(stream.p_stream, n_bytes_payload_stream_, 10));
+        stream.p_buffer_pool.reset(new CameraBufferPool(stream.p_stream, n_bytes_payload_stream_,
+                                                        streamBufferCount(n_bytes_payload_stream_)));
+
+        // pre-trigger ring pins whole stream buffers, its budget is allocated up front
+        // (multipart parts are copies held in substream pools instead)
+        if (stream.substreams.size() == 1 && stream.substreams[0].frame_ring && n_bytes_payload_stream_ > 0)
+          stream.p_buffer_pool->allocateBuffers(stream.substreams[0].frame_ring->maxBytes() / n_bytes_payload_stream_);
 
         
         for(int j=0;j<stream.substreams.size();++j)
@@ -1037,53 +1826,134 @@ void CameraAravisNodelet::spawnStream()
       streams_[i].substreams[j].cam_pub = p_transport->advertiseCamera(
         ros::names::remap(topic_name + "/image_raw"),
         1, image_cb, image_cb, info_cb, info_cb);
+
+      // Set up on demand native and preview outputs, each namespace has own camera_info
+      streams_[i].substreams[j].native_pub = p_transport->advertiseCamera(
+        ros::names::remap(topic_name + "/native/image_raw"),
+        1, image_cb, image_cb, info_cb, info_cb);
+
+      streams_[i].substreams[j].preview_pub = p_transport->advertiseCamera(
+        ros::names::remap(topic_name + "/preview/image_raw"),
+        1, image_cb, image_cb, info_cb, info_cb);
+
+      // Set up software binned pyramid levels, e.g. bin2/image_raw, bin4/image_raw
+      for(int level = 1; level <= pyramid_levels_; ++level)
+      {
+        streams_[i].substreams[j].pyramid_pubs.push_back(p_transport->advertiseCamera(
+          ros::names::remap(topic_name + "/bin" + std::to_string(1 << level) + "/image_raw"),
+          1, image_cb, image_cb, info_cb, info_cb));
+      }
+
+      // Set up on demand 8 bit tone mapped output
+      streams_[i].substreams[j].display_pub = p_transport->advertiseCamera(
+        ros::names::remap(topic_name + "/display/image_raw"),
+        1, image_cb, image_cb, info_cb, info_cb);
+
+      // Set up on demand rectified output
+      streams_[i].substreams[j].rect_pub = p_transport->advertiseCamera(
+        ros::names::remap(topic_name + "/rect/image_rect"),
+        1, image_cb, image_cb, info_cb, info_cb);
+
+      // Set up on demand compressed output of worker pool
+      if (compression_workers_)
+        streams_[i].substreams[j].compressed_pub = pnh.advertise<sensor_msgs::CompressedImage>(
+          ros::names::remap(topic_name + "/encoded/compressed"), 1, info_cb, info_cb);
+
+      // Set up named software ROIs, e.g. roi/lane_left/image_raw
+      initSoftwareROIs(streams_[i].substreams[j], topic_name, info_cb);
+
+      streams_[i].substreams[j].latency_pub = pnh.advertise<FrameLatency>(
+        ros::names::remap(topic_name + "/frame_latency"), 1, true);
     }
   }
 
-  // Connect signals with callbacks.
-  for(int i = 0; i < streams_.size(); i++) {
-    StreamIdData* data = new StreamIdData();
-    data->can = this;
-    data->stream_id = i;
-    g_signal_connect(streams_[i].p_stream, "new-buffer", (GCallback)CameraAravisNodelet::newBufferReadyCallback, data);
+  // Connect signals with callbacks or start delivery threads.
+  if (replay_reader_)
+  {
+    replay_active_ = true;
+    replay_thread_ = std::thread(&CameraAravisNodelet::replayThreadMain, this);
+  }
+  else if (!multicast_address_.empty())
+  {
+    // multicast receivers deliver from their own threads, started with the streams
+  }
+  else if (pop_buffer_delivery_)
+  {
+    delivery_active_ = true;
+    for(int i = 0; i < streams_.size(); i++)
+      streams_[i].delivery_thread = std::thread(&CameraAravisNodelet::deliveryThreadMain, this, i);
   }
-  g_signal_connect(p_device_, "control-lost", (GCallback)CameraAravisNodelet::controlLostCallback, this);
+  else
+  {
+    for(int i = 0; i < streams_.size(); i++) {
+      StreamIdData* data = new StreamIdData();
+      data->can = this;
+      data->stream_id = i;
+      g_signal_connect(streams_[i].p_stream, "new-buffer", (GCallback)CameraAravisNodelet::newBufferReadyCallback, data);
+    }
 
-  for(int i = 0; i < streams_.size(); i++) {
-    arv_stream_set_emit_signals(streams_[i].p_stream, TRUE);
+    for(int i = 0; i < streams_.size(); i++) {
+      arv_stream_set_emit_signals(streams_[i].p_stream, TRUE);
+    }
   }
+  if (p_device_ && !monitor_)
+    g_signal_connect(p_device_, "control-lost", (GCallback)CameraAravisNodelet::controlLostCallback, this);
 
-  // any substream of any stream enabled?
-  if (std::any_of(streams_.begin(), streams_.end(),
+  // any substream of any stream enabled? multicast is streamed for monitors regardless
+  if (p_camera_ && !monitor_ && (!multicast_address_.empty() || std::any_of(streams_.begin(), streams_.end(),
                   [](const Stream &src)
                   {
                     return std::any_of(src.substreams.begin(), src.substreams.end(),
                                        [](const Substream &sub)
                                        {
-                                         return sub.cam_pub.getNumSubscribers() > 0;
+                                         return sub.hasSubscribers();
                                        }
                                       );
                   }
-                 )
+                 ))
   ){
     aravis::camera::start_acquisition(p_camera_);
   }
 
-  this->get_integer_service_ = pnh.advertiseService("get_integer_feature_value", &CameraAravisNodelet::getIntegerFeatureCallback, this);
-  this->get_float_service_ = pnh.advertiseService("get_float_feature_value", &CameraAravisNodelet::getFloatFeatureCallback, this);
-  this->get_string_service_ = pnh.advertiseService("get_string_feature_value", &CameraAravisNodelet::getStringFeatureCallback, this);
-  this->get_boolean_service_ = pnh.advertiseService("get_boolean_feature_value", &CameraAravisNodelet::getBooleanFeatureCallback, this);
+  // feature services need a device, replay has none
+  if (p_device_)
+  {
+    this->get_integer_service_ = pnh.advertiseService("get_integer_feature_value", &CameraAravisNodelet::getIntegerFeatureCallback, this);
+    this->get_float_service_ = pnh.advertiseService("get_float_feature_value", &CameraAravisNodelet::getFloatFeatureCallback, this);
+    this->get_string_service_ = pnh.advertiseService("get_string_feature_value", &CameraAravisNodelet::getStringFeatureCallback, this);
+    this->get_boolean_service_ = pnh.advertiseService("get_boolean_feature_value", &CameraAravisNodelet::getBooleanFeatureCallback, this);
+    this->get_features_service_ = pnh.advertiseService("get_features", &CameraAravisNodelet::getFeaturesCallback, this);
+  }
 
-  this->set_integer_service_ = pnh.advertiseService("set_integer_feature_value", &CameraAravisNodelet::setIntegerFeatureCallback, this);
-  this->set_float_service_ = pnh.advertiseService("set_float_feature_value", &CameraAravisNodelet::setFloatFeatureCallback, this);
-  this->set_string_service_ = pnh.advertiseService("set_string_feature_value", &CameraAravisNodelet::setStringFeatureCallback, this);
-  this->set_boolean_service_ = pnh.advertiseService("set_boolean_feature_value", &CameraAravisNodelet::setBooleanFeatureCallback, this);
+  // monitor never writes features of the controlling driver's camera
+  if (p_device_ && !monitor_)
+  {
+    this->set_integer_service_ = pnh.advertiseService("set_integer_feature_value", &CameraAravisNodelet::setIntegerFeatureCallback, this);
+    this->set_float_service_ = pnh.advertiseService("set_float_feature_value", &CameraAravisNodelet::setFloatFeatureCallback, this);
+    this->set_string_service_ = pnh.advertiseService("set_string_feature_value", &CameraAravisNodelet::setStringFeatureCallback, this);
+    this->set_boolean_service_ = pnh.advertiseService("set_boolean_feature_value", &CameraAravisNodelet::setBooleanFeatureCallback, this);
+    this->set_features_service_ = pnh.advertiseService("set_features", &CameraAravisNodelet::setFeaturesCallback, this);
+  }
+
+  // capture blocks until frames are averaged, timers and reconfigure keep running on nodelet queue
+  ros::NodeHandle capture_nh(pnh);
+  capture_nh.setCallbackQueue(&capture_queue_);
+  this->capture_pixel_correction_service_ = capture_nh.advertiseService("capture_pixel_correction", &CameraAravisNodelet::capturePixelCorrectionCallback, this);
+  capture_spinner_.reset(new ros::AsyncSpinner(1, &capture_queue_));
+  capture_spinner_->start();
+
+  if (pre_trigger_seconds_ > 0.0)
+    this->freeze_pre_trigger_service_ = pnh.advertiseService("freeze_pre_trigger", &CameraAravisNodelet::freezePreTriggerCallback, this);
+
+  initDiagnostics();
+  initTracing();
 
   ROS_INFO("Done initializing camera_aravis.");
 }
 
 bool CameraAravisNodelet::getIntegerFeatureCallback(camera_aravis::get_integer_feature_value::Request& request, camera_aravis::get_integer_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   response.response = arv_device_get_integer_feature_value(this->p_device_, feature_name, error.storeError());
@@ -1093,17 +1963,21 @@ bool CameraAravisNodelet::getIntegerFeatureCallback(camera_aravis::get_integer_f
 
 bool CameraAravisNodelet::setIntegerFeatureCallback(camera_aravis::set_integer_feature_value::Request& request, camera_aravis::set_integer_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get());
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   guint64 value = request.value;
   arv_device_set_integer_feature_value(this->p_device_, feature_name, value, error.storeError());
   LOG_GERROR_ARAVIS(error);
+  if (!error)
+    control_channel_->wrote(request.feature, std::to_string(value));
   response.ok = !error;
   return true;
 }
 
 bool CameraAravisNodelet::getFloatFeatureCallback(camera_aravis::get_float_feature_value::Request& request, camera_aravis::get_float_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   response.response = arv_device_get_float_feature_value(this->p_device_, feature_name, error.storeError());
@@ -1113,17 +1987,21 @@ bool CameraAravisNodelet::getFloatFeatureCallback(camera_aravis::get_float_featu
 
 bool CameraAravisNodelet::setFloatFeatureCallback(camera_aravis::set_float_feature_value::Request& request, camera_aravis::set_float_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get());
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   const double value = request.value;
   arv_device_set_float_feature_value(this->p_device_, feature_name, value, error.storeError());
   LOG_GERROR_ARAVIS(error);
+  if (!error)
+    control_channel_->wrote(request.feature, std::to_string(value));
   response.ok = !error;
   return true;
 }
 
 bool CameraAravisNodelet::getStringFeatureCallback(camera_aravis::get_string_feature_value::Request& request, camera_aravis::get_string_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   response.response = arv_device_get_string_feature_value(this->p_device_, feature_name, error.storeError());
@@ -1133,17 +2011,21 @@ bool CameraAravisNodelet::getStringFeatureCallback(camera_aravis::get_string_fea
 
 bool CameraAravisNodelet::setStringFeatureCallback(camera_aravis::set_string_feature_value::Request& request, camera_aravis::set_string_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get());
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   const char* value = request.value.c_str();
   arv_device_set_string_feature_value(this->p_device_, feature_name, value, error.storeError());
   LOG_GERROR_ARAVIS(error);
+  if (!error)
+    control_channel_->wrote(request.feature, request.value);
   response.ok = !error;
   return true;
 }
 
 bool CameraAravisNodelet::getBooleanFeatureCallback(camera_aravis::get_boolean_feature_value::Request& request, camera_aravis::get_boolean_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   response.response = arv_device_get_boolean_feature_value(this->p_device_, feature_name, error.storeError());
@@ -1153,17 +2035,293 @@ bool CameraAravisNodelet::getBooleanFeatureCallback(camera_aravis::get_boolean_f
 
 bool CameraAravisNodelet::setBooleanFeatureCallback(camera_aravis::set_boolean_feature_value::Request& request, camera_aravis::set_boolean_feature_value::Response& response)
 {
+  ControlTransaction transaction(control_channel_.get());
   GuardedGError error;
   const char* feature_name = request.feature.c_str();
   const bool value = request.value;
   arv_device_set_boolean_feature_value(this->p_device_, feature_name, value, error.storeError());
   LOG_GERROR_ARAVIS(error);
+  if (!error)
+    control_channel_->wrote(request.feature, value ? "true" : "false");
   response.ok = !error;
   return true;
 }
 
+bool CameraAravisNodelet::readFeature(camera_aravis::FeatureValue& value, std::string& error)
+{
+  GuardedGError err;
+  const char* feature_name = value.feature.c_str();
+  switch (value.type)
+  {
+    case FeatureValue::INTEGER:
+      value.integer_value = arv_device_get_integer_feature_value(p_device_, feature_name, err.storeError());
+      break;
+    case FeatureValue::FLOAT:
+      value.float_value = arv_device_get_float_feature_value(p_device_, feature_name, err.storeError());
+      break;
+    case FeatureValue::STRING:
+    {
+      const char* text = arv_device_get_string_feature_value(p_device_, feature_name, err.storeError());
+      value.string_value = text ? text : "";
+      break;
+    }
+    case FeatureValue::BOOLEAN:
+      value.boolean_value = arv_device_get_boolean_feature_value(p_device_, feature_name, err.storeError());
+      break;
+    default:
+      error = "unknown feature type " + std::to_string(value.type);
+      return false;
+  }
+
+  if (err)
+  {
+    error = err->message;
+    return false;
+  }
+  return true;
+}
+
+bool CameraAravisNodelet::writeFeature(const camera_aravis::FeatureValue& value, std::string& error)
+{
+  GuardedGError err;
+  const char* feature_name = value.feature.c_str();
+  std::string text;
+  switch (value.type)
+  {
+    case FeatureValue::INTEGER:
+      arv_device_set_integer_feature_value(p_device_, feature_name, value.integer_value, err.storeError());
+      text = std::to_string(value.integer_value);
+      break;
+    case FeatureValue::FLOAT:
+      arv_device_set_float_feature_value(p_device_, feature_name, value.float_value, err.storeError());
+      text = std::to_string(value.float_value);
+      break;
+    case FeatureValue::STRING:
+      arv_device_set_string_feature_value(p_device_, feature_name, value.string_value.c_str(), err.storeError());
+      text = value.string_value;
+      break;
+    case FeatureValue::BOOLEAN:
+      arv_device_set_boolean_feature_value(p_device_, feature_name, value.boolean_value, err.storeError());
+      text = value.boolean_value ? "true" : "false";
+      break;
+    default:
+      error = "unknown feature type " + std::to_string(value.type);
+      return false;
+  }
+  if (err)
+  {
+    error = err->message;
+    return false;
+  }
+  control_channel_->wrote(value.feature, text);
+  return true;
+}
+
+bool CameraAravisNodelet::getFeaturesCallback(camera_aravis::GetFeatures::Request& request, camera_aravis::GetFeatures::Response& response)
+{
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
+
+  response.ok = true;
+  response.results.resize(request.features.size());
+  for (size_t i = 0; i < request.features.size(); i++)
+  {
+    FeatureResult &result = response.results[i];
+    result.value = request.features[i];
+    result.status = readFeature(result.value, result.message) ? FeatureResult::OK : FeatureResult::FAILED;
+    response.ok = response.ok && result.status == FeatureResult::OK;
+  }
+  return true;
+}
+
+bool CameraAravisNodelet::setFeaturesCallback(camera_aravis::SetFeatures::Request& request, camera_aravis::SetFeatures::Response& response)
+{
+  const std::vector<FeatureValue> &features = request.features;
+  response.results.resize(features.size());
+  for (size_t i = 0; i < features.size(); i++)
+  {
+    response.results[i].value = features[i];
+    response.results[i].status = FeatureResult::FAILED;
+  }
+
+  // writes refused because of a feature later in the batch (e.g. OffsetX before Width shrinks)
+  // succeed on another pass, repeat while passes make progress
+  std::vector<std::vector<size_t>> pending = featureWriteGroups(features);
+  while (!pending.empty())
+  {
+    size_t n_progress = 0;
+    std::vector<std::vector<size_t>> failed;
+
+    for (const std::vector<size_t> &group : pending)
+    {
+      // selectors and their values are not interleaved with other control traffic,
+      // triggers get in between groups
+      ControlTransaction transaction(control_channel_.get());
+
+      std::vector<size_t> retry;
+      for (size_t i : group)
+      {
+        const FeatureValue &value = features[i];
+        FeatureResult &result = response.results[i];
+        const bool selector = isSelectorFeature(value.feature);
+
+        // selectors are always written, they define what the following values address
+        FeatureValue current = value;
+        std::string error;
+        if (request.skip_unchanged && !selector && readFeature(current, error) && sameFeatureValue(current, value))
+        {
+          result.status = FeatureResult::SKIPPED;
+          result.message.clear();
+          n_progress++;
+        }
+        else if (writeFeature(value, result.message))
+        {
+          result.status = FeatureResult::OK;
+          result.message.clear();
+          n_progress += selector ? 0 : 1;
+        }
+
+        // failed values are retried behind their group's selectors
+        if (selector || result.status == FeatureResult::FAILED)
+          retry.push_back(i);
+      }
+
+      if (std::any_of(retry.begin(), retry.end(),
+                      [&response](size_t i) { return response.results[i].status == FeatureResult::FAILED; }))
+        failed.push_back(retry);
+    }
+
+    if (n_progress == 0)
+      break;
+    pending.swap(failed);
+  }
+
+  response.ok = std::all_of(response.results.begin(), response.results.end(),
+                            [](const FeatureResult &result) { return result.status != FeatureResult::FAILED; });
+  for (const FeatureResult &result : response.results)
+    if (result.status == FeatureResult::FAILED)
+      ROS_WARN("set_features: %s failed: %s", result.value.feature.c_str(), result.message.c_str());
+
+  return true;
+}
+
+bool CameraAravisNodelet::capturePixelCorrectionCallback(camera_aravis::CapturePixelCorrection::Request& request, camera_aravis::CapturePixelCorrection::Response& response)
+{
+  response.ok = false;
+
+  if (request.map != "dark" && request.map != "flat")
+  {
+    response.message = "map has to be dark or flat";
+    return true;
+  }
+
+  Substream *p_substream = nullptr;
+  for (Stream &stream : streams_)
+    for (Substream &substream : stream.substreams)
+      if (!p_substream && (request.substream.empty() || substream.name == request.substream))
+        p_substream = &substream;
+
+  if (!p_substream || !p_substream->pixel_correction)
+  {
+    response.message = "no substream '" + request.substream + "' with mono or Bayer pixel format";
+    return true;
+  }
+
+  PixelCorrection &correction = *p_substream->pixel_correction;
+  const size_t frames = std::max<uint32_t>(request.frames, 1);
+  const double frame_rate = config_.AcquisitionFrameRate > 0.0 ? config_.AcquisitionFrameRate : 1.0;
+
+  ROS_INFO("Capturing %s map of %s from %zu frames", request.map.c_str(), p_substream->name.c_str(), frames);
+  correction.startCapture(request.map == "dark" ? PixelCorrection::CAPTURE_DARK : PixelCorrection::CAPTURE_FLAT, frames);
+
+  // capture counts as subscriber, acquisition runs for it and stops after unless subscribed
+  rosConnectCallback();
+  const bool captured = correction.waitCapture(frames / frame_rate + 5.0);
+  rosConnectCallback();
+
+  if (!captured)
+  {
+    response.message = "timeout, no frames received (is the camera triggered?)";
+    return true;
+  }
+
+  if (p_substream->pixel_correction_file.empty() || !correction.save(p_substream->pixel_correction_file))
+  {
+    response.message = "captured but not saved to '" + p_substream->pixel_correction_file + "'";
+    return true;
+  }
+
+  response.ok = true;
+  response.message = "saved to " + p_substream->pixel_correction_file;
+  return true;
+}
+
+bool CameraAravisNodelet::freezePreTriggerCallback(camera_aravis::FreezePreTrigger::Request& request, camera_aravis::FreezePreTrigger::Response& response)
+{
+  response.ok = false;
+  response.frames = 0;
+
+  // rings continue filling with live frames while frozen frames are written, within what flush releases
+  std::vector<RingFrame> frames;
+  for (Stream &stream : streams_)
+    for (Substream &substream : stream.substreams)
+      if (substream.frame_ring)
+      {
+        std::deque<RingFrame> ring = substream.frame_ring->freeze();
+        frames.insert(frames.end(), std::make_move_iterator(ring.begin()), std::make_move_iterator(ring.end()));
+      }
+
+  if (frames.empty())
+  {
+    response.message = "pre-trigger ring is empty";
+    return true;
+  }
+
+  // substreams interleaved in time order like live recording
+  std::stable_sort(frames.begin(), frames.end(), [](const RingFrame &a, const RingFrame &b)
+                   { return a.record.stamp_ns < b.record.stamp_ns; });
+
+  size_t n_bytes = 0;
+  for (const RingFrame &frame : frames)
+    n_bytes += frame.image->data.size();
+
+  std::lock_guard<std::mutex> lock(pre_trigger_mutex_);
+
+  // finished flushes are closed here, their files are complete then
+  pre_trigger_flushes_.erase(std::remove_if(pre_trigger_flushes_.begin(), pre_trigger_flushes_.end(),
+                                            [](const std::unique_ptr<FrameRecorder> &flush) { return flush->idle(); }),
+                             pre_trigger_flushes_.end());
+
+  ros::NodeHandle pnh = getPrivateNodeHandle();
+  const size_t block_size = std::max(pnh.param<int>("record_block_mb", 8), 1) * size_t(1024 * 1024);
+  const std::string directory = timestampedDirectory(request.directory.empty() ? pre_trigger_directory_ : request.directory);
+
+  // queue takes all frozen frames, writer releases their buffers as it goes
+  std::unique_ptr<FrameRecorder> flush(new FrameRecorder(directory, recordedSubstreams(), n_bytes + 1, block_size));
+  if (!flush->isOpen())
+  {
+    response.message = "can't write " + directory;
+    return true;
+  }
+
+  for (const RingFrame &frame : frames)
+    flush->push(frame.record, frame.image);
+
+  const double seconds = (frames.back().record.stamp_ns - frames.front().record.stamp_ns) * 1e-9;
+  ROS_INFO("Pre-trigger ring frozen, writing %zu frames (%.2f s) to %s", frames.size(), seconds, directory.c_str());
+
+  pre_trigger_flushes_.push_back(std::move(flush));
+  response.ok = true;
+  response.path = directory;
+  response.frames = frames.size();
+  response.message = "writing " + std::to_string(frames.size()) + " frames in background";
+  return true;
+}
+
 void CameraAravisNodelet::resetPtpClock()
 {
+  // status check and toggle in one transaction
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
+
   // a PTP slave can take the following states: Slave, Listening, Uncalibrated, Faulty, Disabled
   std::string ptp_status(aravis::device::feature::get_string(p_device_, "GevIEEE1588Status"));
   if (ptp_status == std::string("Faulty") || ptp_status == std::string("Disabled"))
@@ -1179,6 +2337,8 @@ void CameraAravisNodelet::cameraAutoInfoCallback(const CameraAutoInfoConstPtr &m
 {
   if (config_.AutoSlave && p_device_)
   {
+    // selector and value writes must not interleave with other threads
+    ControlTransaction transaction(control_channel_.get());
 
     if (auto_params_.exposure_time != msg_ptr->exposure_time && implemented_features_["ExposureTime"])
     {
@@ -1292,6 +2452,9 @@ void CameraAravisNodelet::syncAutoParameters()
 
   if (p_device_)
   {
+    // selector and value reads must not interleave with other threads, priority of the caller
+    ControlTransaction transaction(control_channel_.get());
+
     if (implemented_features_["ExposureTime"])
     {
       auto_params_.exposure_time = aravis::device::feature::get_float(p_device_, "ExposureTime");
@@ -1505,6 +2668,8 @@ void CameraAravisNodelet::rosReconfigureCallback(Config &config, uint32_t level)
   const bool changed_trigger_mode = (config_.TriggerMode != config.TriggerMode);
   const bool changed_trigger_source = (config_.TriggerSource != config.TriggerSource) || changed_trigger_mode;
   const bool changed_focus_pos = (config_.FocusPos != config.FocusPos);
+  const bool changed_trace_latency = (config_.TraceLatency != config.TraceLatency);
+  const bool changed_pixel_correction = (config_.PixelCorrection != config.PixelCorrection);
 
   if (changed_auto_master)
   {
@@ -1598,12 +2763,8 @@ void CameraAravisNodelet::rosReconfigureCallback(Config &config, uint32_t level)
 
   if (changed_trigger_source)
   {
-    // delete old software trigger thread if active
-    software_trigger_active_ = false;
-    if (software_trigger_thread_.joinable())
-    {
-      software_trigger_thread_.join();
-    }
+    // delete old trigger scheduler if active
+    trigger_scheduler_.reset();
 
     if (implemented_features_["TriggerSource"])
     {
@@ -1621,16 +2782,31 @@ void CameraAravisNodelet::rosReconfigureCallback(Config &config, uint32_t level)
       if (implemented_features_["TriggerSoftware"])
       {
         config_.softwaretriggerrate = config.softwaretriggerrate;
-        ROS_INFO("Set softwaretriggerrate = %f", 1000.0 / ceil(1000.0 / config.softwaretriggerrate));
+        ROS_INFO("Set softwaretriggerrate = %f", config.softwaretriggerrate);
 
-        // Turn on software timer callback.
-        software_trigger_thread_ = std::thread(&CameraAravisNodelet::softwareTriggerLoop, this);
+        // Turn on software trigger scheduler.
+        startTrigger(false);
       }
       else
       {
         ROS_INFO("Camera does not support TriggerSoftware command.");
       }
     }
+    // action master triggers its own camera and all others sharing the keys
+    else if (config.TriggerMode.compare("On") == 0 && config.TriggerSource.compare(0, 6, "Action") == 0 &&
+             action_sender_)
+    {
+      config_.softwaretriggerrate = config.softwaretriggerrate;
+      ROS_INFO("Set action trigger rate = %f", config.softwaretriggerrate);
+
+      startTrigger(true);
+    }
+  }
+  else if (trigger_scheduler_ && config_.softwaretriggerrate != config.softwaretriggerrate)
+  {
+    // running trigger keeps its phase
+    ROS_INFO("Set softwaretriggerrate = %f", config.softwaretriggerrate);
+    trigger_scheduler_->setRate(config.softwaretriggerrate);
   }
 
   if (changed_focus_pos)
@@ -1647,6 +2823,18 @@ void CameraAravisNodelet::rosReconfigureCallback(Config &config, uint32_t level)
       ROS_INFO("Camera does not support FocusPos.");
   }
 
+  if (changed_trace_latency)
+  {
+    ROS_INFO("Set TraceLatency = %s", config.TraceLatency ? "True" : "False");
+    trace_latency_ = config.TraceLatency;
+  }
+
+  if (changed_pixel_correction)
+  {
+    ROS_INFO("Set PixelCorrection = %s", config.PixelCorrection ? "True" : "False");
+    pixel_correction_enabled_ = config.PixelCorrection;
+  }
+
   if (changed_acquisition_mode)
   {
     if (implemented_features_["AcquisitionMode"])
@@ -1668,23 +2856,31 @@ void CameraAravisNodelet::rosReconfigureCallback(Config &config, uint32_t level)
   reconfigure_mutex_.unlock();
 }
 
+bool CameraAravisNodelet::anySubscribers() const
+{
+  return std::any_of(streams_.begin(), streams_.end(),
+                     [](const Stream &src)
+                     {
+                       return std::any_of(src.substreams.begin(), src.substreams.end(),
+                                          [](const Substream &sub)
+                                          {
+                                            return sub.hasSubscribers();
+                                          }
+                                         );
+                     }
+                    );
+}
+
 void CameraAravisNodelet::rosConnectCallback()
 {
-  if (p_device_)
+  // cached for the trigger thread, querying publishers on every trigger is expensive
+  subscribed_ = anySubscribers();
+
+  // monitors depend on multicast acquisition, it's not stopped for lack of local subscribers
+  if (p_device_ && !monitor_ && multicast_address_.empty())
   {
     // are all substreams of all streams disabled?
-    if (std::all_of(streams_.begin(), streams_.end(),
-                    [](const Stream &src)
-                    {
-                      return std::all_of(src.substreams.begin(), src.substreams.end(),
-                                         [](const Substream &sub)
-                                         {
-                                           return sub.cam_pub.getNumSubscribers() == 0;
-                                         }
-                                        );
-                    }
-                   )
-    )
+    if (!subscribed_)
     {
       aravis::device::execute_command(p_device_, "AcquisitionStop"); // don't waste CPU if nobody is listening!
     }
@@ -1702,20 +2898,136 @@ void CameraAravisNodelet::newBufferReadyCallback(ArvStream *p_stream, gpointer c
   CameraAravisNodelet *p_can = (CameraAravisNodelet*) data->can;
   size_t stream_id = data->stream_id;
 
-  p_can->newBufferReady(p_stream, stream_id);
+  p_can->newBufferReady(p_stream, arv_stream_try_pop_buffer(p_stream), stream_id);
 
-  // publish current lighting settings if this camera is configured as master
-  if (p_can->config_.AutoMaster)
+  p_can->publishAutoParameters();
+}
+
+void CameraAravisNodelet::deliveryThreadMain(const int stream_id)
+{
+  // short enough to notice termination timely
+  const guint64 POP_TIMEOUT_US = 100000;
+
+  ArvStream *p_stream = streams_[stream_id].p_stream;
+
+  if (stream_id < delivery_cpus_.size() && delivery_cpus_[stream_id] >= 0)
   {
-    p_can->syncAutoParameters();
-    p_can->auto_pub_.publish(p_can->auto_params_);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(delivery_cpus_[stream_id], &cpu_set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+      ROS_WARN("Could not pin delivery thread for stream %d to CPU %d", stream_id, delivery_cpus_[stream_id]);
   }
+
+  ROS_INFO_STREAM("Started delivery thread for stream " << stream_id);
+
+  while (delivery_active_ && ros::ok())
+  {
+    ArvBuffer *p_buffer = arv_stream_timeout_pop_buffer(p_stream, POP_TIMEOUT_US);
+
+    newBufferReady(p_stream, p_buffer, stream_id);
+
+    if (p_buffer)
+      publishAutoParameters();
+  }
+
+  ROS_INFO_STREAM("Finished delivery thread for stream " << stream_id);
 }
 
-void CameraAravisNodelet::newBufferReady(ArvStream *p_stream, size_t stream_id)
+void CameraAravisNodelet::replayThreadMain()
 {
-  ArvBuffer *p_buffer = arv_stream_try_pop_buffer(p_stream);
+  const RecordingReader &reader = *replay_reader_;
+  // substream threads append records in write order, stamps of different substreams may interleave
+  uint64_t first_stamp_ns = reader.record(0).stamp_ns;
+  for (size_t i = 1; i < reader.size(); ++i)
+    first_stamp_ns = std::min(first_stamp_ns, reader.record(i).stamp_ns);
+
+  ROS_INFO("Replay started.");
+  do
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < reader.size() && replay_active_ && ros::ok(); ++i)
+    {
+      const FrameRecord &record = reader.record(i);
 
+      if (replay_rate_ > 0.0)
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(
+            int64_t((record.stamp_ns - first_stamp_ns) / replay_rate_)));
+
+      Stream &stream = streams_[record.substream];
+      stream.frame_loss->addReceived(record.frame_id, true);
+
+      if (!stream.substreams[0].hasSubscribers())
+      {
+        stream.frame_loss->addLost(LOSS_NO_SUBSCRIBER);
+        continue;
+      }
+
+      // recorded payload takes the place of camera buffer data
+      sensor_msgs::ImagePtr msg_ptr = stream.p_buffer_pool->getRecyclableImg();
+      if (replay_restamp_)
+        msg_ptr->header.stamp = ros::Time::now();
+      else
+        msg_ptr->header.stamp.fromNSec(record.stamp_ns);
+      msg_ptr->header.seq = record.frame_id;
+      msg_ptr->header.frame_id = stream.substreams[0].frame_id;
+      msg_ptr->width = record.width;
+      msg_ptr->height = record.height;
+      msg_ptr->step = record.step;
+      msg_ptr->encoding = stream.substreams[0].sensor.pixel_format;
+      msg_ptr->data.assign(reader.payload(i), reader.payload(i) + record.size);
+
+      stream.frame_loss->addDelivered();
+      delegateImage(nullptr, msg_ptr, record.substream, 1, process_inline_);
+    }
+  } while (replay_loop_ && replay_active_ && ros::ok());
+  // no more frames are expected
+  replay_active_ = false;
+  ROS_INFO("Replay finished.");
+}
+
+void CameraAravisNodelet::multicastFrameReady(size_t stream_id, GvspFrame &frame)
+{
+  Stream &stream = streams_[stream_id];
+  Substream &substream = stream.substreams[0];
+
+  stream.frame_loss->addReceived(frame.block_id, true);
+
+  if (!substream.hasSubscribers())
+  {
+    stream.frame_loss->addLost(LOSS_NO_SUBSCRIBER);
+    return;
+  }
+
+  // reassembled payload is swapped in, the image's previous storage is reused for the next block
+  sensor_msgs::ImagePtr msg_ptr = stream.p_buffer_pool->getRecyclableImg();
+  msg_ptr->data.swap(frame.data);
+  msg_ptr->header.stamp.fromNSec(use_ptp_stamp_ ? frame.timestamp : frame.arrival_ns);
+  msg_ptr->header.seq = frame.block_id;
+  msg_ptr->header.frame_id = substream.frame_id;
+  msg_ptr->width = frame.width;
+  msg_ptr->height = frame.height;
+  msg_ptr->encoding = substream.sensor.pixel_format;
+  msg_ptr->step = (frame.width * substream.sensor.n_bits_pixel) / 8;
+
+  stream.frame_loss->addDelivered();
+  delegateImage(nullptr, msg_ptr, stream_id, 1, process_inline_);
+}
+
+void CameraAravisNodelet::publishAutoParameters()
+{
+  if (config_.AutoMaster)
+  {
+    ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
+    syncAutoParameters();
+    auto_pub_.publish(auto_params_);
+  }
+}
+
+void CameraAravisNodelet::newBufferReady(ArvStream *p_stream, ArvBuffer *p_buffer, size_t stream_id)
+{
   // check if we risk to drop the next image because of not enough buffers left
   gint n_available_buffers;
   arv_stream_get_n_buffers(p_stream, &n_available_buffers, NULL);
@@ -1728,17 +3040,31 @@ void CameraAravisNodelet::newBufferReady(ArvStream *p_stream, size_t stream_id)
   if(p_buffer == nullptr)
     return;
 
-  bool buffer_success = arv_buffer_get_status(p_buffer) == ARV_BUFFER_STATUS_SUCCESS;
+  ArvBufferStatus buffer_status = arv_buffer_get_status(p_buffer);
+  bool buffer_success = buffer_status == ARV_BUFFER_STATUS_SUCCESS;
   bool buffer_pool = (bool)stream.p_buffer_pool;
   bool has_subscribers = std::any_of(stream.substreams.begin(), stream.substreams.end(),
                                      [](const Substream &sub)
-                                       { return sub.cam_pub.getNumSubscribers() > 0; });
+                                       { return sub.hasSubscribers(); });
 
   const Substream &sub = stream.substreams[0];
   const std::string &frame_id_msg = sub.frame_id + " (and possibly subframes)";
 
+  // failed buffers may not have frame id filled in
+  const guint64 frame_id = arv_buffer_get_frame_id(p_buffer);
+  const uint64_t n_gap = stream.frame_loss->addReceived(frame_id, buffer_success || frame_id);
+
+  if (n_gap)
+    ROS_WARN("(%s) Frame id gap: %lu frame(s) never received before frame %lu",
+             frame_id_msg.c_str(), (unsigned long)n_gap, (unsigned long)frame_id);
+
   if (!buffer_success)
-    ROS_WARN("(%s) Frame error: %s", frame_id_msg.c_str(), szBufferStatusFromInt[arv_buffer_get_status(p_buffer)]);
+  {
+    ROS_WARN("(%s) Frame error: %s", frame_id_msg.c_str(), szBufferStatusFromInt[buffer_status]);
+    stream.frame_loss->addLost(frameLossReasonFromStatus(buffer_status));
+  }
+  else if (!has_subscribers)
+    stream.frame_loss->addLost(LOSS_NO_SUBSCRIBER);
 
   if(!buffer_success || !buffer_pool || !has_subscribers)
   {
@@ -1747,6 +3073,7 @@ void CameraAravisNodelet::newBufferReady(ArvStream *p_stream, size_t stream_id)
   }
 
   // at this point we have a valid buffer to work with
+  stream.frame_loss->addDelivered();
   delegateBuffer(p_buffer, stream_id);
 }
 
@@ -1757,9 +3084,11 @@ void CameraAravisNodelet::delegateBuffer(ArvBuffer *p_buffer, size_t stream_id)
   switch(payloadType)
   {
     case ARV_BUFFER_PAYLOAD_TYPE_IMAGE:
-        return delegateBuffer(p_buffer, stream_id, 1);
+        // nothing to gain from handover if there is no pixel work
+        return delegateBuffer(p_buffer, stream_id, 1,
+                              process_inline_ || publishInline(streams_[stream_id].substreams[0]));
     case ARV_BUFFER_PAYLOAD_TYPE_MULTIPART:
-        return delegateBuffer(p_buffer, stream_id, arv_buffer_get_n_parts(p_buffer));
+        return delegateBuffer(p_buffer, stream_id, arv_buffer_get_n_parts(p_buffer), process_inline_);
     case ARV_BUFFER_PAYLOAD_TYPE_CHUNK_DATA:
         return delegateChunkDataBuffer(p_buffer, stream_id);
     default:
@@ -1768,15 +3097,66 @@ void CameraAravisNodelet::delegateBuffer(ArvBuffer *p_buffer, size_t stream_id)
   }
 }
 
-void CameraAravisNodelet::delegateBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substreams)
+bool CameraAravisNodelet::publishInline(const Substream &substream) const
+{
+  if (!publish_inline_ || !substream.rename_only || substream.demosaic)
+    return false;
+
+  // device round trips wait on control channel, don't block aravis' receiving thread with them
+  if (pub_ext_camera_info_ || use_ptp_stamp_)
+    return false;
+
+  if (substream.pixel_correction && (pixel_correction_enabled_ || substream.capturingCorrection()))
+    return false;
+
+  // any output beyond relabeled image and native image does pixel work or copies
+  return substream.preview_pub.getNumSubscribers() == 0 && substream.display_pub.getNumSubscribers() == 0 &&
+         substream.rect_pub.getNumSubscribers() == 0 && substream.compressed_pub.getNumSubscribers() == 0 &&
+         substream.pyramidLevels() == 0 && !substream.softwareROISubscribed() &&
+         !substream.recorded && !substream.frame_ring;
+}
+
+void CameraAravisNodelet::delegateBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substreams, bool process_inline)
+{
+  // get the image message which wraps around buffer
+  // for image payload this maps 1:1 to image data
+  // for multipart payload this is shared resource for all parts
+  // it is from pool on stream level (not substream)
+  sensor_msgs::ImagePtr msg_ptr = (*(streams_[stream_id].p_buffer_pool))[p_buffer];
+  delegateImage(p_buffer, msg_ptr, stream_id, substreams, process_inline);
+}
+
+void CameraAravisNodelet::delegateImage(ArvBuffer *p_buffer, const sensor_msgs::ImagePtr &msg_ptr, size_t stream_id,
+                                        size_t substreams, bool process_inline)
 {
   Stream &stream = streams_[stream_id];
+  const uint64_t delegate_ns = frameTraceNow();
+
+  // publish inline is decided per frame, frame still waiting for substream thread goes first
+  // and one still processed there finishes before, both hold processing lock
+  std::unique_lock<std::mutex> processing_lock;
+  if (process_inline && !process_inline_)
+  {
+    Substream &substream = stream.substreams[0];
+    std::lock_guard<std::mutex> lock_guard(substream.buffer_data_mutex);
+    process_inline = !substream.p_buffer_image;
+    if (process_inline)
+      processing_lock = std::unique_lock<std::mutex>(substream.processing_mutex);
+  }
 
-  // get the image message which wraps around buffer
-  // for image payload this maps 1:1 to image data
-  // for multipart payload this is shared resource for all parts
-  // it is from pool on stream level (not substream)
-  sensor_msgs::ImagePtr msg_ptr = (*(stream.p_buffer_pool))[p_buffer];
+  if (process_inline)
+  {
+    for(guint i = 0; i < substreams; ++i)
+    {
+      FrameTrace trace;
+      trace.delegate_ns = trace.dequeue_ns = delegate_ns;
+      //processing may replace the image with converted one
+      sensor_msgs::ImagePtr substream_msg_ptr = msg_ptr;
+      processBuffer(p_buffer, stream_id, i, substream_msg_ptr, trace);
+    }
+    //buffer returns to aravis when msg_ptr goes out of scope
+    return;
+  }
 
   for(guint i = 0; i < substreams; ++i)
   {
@@ -1786,10 +3166,15 @@ void CameraAravisNodelet::delegateBuffer(ArvBuffer *p_buffer, size_t stream_id,
         std::lock_guard<std::mutex> lock_guard(substream.buffer_data_mutex);
 
         if(substream.p_buffer)
+        {
           ROS_WARN_STREAM("Dropped unprocessed data for steam " << stream_id << " " << substream.name);
+          substream.statistics.addQueueDrop();
+          stream.frame_loss->addLost(LOSS_QUEUE_DROP);
+        }
 
         substream.p_buffer = p_buffer;
         substream.p_buffer_image = msg_ptr;
+        substream.p_buffer_delegate_ns = delegate_ns;
       }
       //wake up substream processing thread in substreamThreadMain
       substream.buffer_ready_condition.notify_one();
@@ -1837,59 +3222,74 @@ void CameraAravisNodelet::substreamThreadMain(const int stream_id, const int sub
     sensor_msgs::ImagePtr p_buffer_image = substream.p_buffer_image;
     substream.p_buffer_image.reset();
 
+    //spurious wake up
+    if(!p_buffer_image)
+      continue;
+
     ArvBuffer *p_buffer = substream.p_buffer;
     substream.p_buffer = nullptr;
 
+    FrameTrace trace;
+    trace.delegate_ns = substream.p_buffer_delegate_ns;
+
+    //taken before data lock is released, inline publishing waits for this frame
+    std::unique_lock<std::mutex> processing_lock(substream.processing_mutex);
+
     //no need to keep the lock for processing time,
     lock.unlock();
 
-    #ifdef ARAVIS_BUFFER_PROCESSING_BENCHMARK
-      ros::Time t_begin = ros::Time::now();
-    #endif
+    trace.dequeue_ns = frameTraceNow();
+
+    processBuffer(p_buffer, stream_id, substream_id, p_buffer_image, trace);
+  }
 
-    ArvBufferPayloadType payloadType = arv_buffer_get_payload_type(p_buffer);
+  ROS_INFO_STREAM("Finished thread for stream " << stream_id << " " << substream.name);
+}
 
-    if(payloadType == ARV_BUFFER_PAYLOAD_TYPE_IMAGE)
-      processImageBuffer(p_buffer, stream_id, p_buffer_image);
-    else if(payloadType == ARV_BUFFER_PAYLOAD_TYPE_MULTIPART)
-      processPartBuffer(p_buffer, stream_id, substream_id);
-    else
-        ROS_ERROR("Ignoring unsupported buffer type: %d", payloadType);
+void CameraAravisNodelet::processBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id,
+                                        sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace)
+{
+  Substream &substream = streams_[stream_id].substreams[substream_id];
+
+  ArvBufferPayloadType payloadType = p_buffer ? arv_buffer_get_payload_type(p_buffer) : ARV_BUFFER_PAYLOAD_TYPE_IMAGE;
 
-    #ifdef ARAVIS_BUFFER_PROCESSING_BENCHMARK
-      ros::Time t_buff = ros::Time::now();
-      const double NS_IN_MS = 1000000.0;
-      ROS_INFO_STREAM("aravis stream " << stream_id << " " << substream.name <<
-                      " buffer processing time: " <<
-                      (t_buff - t_begin).toNSec() / NS_IN_MS << " ms");
-    #endif
+  if(!p_buffer)
+    processFilledImage(stream_id, msg_ptr, trace);
+  else if(payloadType == ARV_BUFFER_PAYLOAD_TYPE_IMAGE)
+    processImageBuffer(p_buffer, stream_id, msg_ptr, trace);
+  else if(payloadType == ARV_BUFFER_PAYLOAD_TYPE_MULTIPART)
+    processPartBuffer(p_buffer, stream_id, substream_id, trace);
+  else
+  {
+    ROS_ERROR("Ignoring unsupported buffer type: %d", payloadType);
+    return;
   }
 
-  ROS_INFO_STREAM("Finished thread for stream " << stream_id << " " << substream.name);
+  substream.statistics.addPublished(frameTraceInterval(trace.convert_begin_ns, trace.convert_end_ns),
+                                    frameTraceInterval(trace.arrival_ns, trace.publish_ns));
+
+  if (trace_latency_)
+    substream.trace_ring.push(trace);
 }
 
-void CameraAravisNodelet::processImageBuffer(ArvBuffer *p_buffer, size_t stream_id, sensor_msgs::ImagePtr &msg_ptr)
+void CameraAravisNodelet::processImageBuffer(ArvBuffer *p_buffer, size_t stream_id, sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace)
 {
   Stream &src = streams_[stream_id];
   Substream &substream = src.substreams[0];
   const Sensor &sensor = substream.sensor;
   ROI &roi = substream.roi;
 
+  // p_buffer may go back to aravis as soon as msg_ptr is replaced by converted image
+  trace.frame_id = arv_buffer_get_frame_id(p_buffer);
+  trace.camera_ns = arv_buffer_get_timestamp(p_buffer);
+  trace.arrival_ns = arv_buffer_get_system_timestamp(p_buffer);
+
   //check if received ROI matches initialized
   adaptROI(p_buffer, roi, stream_id);
   //msg_ptr is ROS Image that wraps around aravis p_buffer data
   fillImage(msg_ptr, p_buffer, substream.frame_id, sensor, roi);
 
-  // do the magic of conversion into a ROS format
-  if (substream.convert_format) {
-    sensor_msgs::ImagePtr cvt_msg_ptr = src.p_buffer_pool->getRecyclableImg();
-    substream.convert_format(msg_ptr, cvt_msg_ptr);
-    msg_ptr = cvt_msg_ptr;
-  }
-
-  fillCameraInfo(substream, msg_ptr->header, roi);
-
-  substream.cam_pub.publish(msg_ptr, substream.camera_info);
+  publishImage(substream, src.p_buffer_pool, msg_ptr, roi, trace);
 
   publishExtendedCameraInfo(substream, stream_id);
 
@@ -1898,7 +3298,7 @@ void CameraAravisNodelet::processImageBuffer(ArvBuffer *p_buffer, size_t stream_
     resetPtpClock();
 }
 
-void CameraAravisNodelet::processPartBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id)
+void CameraAravisNodelet::processPartBuffer(ArvBuffer *p_buffer, size_t stream_id, size_t substream_id, FrameTrace &trace)
 {
   Stream &src = streams_[stream_id];
   Substream &substream = src.substreams[substream_id];
@@ -1919,16 +3319,11 @@ void CameraAravisNodelet::processPartBuffer(ArvBuffer *p_buffer, size_t stream_i
   msg_ptr->data.resize(size);
   memcpy(msg_ptr->data.data(), data, size);
 
-  // do the magic of conversion into a ROS format
-  if (substream.convert_format) {
-    sensor_msgs::ImagePtr cvt_msg_ptr = substream.p_buffer_pool->getRecyclableImg();
-    substream.convert_format(msg_ptr, cvt_msg_ptr);
-    msg_ptr = cvt_msg_ptr;
-  }
-
-  fillCameraInfo(substream, msg_ptr->header, roi);
+  trace.frame_id = arv_buffer_get_frame_id(p_buffer);
+  trace.camera_ns = arv_buffer_get_timestamp(p_buffer);
+  trace.arrival_ns = arv_buffer_get_system_timestamp(p_buffer);
 
-  substream.cam_pub.publish(msg_ptr, substream.camera_info);
+  publishImage(substream, substream.p_buffer_pool, msg_ptr, roi, trace);
 
   publishExtendedCameraInfo(substream, stream_id);
 
@@ -1937,6 +3332,209 @@ void CameraAravisNodelet::processPartBuffer(ArvBuffer *p_buffer, size_t stream_i
     resetPtpClock();
 }
 
+void CameraAravisNodelet::processFilledImage(size_t stream_id, sensor_msgs::ImagePtr &msg_ptr, FrameTrace &trace)
+{
+  Stream &src = streams_[stream_id];
+  Substream &substream = src.substreams[0];
+  ROI &roi = substream.roi;
+
+  // replayed or multicast received image is filled in already, injection time stands in for arrival
+  trace.frame_id = msg_ptr->header.seq;
+  trace.camera_ns = msg_ptr->header.stamp.toNSec();
+  trace.arrival_ns = trace.delegate_ns;
+
+  roi.width = msg_ptr->width;
+  roi.height = msg_ptr->height;
+
+  publishImage(substream, src.p_buffer_pool, msg_ptr, roi, trace);
+}
+
+void CameraAravisNodelet::publishImage(Substream &substream, const CameraBufferPool::Ptr &p_pool,
+                                       sensor_msgs::ImagePtr &msg_ptr, const ROI &roi, FrameTrace &trace)
+{
+  // each output is computed only if subscribed, outputs share conversion within frame
+  const bool publish_converted = substream.cam_pub.getNumSubscribers() > 0;
+  const bool publish_native = substream.native_pub.getNumSubscribers() > 0;
+  const bool publish_preview = substream.preview_pub.getNumSubscribers() > 0;
+  const bool publish_display = substream.display_pub.getNumSubscribers() > 0;
+  const bool publish_rect = substream.rect_pub.getNumSubscribers() > 0;
+  const bool publish_compressed = substream.compressed_pub.getNumSubscribers() > 0;
+  const bool convert_other = publish_converted || publish_preview || publish_rect || publish_compressed ||
+                             substream.pyramidLevels() > 0 || substream.softwareROISubscribed() ||
+                             substream.capturingCorrection();
+  // packed formats are corrected after unpacking, fused path would skip correction
+  const bool correct_converted = substream.pixel_correction && !substream.correct_native &&
+                                 (pixel_correction_enabled_ || substream.capturingCorrection());
+  // if display is the only converted output, packed formats are unpacked straight to 8 bit
+  const bool display_fused = publish_display && !convert_other && substream.tone_map_native && !correct_converted;
+  const bool convert = convert_other || (publish_display && !display_fused);
+
+  fillCameraInfo(substream, msg_ptr->header, roi);
+
+  // recorder and pre-trigger ring hold native image, in-place conversion copies it then
+  sensor_msgs::ImageConstPtr native_msg_ptr;
+  if (substream.recorded || substream.frame_ring) {
+    recordFrame(substream, msg_ptr, roi);
+    native_msg_ptr = msg_ptr;
+  }
+
+  // relabeling is no pixel work, native image is published in ROS encoding then
+  if (substream.convert_format && substream.rename_only && (convert || publish_native))
+    substream.convert_format(msg_ptr, msg_ptr);
+
+  // native image is published uncorrected
+  if (publish_native) {
+    substream.native_pub.publish(msg_ptr, substream.camera_info);
+    native_msg_ptr = msg_ptr;
+  }
+
+  // do the magic of conversion into a ROS format
+  trace.convert_begin_ns = frameTraceNow();
+  if (substream.correct_native && (convert || display_fused))
+    correctPixels(substream, p_pool, msg_ptr);
+
+  if (display_fused) {
+    sensor_msgs::ImagePtr display_msg_ptr = p_pool->getRecyclableImg();
+    substream.tone_map_native(msg_ptr, display_msg_ptr);
+    if (display_msg_ptr)
+      substream.display_pub.publish(display_msg_ptr, substream.camera_info);
+  }
+
+  if (substream.convert_format && !substream.rename_only && convert) {
+    sensor_msgs::ImagePtr in_msg_ptr = msg_ptr;
+    if (substream.convert_in_place && msg_ptr == native_msg_ptr) {
+      // don't overwrite already published native image
+      in_msg_ptr = p_pool->getRecyclableImg();
+      *in_msg_ptr = *msg_ptr;
+    }
+    sensor_msgs::ImagePtr cvt_msg_ptr = p_pool->getRecyclableImg();
+    substream.convert_format(in_msg_ptr, cvt_msg_ptr);
+    msg_ptr = cvt_msg_ptr;
+  }
+
+  if (correct_converted && convert)
+    correctPixels(substream, p_pool, msg_ptr);
+
+  if (substream.demosaic && convert) {
+    sensor_msgs::ImagePtr color_msg_ptr = p_pool->getRecyclableImg();
+    substream.demosaic(msg_ptr, color_msg_ptr);
+    msg_ptr = color_msg_ptr;
+  }
+  trace.convert_end_ns = frameTraceNow();
+
+  if (publish_converted)
+    substream.cam_pub.publish(msg_ptr, substream.camera_info);
+  trace.publish_ns = frameTraceNow();
+
+  // queued image holds its pool buffer until compressed, full queue drops frame
+  if (publish_compressed)
+    compression_workers_->push(msg_ptr, substream.compressed_pub);
+
+  if (publish_rect) {
+    // offset in calibrated image is calibration ROI if set, hardware ROI otherwise
+    const sensor_msgs::CameraInfo &info = *substream.camera_info;
+    const bool info_roi = info.roi.width > 0 && info.roi.height > 0;
+    if (substream.rectifier.update(info, msg_ptr->width, msg_ptr->height,
+                                   info_roi ? info.roi.x_offset : roi.x, info_roi ? info.roi.y_offset : roi.y)) {
+      sensor_msgs::ImagePtr rect_msg_ptr = p_pool->getRecyclableImg();
+      substream.rectifier.rectify(msg_ptr, rect_msg_ptr);
+      if (rect_msg_ptr)
+        substream.rect_pub.publish(rect_msg_ptr, Rectifier::rectifiedCameraInfo(info));
+    }
+    else
+      ROS_WARN_THROTTLE(10, "Camera %s is not calibrated, rectified image is not published", substream.name.c_str());
+  }
+
+  if (publish_display && !display_fused) {
+    sensor_msgs::ImagePtr display_msg_ptr = p_pool->getRecyclableImg();
+    substream.tone_mapper->map(msg_ptr, display_msg_ptr);
+    if (display_msg_ptr)
+      substream.display_pub.publish(display_msg_ptr, substream.camera_info);
+  }
+
+  if (publish_preview) {
+    sensor_msgs::ImagePtr preview_msg_ptr = p_pool->getRecyclableImg();
+    previewImg(msg_ptr, preview_msg_ptr, preview_downscale_);
+
+    if (preview_msg_ptr)
+      substream.preview_pub.publish(preview_msg_ptr, binnedCameraInfo(*substream.camera_info, preview_downscale_));
+  }
+
+  // each level is built from previous one, up to deepest subscribed level
+  sensor_msgs::ImagePtr level_msg_ptr = msg_ptr;
+  const size_t pyramid_levels = substream.pyramidLevels();
+  for (size_t i = 0; i < pyramid_levels && level_msg_ptr; ++i) {
+    sensor_msgs::ImagePtr half_msg_ptr = p_pool->getRecyclableImg();
+    pyrDownImg(level_msg_ptr, half_msg_ptr);
+    level_msg_ptr = half_msg_ptr;
+
+    if (level_msg_ptr && substream.pyramid_pubs[i].getNumSubscribers() > 0)
+      substream.pyramid_pubs[i].publish(level_msg_ptr, binnedCameraInfo(*substream.camera_info, 2u << i));
+  }
+
+  // software ROIs are views into converted image, rows are copied only when serialized
+  for (const SoftwareROI &software_roi : substream.software_rois) {
+    if (!software_roi.hasSubscribers())
+      continue;
+
+    SubImage::Ptr sub_msg_ptr = cropImage(msg_ptr, software_roi.x, software_roi.y,
+                                          software_roi.width, software_roi.height);
+    if (!sub_msg_ptr) {
+      ROS_WARN_STREAM_THROTTLE(10, "Software ROI " << software_roi.name << " is outside of "
+                               << msg_ptr->width << "x" << msg_ptr->height << " " << msg_ptr->encoding << " image");
+      continue;
+    }
+
+    // ROI in CameraInfo is relative to full resolution sensor image
+    sensor_msgs::CameraInfoPtr roi_info(new sensor_msgs::CameraInfo(*substream.camera_info));
+    roi_info->roi.x_offset = roi.x + sub_msg_ptr->x_offset;
+    roi_info->roi.y_offset = roi.y + sub_msg_ptr->y_offset;
+    roi_info->roi.width = sub_msg_ptr->width;
+    roi_info->roi.height = sub_msg_ptr->height;
+    // crop of unrectified image, not a region to be rectified
+    roi_info->roi.do_rectify = false;
+
+    software_roi.image_pub.publish(sub_msg_ptr);
+    software_roi.camera_info_pub.publish(roi_info);
+  }
+}
+
+void CameraAravisNodelet::correctPixels(Substream &substream, const CameraBufferPool::Ptr &p_pool,
+                                        sensor_msgs::ImagePtr &msg_ptr)
+{
+  // maps are captured from uncorrected images at the stage where they are applied
+  substream.pixel_correction->addCaptureFrame(*msg_ptr);
+
+  if (!pixel_correction_enabled_)
+    return;
+
+  sensor_msgs::ImagePtr corrected_msg_ptr = p_pool->getRecyclableImg();
+  if (substream.pixel_correction->apply(*msg_ptr, *corrected_msg_ptr, substream.correction_max_value,
+                                        substream.correct_bayer))
+    msg_ptr = corrected_msg_ptr;
+}
+
+void CameraAravisNodelet::recordFrame(const Substream &substream, const sensor_msgs::ImagePtr &msg_ptr, const ROI &roi)
+{
+  FrameRecord record;
+  record.stamp_ns = msg_ptr->header.stamp.toNSec();
+  record.frame_id = msg_ptr->header.seq;
+  record.x = roi.x;
+  record.y = roi.y;
+  record.width = msg_ptr->width;
+  record.height = msg_ptr->height;
+  record.step = msg_ptr->step;
+  record.substream = substream.record_index;
+
+  // dropped frames are counted by recorder
+  if (substream.recorded)
+    frame_recorder_->push(record, msg_ptr);
+
+  // ring is charged by the whole pool buffer the image pins
+  if (substream.frame_ring)
+    substream.frame_ring->push(record, msg_ptr, msg_ptr->data.size());
+}
+
 void CameraAravisNodelet::adaptROI(ArvBuffer *p_buffer, ROI &roi, size_t stream_id, size_t substream_id)
 {
   gint x, y, width, height;
@@ -2007,8 +3605,465 @@ void CameraAravisNodelet::publishExtendedCameraInfo(const Substream &substream,
   substream.extended_camera_info_pub.publish(extended_camera_info_msg);
 }
 
+void CameraAravisNodelet::initDiagnostics()
+{
+  if (diagnostic_rate_ <= 0.0)
+    return;
+
+  diagnostic_updater_.reset(new diagnostic_updater::Updater(getNodeHandle(), getPrivateNodeHandle(), getName()));
+  diagnostic_updater_->setHardwareID(p_device_ ? aravis::device::feature::get_string(p_device_, "DeviceSerialNumber") :
+                                                "replay");
+
+  for(int i = 0; i < streams_.size(); i++)
+    diagnostic_updater_->add("Stream " + std::to_string(i),
+                             boost::bind(&CameraAravisNodelet::produceStreamDiagnostics, this, _1, i));
+
+  if (compression_workers_)
+    diagnostic_updater_->add("Compression", boost::bind(&CameraAravisNodelet::produceCompressionDiagnostics, this, _1));
+
+  if (frame_recorder_)
+    diagnostic_updater_->add("Recorder", boost::bind(&CameraAravisNodelet::produceRecorderDiagnostics, this, _1));
+
+  if (control_channel_)
+    diagnostic_updater_->add("Control channel", boost::bind(&CameraAravisNodelet::produceControlDiagnostics, this, _1));
+
+  if (implemented_features_["TriggerSoftware"] || action_sender_)
+    diagnostic_updater_->add("Trigger", boost::bind(&CameraAravisNodelet::produceTriggerDiagnostics, this, _1));
+
+  if (action_sender_)
+    diagnostic_updater_->add("Action commands", boost::bind(&CameraAravisNodelet::produceActionDiagnostics, this, _1));
+
+  diagnostic_timer_ = getPrivateNodeHandle().createTimer(ros::Duration(1.0 / diagnostic_rate_),
+                                                        &CameraAravisNodelet::diagnosticTimerCallback, this);
+}
+
+void CameraAravisNodelet::diagnosticTimerCallback(const ros::TimerEvent &event)
+{
+  // Updater::update() is rate limited by its own ~diagnostic_period, we use our rate instead
+  diagnostic_updater_->force_update();
+}
+
+void CameraAravisNodelet::produceStreamDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat, size_t stream_id)
+{
+  Stream &stream = streams_[stream_id];
+
+  if ((!stream.p_stream && !replay_reader_ && !stream.gvsp_receiver) || !stream.p_buffer_pool)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "Stream not created");
+    return;
+  }
+
+  StreamStatisticsSample sample;
+  sample.stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  // sampling resets max burst length, taken once for both replay counts and loss statistics
+  const FrameLossSample loss = stream.frame_loss->sample();
+
+  guint64 n_completed_buffers = 0, n_failures = 0, n_underruns = 0;
+  // replayed frames count as completed buffers, incomplete multicast blocks as failures
+  GvspReceiverStatisticsSample gvsp_sample;
+  if (stream.p_stream)
+    arv_stream_get_statistics(stream.p_stream, &n_completed_buffers, &n_failures, &n_underruns);
+  else if (stream.gvsp_receiver)
+  {
+    gvsp_sample = stream.gvsp_receiver->sample();
+    n_completed_buffers = gvsp_sample.n_completed;
+    n_failures = gvsp_sample.n_incomplete;
+  }
+  else
+    n_completed_buffers = loss.n_received;
+  sample.n_completed_buffers = n_completed_buffers;
+  sample.n_failures = n_failures;
+  sample.n_underruns = n_underruns;
+
+  if (stream.p_stream && arv_camera_is_gv_device(p_camera_))
+  {
+    guint64 n_resent = 0, n_missing = 0;
+    arv_gv_stream_get_statistics(reinterpret_cast<ArvGvStream*>(stream.p_stream), &n_resent, &n_missing);
+    sample.n_resent = n_resent;
+    sample.n_missing = n_missing;
+  }
+
+  const StreamStatisticsSample &last = stream.last_statistics;
+  // first sample has nothing to compare against, report only totals
+  const double dt = last.stamp_ns ? (sample.stamp_ns - last.stamp_ns) * 1e-9 : 0.0;
+  auto rate = [dt](uint64_t now, uint64_t before) { return dt > 0.0 ? (now - before) / dt : 0.0; };
+
+  stat.add("Completed buffers", sample.n_completed_buffers);
+  stat.addf("Completed buffers rate", "%.2f Hz", rate(sample.n_completed_buffers, last.n_completed_buffers));
+  stat.add("Failures", sample.n_failures);
+  stat.addf("Failures rate", "%.2f Hz", rate(sample.n_failures, last.n_failures));
+  stat.add("Underruns", sample.n_underruns);
+  stat.addf("Underruns rate", "%.2f Hz", rate(sample.n_underruns, last.n_underruns));
+  if (stream.p_stream && arv_camera_is_gv_device(p_camera_))
+  {
+    stat.add("Resent packets", sample.n_resent);
+    stat.addf("Resent packets rate", "%.2f Hz", rate(sample.n_resent, last.n_resent));
+    stat.add("Missing packets", sample.n_missing);
+    stat.addf("Missing packets rate", "%.2f Hz", rate(sample.n_missing, last.n_missing));
+  }
+
+  gint n_input_buffers = 0, n_output_buffers = 0;
+  if (stream.p_stream)
+    arv_stream_get_n_buffers(stream.p_stream, &n_input_buffers, &n_output_buffers);
+  stat.add("Pool allocated buffers", stream.p_buffer_pool->getAllocatedSize());
+  stat.add("Pool buffers in use", stream.p_buffer_pool->getUsedSize());
+  stat.add("Aravis input queue", n_input_buffers);
+  stat.add("Aravis output queue", n_output_buffers);
+  if (stream.gvsp_receiver)
+    stat.add("Multicast ignored packets", gvsp_sample.n_ignored);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Streaming");
+
+  if (sample.n_completed_buffers == last.n_completed_buffers)
+  {
+    // acquisition runs while subscribed and triggers are fired, no frames then is a stall
+    const bool subscribed = std::any_of(stream.substreams.begin(), stream.substreams.end(),
+                                        [](const Substream &sub) { return sub.hasSubscribers(); });
+    const bool triggered = trigger_scheduler_ && subscribed_;
+    const bool replaying = !replay_reader_ || replay_active_;
+    if (last.stamp_ns && (subscribed || triggered) && replaying)
+      stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "No frames");
+    else
+      stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "No frames");
+  }
+
+  if (last.stamp_ns && (sample.n_failures != last.n_failures || sample.n_missing != last.n_missing))
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Frame failures");
+  if (last.stamp_ns && sample.n_underruns != last.n_underruns)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Buffer underruns");
+
+  const FrameLossSample &last_loss = stream.last_frame_loss;
+
+  stat.add("Received frames", loss.n_received);
+  stat.add("Delivered frames", loss.n_delivered);
+  for(int reason = 0; reason < LOSS_REASON_COUNT; ++reason)
+  {
+    const std::string name = std::string("Lost frames (") + frameLossReasonName(static_cast<FrameLossReason>(reason)) + ")";
+    stat.add(name, loss.n_lost[reason]);
+    stat.addf(name + " rate", "%.2f Hz", rate(loss.n_lost[reason], last_loss.n_lost[reason]));
+  }
+  stat.add("Loss bursts", loss.n_bursts);
+  stat.add("Loss burst max length", loss.max_burst);
+
+  if (last.stamp_ns && loss.n_lost[LOSS_GAP] != last_loss.n_lost[LOSS_GAP])
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Frame id gaps");
+
+  stream.last_frame_loss = loss;
+
+  for(int j = 0; j < stream.substreams.size(); ++j)
+  {
+    Substream &sub = stream.substreams[j];
+    const SubstreamStatisticsSample s = sub.statistics.sample();
+    const SubstreamStatisticsSample &prev = sub.last_statistics;
+    const std::string prefix = sub.name.empty() ? "" : sub.name + " ";
+    const uint64_t n_published = s.n_published - prev.n_published;
+    const double NS_IN_MS = 1000000.0;
+
+    stat.addf(prefix + "Frame rate", "%.2f Hz", rate(s.n_published, prev.n_published));
+    stat.add(prefix + "Queue drops", s.n_queue_drops);
+    stat.addf(prefix + "Conversion time", "%.3f ms",
+              n_published ? (s.conversion_ns - prev.conversion_ns) / n_published / NS_IN_MS : 0.0);
+    stat.addf(prefix + "Publish latency", "%.3f ms",
+              n_published ? (s.publish_latency_ns - prev.publish_latency_ns) / n_published / NS_IN_MS : 0.0);
+    stat.addf(prefix + "Publish latency max", "%.3f ms", s.publish_latency_max_ns / NS_IN_MS);
+    if (sub.frame_ring)
+    {
+      stat.add(prefix + "Pre-trigger frames", sub.frame_ring->size());
+      stat.addf(prefix + "Pre-trigger duration", "%.2f s", sub.frame_ring->durationNs() * 1e-9);
+      stat.addf(prefix + "Pre-trigger memory", "%.1f MB", sub.frame_ring->bytes() / (1024.0 * 1024.0));
+      stat.addf(prefix + "Pre-trigger flushing memory", "%.1f MB", sub.frame_ring->frozenBytes() / (1024.0 * 1024.0));
+    }
+
+    if (prev.n_published && s.n_queue_drops != prev.n_queue_drops)
+      stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, prefix + "Queue drops");
+
+    sub.last_statistics = s;
+  }
+
+  stream.last_statistics = sample;
+}
+
+void CameraAravisNodelet::produceCompressionDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const CompressionStatisticsSample s = compression_workers_->sample();
+  const CompressionStatisticsSample &prev = last_compression_statistics_;
+  const int64_t stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  const double dt = last_compression_stamp_ns_ ? (stamp_ns - last_compression_stamp_ns_) * 1e-9 : 0.0;
+  auto rate = [dt](uint64_t now, uint64_t before) { return dt > 0.0 ? (now - before) / dt : 0.0; };
+  const uint64_t n_compressed = s.n_compressed - prev.n_compressed;
+  const double BYTES_IN_MB = 1024.0 * 1024.0;
+  const double NS_IN_MS = 1000000.0;
+
+  std::string codecs = codec_params_.lossless_codec;
+  if (codec_params_.codec == "jpeg")
+    codecs = "jpeg, " + codecs;
+  if (codec_params_.depth_codec == "rvl")
+    codecs += ", rvl";
+  stat.add("Codec", codecs);
+  stat.add("Threads", compression_workers_->size());
+  stat.add("Compressed frames", s.n_compressed);
+  stat.addf("Compressed frames rate", "%.2f Hz", rate(s.n_compressed, prev.n_compressed));
+  stat.addf("Input throughput", "%.1f MB/s", rate(s.input_bytes, prev.input_bytes) / BYTES_IN_MB);
+  stat.addf("Output throughput", "%.1f MB/s", rate(s.output_bytes, prev.output_bytes) / BYTES_IN_MB);
+  stat.addf("Compression ratio", "%.2f", s.output_bytes != prev.output_bytes ?
+            double(s.input_bytes - prev.input_bytes) / (s.output_bytes - prev.output_bytes) : 0.0);
+  stat.addf("Compression time", "%.3f ms",
+            n_compressed ? (s.compression_ns - prev.compression_ns) / n_compressed / NS_IN_MS : 0.0);
+  stat.add("Dropped frames", s.n_dropped);
+  stat.add("Failed frames", s.n_failed);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Compressing");
+  if (last_compression_stamp_ns_ && s.n_dropped != prev.n_dropped)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Workers saturated, frames dropped");
+  if (last_compression_stamp_ns_ && s.n_failed != prev.n_failed)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Encoding not supported by codec");
+
+  last_compression_statistics_ = s;
+  last_compression_stamp_ns_ = stamp_ns;
+}
+
+void CameraAravisNodelet::produceRecorderDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const FrameRecorderStatisticsSample s = frame_recorder_->sample();
+  const FrameRecorderStatisticsSample &prev = last_recorder_statistics_;
+  const int64_t stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  const double dt = last_recorder_stamp_ns_ ? (stamp_ns - last_recorder_stamp_ns_) * 1e-9 : 0.0;
+  auto rate = [dt](uint64_t now, uint64_t before) { return dt > 0.0 ? (now - before) / dt : 0.0; };
+  const double BYTES_IN_MB = 1024.0 * 1024.0;
+
+  stat.add("Directory", frame_recorder_->directory());
+  stat.add("Written frames", s.n_written);
+  stat.addf("Written frames rate", "%.2f Hz", rate(s.n_written, prev.n_written));
+  stat.addf("Write throughput", "%.1f MB/s", rate(s.bytes_written, prev.bytes_written) / BYTES_IN_MB);
+  // fraction of time the writer thread spends in write calls, near 100 % the disk is the limit
+  stat.addf("Disk busy", "%.1f %%", dt > 0.0 ? 100.0 * (s.write_ns - prev.write_ns) * 1e-9 / dt : 0.0);
+  stat.addf("Queued", "%.1f MB", s.queued_bytes / BYTES_IN_MB);
+  stat.add("Dropped frames", s.n_dropped);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Recording");
+  if (last_recorder_stamp_ns_ && s.n_dropped != prev.n_dropped)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Disk too slow, frames dropped");
+
+  last_recorder_statistics_ = s;
+  last_recorder_stamp_ns_ = stamp_ns;
+}
+
+void CameraAravisNodelet::produceControlDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const ControlChannelStatisticsSample s = control_channel_->sample();
+  const double NS_IN_MS = 1e6;
+
+  for (int i = 0; i < CONTROL_PRIORITY_COUNT; i++)
+  {
+    const std::string name = controlPriorityName(ControlPriority(i));
+    stat.add(name + " transactions", s.n_transactions[i]);
+    stat.addf(name + " queue p50", "%.3f ms", s.queue_p50_ns[i] / NS_IN_MS);
+    stat.addf(name + " queue p99", "%.3f ms", s.queue_p99_ns[i] / NS_IN_MS);
+    stat.addf(name + " queue max", "%.3f ms", s.queue_max_ns[i] / NS_IN_MS);
+  }
+  stat.add("Reads", s.n_reads);
+  stat.add("Coalesced reads", s.n_coalesced);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Control channel");
+}
+
+void CameraAravisNodelet::produceTriggerDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  // scheduler is replaced by reconfigure callback
+  boost::recursive_mutex::scoped_lock lock(reconfigure_mutex_);
+  if (!trigger_scheduler_)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Not triggering");
+    return;
+  }
+
+  const TriggerSchedulerStatisticsSample s = trigger_scheduler_->sample();
+  const double NS_IN_US = 1000.0;
+
+  stat.addf("Rate", "%.3f Hz", config_.softwaretriggerrate);
+  stat.add("Fired triggers", s.n_fired);
+  stat.add("Skipped triggers", s.n_skipped);
+  stat.addf("Lateness p50", "%.1f us", s.lateness_p50_ns / NS_IN_US);
+  stat.addf("Lateness p99", "%.1f us", s.lateness_p99_ns / NS_IN_US);
+  stat.addf("Lateness max", "%.1f us", s.lateness_max_ns / NS_IN_US);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Triggering");
+  if (s.n_skipped > last_trigger_skipped_)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Trigger thread overran, triggers skipped");
+
+  last_trigger_skipped_ = s.n_skipped;
+}
+
+void CameraAravisNodelet::produceActionDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const ActionCommandStatisticsSample s = action_sender_->sample();
+  const ActionCommandStatisticsSample &prev = last_action_statistics_;
+  const int64_t stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  const double dt = last_action_stamp_ns_ ? (stamp_ns - last_action_stamp_ns_) * 1e-9 : 0.0;
+
+  stat.add("Sent commands", s.n_sent);
+  stat.addf("Sent commands rate", "%.2f Hz", dt > 0.0 ? (s.n_sent - prev.n_sent) / dt : 0.0);
+  stat.add("Failed commands", s.n_failed);
+  stat.add("Device key", action_command_.device_key);
+  stat.add("Group key", action_command_.group_key);
+  stat.add("Group mask", action_command_.group_mask);
+  stat.addf("Schedule lead", "%.3f ms", action_schedule_lead_ms_);
+
+  stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Action trigger");
+  if (last_action_stamp_ns_ && s.n_failed != prev.n_failed)
+    stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Sending action commands failed");
+
+  last_action_statistics_ = s;
+  last_action_stamp_ns_ = stamp_ns;
+}
+
+void CameraAravisNodelet::initTracing()
+{
+  if (!trace_file_.empty())
+  {
+    trace_file_stream_.open(trace_file_, std::ios::out | std::ios::trunc);
+    if (trace_file_stream_)
+      FrameTrace::writeCsvHeader(trace_file_stream_);
+    else
+      ROS_ERROR("Could not open trace file %s", trace_file_.c_str());
+  }
+
+  if (trace_rate_ <= 0.0)
+  {
+    ROS_WARN("Latency tracing disabled by trace_rate %f", trace_rate_);
+    return;
+  }
+
+  trace_timer_ = getPrivateNodeHandle().createTimer(ros::Duration(1.0 / trace_rate_),
+                                                    &CameraAravisNodelet::traceTimerCallback, this);
+}
+
+void CameraAravisNodelet::initSoftwareROIs(Substream &substream, const std::string &topic_name,
+                                           const ros::SubscriberStatusCallback &status_cb)
+{
+  ros::NodeHandle &pnh = getPrivateNodeHandle();
+  XmlRpc::XmlRpcValue roi_params;
+
+  if (!pnh.getParam("software_rois", roi_params))
+    return;
+
+  if (roi_params.getType() != XmlRpc::XmlRpcValue::TypeArray)
+  {
+    ROS_WARN_ONCE("software_rois should be a list of {name, x, y, width, height, [substream]}, ignoring");
+    return;
+  }
+
+  for (int i = 0; i < roi_params.size(); ++i)
+  {
+    XmlRpc::XmlRpcValue &roi_param = roi_params[i];
+
+    auto isInt = [&roi_param](const std::string &key) {
+      return roi_param.hasMember(key) && roi_param[key].getType() == XmlRpc::XmlRpcValue::TypeInt;
+    };
+    auto isString = [&roi_param](const std::string &key) {
+      return roi_param.hasMember(key) && roi_param[key].getType() == XmlRpc::XmlRpcValue::TypeString;
+    };
+
+    if (roi_param.getType() != XmlRpc::XmlRpcValue::TypeStruct || !isString("name") ||
+        !isInt("x") || !isInt("y") || !isInt("width") || !isInt("height"))
+    {
+      ROS_WARN("Ignoring software_rois entry %d, expected {name, x, y, width, height, [substream]}", i);
+      continue;
+    }
+
+    // entries without substream apply to unnamed (single) substream
+    const std::string substream_name = isString("substream") ? (std::string &)roi_param["substream"] : "";
+    if (substream_name != substream.name)
+      continue;
+
+    SoftwareROI software_roi;
+    software_roi.name = (std::string &)roi_param["name"];
+    software_roi.x = (int &)roi_param["x"];
+    software_roi.y = (int &)roi_param["y"];
+    software_roi.width = (int &)roi_param["width"];
+    software_roi.height = (int &)roi_param["height"];
+
+    if (software_roi.x < 0 || software_roi.y < 0 || software_roi.width <= 0 || software_roi.height <= 0)
+    {
+      ROS_WARN("Ignoring software ROI %s with negative offset or empty size", software_roi.name.c_str());
+      continue;
+    }
+
+    const std::string roi_topic = topic_name + "/roi/" + software_roi.name;
+    software_roi.image_pub = pnh.advertise<sensor_msgs::Image>(
+      ros::names::remap(roi_topic + "/image_raw"), 1, status_cb, status_cb);
+    software_roi.camera_info_pub = pnh.advertise<sensor_msgs::CameraInfo>(
+      ros::names::remap(roi_topic + "/camera_info"), 1, status_cb, status_cb);
+
+    ROS_INFO("Software ROI %s: %dx%d at (%d, %d)", software_roi.name.c_str(),
+             software_roi.width, software_roi.height, software_roi.x, software_roi.y);
+    substream.software_rois.push_back(software_roi);
+  }
+}
+
+void CameraAravisNodelet::traceTimerCallback(const ros::TimerEvent &event)
+{
+  const double NS_IN_MS = 1000000.0;
+
+  for(int i = 0; i < streams_.size(); i++)
+  {
+    for(int j = 0; j < streams_[i].substreams.size(); ++j)
+    {
+      Substream &sub = streams_[i].substreams[j];
+
+      // drain even when disabled, so stale traces are not reported after enabling
+      FrameTrace trace;
+      while (sub.trace_ring.pop(trace))
+      {
+        sub.trace_statistics.add(trace);
+        if (trace_file_stream_.is_open())
+          trace.writeCsv(trace_file_stream_, sub.frame_id);
+      }
+
+      if (!trace_latency_)
+      {
+        sub.trace_statistics.reset();
+        continue;
+      }
+
+      FrameLatency msg;
+      msg.header.stamp = ros::Time::now();
+      msg.header.frame_id = sub.frame_id;
+      msg.dropped_traces = sub.trace_ring.dropped();
+
+      for(int stage = 0; stage < TRACE_STAGE_COUNT; ++stage)
+      {
+        const LatencyHistogram &histogram = sub.trace_statistics.stages[stage];
+        StageLatency stage_msg;
+        stage_msg.stage = frameTraceStageName(static_cast<FrameTraceStage>(stage));
+        stage_msg.count = histogram.count();
+        stage_msg.p50 = histogram.percentile(0.5) / NS_IN_MS;
+        stage_msg.p99 = histogram.percentile(0.99) / NS_IN_MS;
+        stage_msg.max = histogram.max() / NS_IN_MS;
+        msg.stages.push_back(stage_msg);
+      }
+
+      sub.latency_pub.publish(msg);
+      sub.trace_statistics.reset();
+    }
+  }
+
+  if (trace_file_stream_.is_open())
+    trace_file_stream_.flush();
+}
+
 void CameraAravisNodelet::fillExtendedCameraInfoMessage(ExtendedCameraInfo &msg)
 {
+  ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TELEMETRY);
+
   const char *vendor_name = aravis::camera::get_vendor_name(p_camera_);
 
   if (strcmp("Basler", vendor_name) == 0) {
@@ -2096,42 +4151,34 @@ void CameraAravisNodelet::controlLostCallback(ArvDevice *p_gv_device, gpointer c
   }
 }
 
-void CameraAravisNodelet::softwareTriggerLoop()
+void CameraAravisNodelet::startTrigger(bool action)
 {
-  software_trigger_active_ = true;
-  ROS_INFO("Software trigger started.");
-  std::chrono::system_clock::time_point next_time = std::chrono::system_clock::now();
-  while (ros::ok() && software_trigger_active_)
-  {
-    next_time += std::chrono::milliseconds(size_t(std::round(1000.0 / config_.softwaretriggerrate)));
+  // recording and pre-trigger ring count as subscribers without subscription events
+  subscribed_ = anySubscribers();
+  trigger_scheduler_.reset(new TriggerScheduler(config_.softwaretriggerrate, uint64_t(trigger_spin_us_) * 1000,
+                                                trigger_priority_,
+                                                std::bind(&CameraAravisNodelet::fireTrigger, this, action)));
+  trigger_scheduler_->start();
+  ROS_INFO(action ? "Action trigger started." : "Software trigger started.");
+}
 
-    // any substream of any stream enabled?
-    if (std::any_of(streams_.begin(), streams_.end(),
-                    [](const Stream &src)
-                    {
-                      return std::any_of(src.substreams.begin(), src.substreams.end(),
-                                         [](const Substream &sub)
-                                         {
-                                           return sub.cam_pub.getNumSubscribers() > 0;
-                                         }
-                                        );
-                    }
-                   )
-    )
-    {
-      aravis::device::execute_command(p_device_, "TriggerSoftware");
-    }
-    if (next_time > std::chrono::system_clock::now())
-    {
-      std::this_thread::sleep_until(next_time);
-    }
-    else
-    {
-      ROS_WARN("Camera Aravis: Missed a software trigger event.");
-      next_time = std::chrono::system_clock::now();
-    }
+void CameraAravisNodelet::fireTrigger(bool action)
+{
+  if (action)
+  {
+    // other cameras of the group may have subscribers, so always fire
+    ActionCommand command = action_command_;
+    if (command.scheduled)
+      command.action_time = actionCommandPtpNow() + uint64_t(action_schedule_lead_ms_ * 1e6);
+    if (!action_sender_->send(command))
+      ROS_WARN_THROTTLE(1.0, "Camera Aravis: Failed to send action command.");
+  }
+  // any substream of any stream enabled?
+  else if (subscribed_)
+  {
+    ControlTransaction transaction(control_channel_.get(), CONTROL_PRIORITY_TRIGGER);
+    aravis::device::execute_command(p_device_, "TriggerSoftware");
   }
-  ROS_INFO("Software trigger stopped.");
 }
 
 void CameraAravisNodelet::discoverFeatures()
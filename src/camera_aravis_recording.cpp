@@ -0,0 +1,169 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// Inspection and export of recordings written by the driver frame recorder (`record_directory`).
+//
+// Usage: cam_aravis_recording <mode> <recording directory> [--option=value ...]
+//
+// Modes:
+//   info    substreams, frame count, duration, frame rate and data rate per substream
+//   export  converted ROS images as lossless PNG files <substream>_<frame id>.png
+//
+// Options:
+//   --output=DIR   export directory, default is recording directory
+//   --first=N      first exported frame, default 0
+//   --count=N      number of exported frames, default all
+
+#include <camera_aravis/image_codecs.h>
+#include <camera_aravis/recording_reader.h>
+
+#include <algorithm> //std::min
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace camera_aravis;
+
+std::string substreamLabel(const RecordingReader &reader, uint32_t index)
+{
+  const std::string &name = reader.substreams()[index].name;
+  return name.empty() ? std::to_string(index) : name;
+}
+
+int info(const RecordingReader &reader)
+{
+  const size_t n_substreams = reader.substreams().size();
+  std::vector<size_t> frames(n_substreams, 0);
+  std::vector<uint64_t> bytes(n_substreams, 0), first(n_substreams, 0), last(n_substreams, 0);
+
+  for (size_t i = 0; i < reader.size(); ++i)
+  {
+    const FrameRecord &record = reader.record(i);
+    if (frames[record.substream] == 0)
+      first[record.substream] = record.stamp_ns;
+    last[record.substream] = record.stamp_ns;
+    ++frames[record.substream];
+    bytes[record.substream] += record.size;
+  }
+
+  printf("%zu frames\n", reader.size());
+  for (size_t s = 0; s < n_substreams; ++s)
+  {
+    const RecordedSubstream &substream = reader.substreams()[s];
+    const double duration = (last[s] - first[s]) * 1e-9;
+    const double rate = duration > 0 ? (frames[s] - 1) / duration : 0.0;
+    printf("substream %s: frame_id %s, %s (%u bits), %zu frames, %.3f s, %.2f Hz, %.1f MB/s\n",
+           substreamLabel(reader, s).c_str(), substream.frame_id.c_str(), substream.pixel_format.c_str(),
+           substream.bits_per_pixel, frames[s], duration, rate,
+           duration > 0 ? bytes[s] / duration * 1e-6 : 0.0);
+  }
+  return EXIT_SUCCESS;
+}
+
+int exportImages(const RecordingReader &reader, const std::string &output, size_t first, size_t count)
+{
+  CodecParameters params;
+  params.codec = "none";
+  params.depth_codec = "none";
+  params.lossless_codec = "png";
+
+  const size_t end = first + std::min(count, reader.size() - std::min(first, reader.size()));
+  size_t n_exported = 0;
+  for (size_t i = first; i < end; ++i)
+  {
+    const FrameRecord &record = reader.record(i);
+    sensor_msgs::ImagePtr image = reader.image(i);
+    sensor_msgs::CompressedImage compressed;
+    if (!image || !encodeImage(*image, params, compressed))
+    {
+      fprintf(stderr, "frame %zu: %s can't be exported\n", i,
+              reader.substreams()[record.substream].pixel_format.c_str());
+      continue;
+    }
+
+    const std::string path = output + "/" + substreamLabel(reader, record.substream) + "_" +
+                             std::to_string(record.frame_id) + ".png";
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(compressed.data.data()), compressed.data.size());
+    if (!file)
+    {
+      fprintf(stderr, "can't write %s\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    ++n_exported;
+  }
+
+  printf("exported %zu frames to %s\n", n_exported, output.c_str());
+  return EXIT_SUCCESS;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 3 || (std::string(argv[1]) != "info" && std::string(argv[1]) != "export"))
+  {
+    fprintf(stderr, "Usage: %s <info|export> <recording directory> [--output=DIR] [--first=N] [--count=N]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const std::string mode = argv[1];
+  const std::string directory = argv[2];
+  std::string output = directory;
+  size_t first = 0, count = size_t(-1);
+
+  for (int i = 3; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (key == "--output")
+      output = value;
+    else if (key == "--first")
+      first = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--count")
+      count = std::strtoul(value.c_str(), nullptr, 10);
+    else
+    {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  camera_aravis::RecordingReader reader;
+  if (!reader.open(directory))
+  {
+    fprintf(stderr, "Can't open recording %s\n", directory.c_str());
+    return EXIT_FAILURE;
+  }
+
+  if (mode == "info")
+    return info(reader);
+  return exportImages(reader, output, first, count);
+}
@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/compression_workers.h>
+
+#include <algorithm> //std::max
+#include <chrono>
+
+namespace camera_aravis
+{
+
+CompressionWorkers::CompressionWorkers(const CodecParameters &params, size_t n_threads, size_t queue_size) :
+    params_(params), queue_size_(std::max<size_t>(queue_size, 1))
+{
+  for (size_t i = 0; i < std::max<size_t>(n_threads, 1); ++i)
+    workers_.emplace_back(&CompressionWorkers::workerMain, this);
+}
+
+CompressionWorkers::~CompressionWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_ready_.notify_all();
+
+  for (std::thread &worker : workers_)
+    worker.join();
+}
+
+bool CompressionWorkers::push(const sensor_msgs::ImageConstPtr &image, const ros::Publisher &publisher)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.size() >= queue_size_)
+    {
+      n_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    PublishOrder &order = orders_[publisher.getTopic()];
+    jobs_.push_back(Job{image, publisher, &order, order.n_pushed++});
+  }
+
+  job_ready_.notify_one();
+  return true;
+}
+
+CompressionStatisticsSample CompressionWorkers::sample() const
+{
+  CompressionStatisticsSample s;
+  s.n_compressed = n_compressed_.load(std::memory_order_relaxed);
+  s.n_dropped = n_dropped_.load(std::memory_order_relaxed);
+  s.n_failed = n_failed_.load(std::memory_order_relaxed);
+  s.input_bytes = input_bytes_.load(std::memory_order_relaxed);
+  s.output_bytes = output_bytes_.load(std::memory_order_relaxed);
+  s.compression_ns = compression_ns_.load(std::memory_order_relaxed);
+  return s;
+}
+
+void CompressionWorkers::workerMain()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      // queued frames are compressed and published before stopping
+      if (jobs_.empty())
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    sensor_msgs::CompressedImagePtr compressed(new sensor_msgs::CompressedImage);
+    const bool ok = encodeImage(*job.image, params_, *compressed);
+    const auto end = std::chrono::steady_clock::now();
+
+    const size_t input_bytes = job.image->data.size();
+    // release pooled image before publishing
+    job.image.reset();
+
+    if (!ok)
+    {
+      n_failed_.fetch_add(1, std::memory_order_relaxed);
+      release(job, nullptr);
+      continue;
+    }
+
+    release(job, compressed);
+
+    n_compressed_.fetch_add(1, std::memory_order_relaxed);
+    input_bytes_.fetch_add(input_bytes, std::memory_order_relaxed);
+    output_bytes_.fetch_add(compressed->data.size(), std::memory_order_relaxed);
+    compression_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+                              std::memory_order_relaxed);
+  }
+}
+
+void CompressionWorkers::release(const Job &job, const sensor_msgs::CompressedImagePtr &compressed)
+{
+  PublishOrder &order = *job.order;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    order.done.emplace(job.seq, compressed);
+    if (order.publishing)
+      return;
+    order.publishing = true;
+  }
+
+  // frames finished by other workers meanwhile are published here too
+  std::vector<sensor_msgs::CompressedImagePtr> released;
+  while (true)
+  {
+    released.clear();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = order.done.begin(); it != order.done.end() && it->first == order.n_released; ++order.n_released)
+      {
+        released.push_back(it->second);
+        it = order.done.erase(it);
+      }
+      if (released.empty())
+      {
+        order.publishing = false;
+        return;
+      }
+    }
+
+    for (const sensor_msgs::CompressedImagePtr &image : released)
+      if (image)
+        job.publisher.publish(image);
+  }
+}
+
+} // end namespace camera_aravis
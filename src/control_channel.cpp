@@ -0,0 +1,215 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/control_channel.h>
+
+#include <algorithm> //std::find
+#include <chrono>
+#include <unordered_map>
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+std::mutex registry_mutex;
+std::unordered_map<const void*, ControlChannel*> registry;
+
+thread_local ControlPriority current_priority = CONTROL_PRIORITY_RECONFIGURE;
+
+uint64_t steadyNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool isSelector(const std::string &feature)
+{
+  static const std::string SUFFIX = "Selector";
+  return feature.size() > SUFFIX.size() &&
+         feature.compare(feature.size() - SUFFIX.size(), SUFFIX.size(), SUFFIX) == 0;
+}
+
+} // end anonymous namespace
+
+const char* controlPriorityName(ControlPriority priority)
+{
+  switch (priority)
+  {
+    case CONTROL_PRIORITY_TRIGGER:
+      return "trigger";
+    case CONTROL_PRIORITY_RECONFIGURE:
+      return "reconfigure";
+    case CONTROL_PRIORITY_TELEMETRY:
+      return "telemetry";
+    default:
+      return "unknown";
+  }
+}
+
+ControlChannel::ControlChannel(uint64_t coalesce_window_ns) :
+    coalesce_window_ns_(coalesce_window_ns)
+{
+}
+
+ControlChannel::~ControlChannel()
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const void *handle : handles_)
+    registry.erase(handle);
+}
+
+void ControlChannel::attach(const void *handle)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry[handle] = this;
+  if (std::find(handles_.begin(), handles_.end(), handle) == handles_.end())
+    handles_.push_back(handle);
+}
+
+ControlChannel *ControlChannel::find(const void *handle)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  const auto it = registry.find(handle);
+  return it != registry.end() ? it->second : nullptr;
+}
+
+void ControlChannel::acquire(ControlPriority priority)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (depth_ > 0 && owner_ == std::this_thread::get_id())
+  {
+    ++depth_;
+    return;
+  }
+
+  const uint64_t enqueue_ns = steadyNow();
+  const std::pair<int, uint64_t> ticket(priority, next_ticket_++);
+  waiting_.insert(ticket);
+  granted_.wait(lock, [this, &ticket] { return depth_ == 0 && *waiting_.begin() == ticket; });
+  waiting_.erase(ticket);
+
+  owner_ = std::this_thread::get_id();
+  depth_ = 1;
+
+  n_transactions_[priority]++;
+  queue_delay_[priority].add(steadyNow() - enqueue_ns);
+}
+
+void ControlChannel::release()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--depth_ > 0)
+      return;
+    owner_ = std::thread::id();
+  }
+  granted_.notify_all();
+}
+
+std::string ControlChannel::cacheKey(const std::string &feature) const
+{
+  // the same feature reads differently under other selector values, e.g. Gain of GainSelector Red
+  std::string key = feature;
+  for (const auto &selector : selectors_)
+    key += "|" + selector.first + "=" + selector.second;
+  return key;
+}
+
+bool ControlChannel::cachedRead(const std::string &feature, Value &value)
+{
+  n_reads_++;
+
+  // reconfigure and trigger act on the read value, they always ask the device
+  if (coalesce_window_ns_ == 0 || ControlTransaction::currentPriority() != CONTROL_PRIORITY_TELEMETRY)
+    return false;
+
+  const auto it = reads_.find(cacheKey(feature));
+  if (it == reads_.end() || steadyNow() - it->second.first > coalesce_window_ns_)
+    return false;
+
+  value = it->second.second;
+  n_coalesced_++;
+  return true;
+}
+
+void ControlChannel::storeRead(const std::string &feature, const Value &value)
+{
+  if (coalesce_window_ns_ > 0)
+    reads_[cacheKey(feature)] = std::make_pair(steadyNow(), value);
+}
+
+void ControlChannel::wrote(const std::string &feature, const std::string &value)
+{
+  if (isSelector(feature))
+    selectors_[feature] = value;
+  else
+    reads_.clear();
+}
+
+ControlChannelStatisticsSample ControlChannel::sample()
+{
+  ControlChannelStatisticsSample sample;
+  sample.n_reads = n_reads_;
+  sample.n_coalesced = n_coalesced_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int i = 0; i < CONTROL_PRIORITY_COUNT; i++)
+  {
+    sample.n_transactions[i] = n_transactions_[i];
+    sample.queue_p50_ns[i] = queue_delay_[i].percentile(0.5);
+    sample.queue_p99_ns[i] = queue_delay_[i].percentile(0.99);
+    sample.queue_max_ns[i] = queue_delay_[i].max();
+    queue_delay_[i].reset();
+  }
+  return sample;
+}
+
+ControlTransaction::ControlTransaction(ControlChannel *channel) :
+    ControlTransaction(channel, current_priority)
+{
+}
+
+ControlTransaction::ControlTransaction(ControlChannel *channel, ControlPriority priority) :
+    channel_(channel), previous_priority_(current_priority)
+{
+  current_priority = priority;
+  if (channel_)
+    channel_->acquire(priority);
+}
+
+ControlTransaction::~ControlTransaction()
+{
+  if (channel_)
+    channel_->release();
+  current_priority = previous_priority_;
+}
+
+ControlPriority ControlTransaction::currentPriority()
+{
+  return current_priority;
+}
+
+} // end namespace camera_aravis
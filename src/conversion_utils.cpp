@@ -26,8 +26,9 @@
 #include <ros/ros.h>
 
 #include <opencv2/core/core.hpp> //photoneoMotionCamYCoCg
+#include <opencv2/imgproc/imgproc.hpp> //demosaicImg, previewImg
 
-#include <algorithm> //std::find
+#include <algorithm> //std::find, std::max
 
 namespace camera_aravis
 {
@@ -628,4 +629,249 @@ void photoneoYCoCgR420(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, co
   out->encoding = out_format;
 }
 
+// OpenCV names Bayer patterns by second row, e.g. ROS RGGB is OpenCV BG
+struct DemosaicCodes
+{
+  int bgr;
+  int rgb;
+  int bgr_edge_aware;
+  int rgb_edge_aware;
+};
+
+static const std::map<std::string, DemosaicCodes> DEMOSAIC_CODES =
+{
+  { "RGGB", { cv::COLOR_BayerBG2BGR, cv::COLOR_BayerBG2RGB, cv::COLOR_BayerBG2BGR_EA, cv::COLOR_BayerBG2RGB_EA } },
+  { "BGGR", { cv::COLOR_BayerRG2BGR, cv::COLOR_BayerRG2RGB, cv::COLOR_BayerRG2BGR_EA, cv::COLOR_BayerRG2RGB_EA } },
+  { "GBRG", { cv::COLOR_BayerGR2BGR, cv::COLOR_BayerGR2RGB, cv::COLOR_BayerGR2BGR_EA, cv::COLOR_BayerGR2RGB_EA } },
+  { "GRBG", { cv::COLOR_BayerGB2BGR, cv::COLOR_BayerGB2RGB, cv::COLOR_BayerGB2BGR_EA, cv::COLOR_BayerGB2RGB_EA } },
+};
+
+void demosaicImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const bool edge_aware, const std::string out_format)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (!in) {
+    ROS_WARN("camera_aravis::demosaicImg(): no input image given.");
+    return;
+  }
+
+  // e.g. bayer_rggb8 -> RGGB
+  std::string pattern = enc::isBayer(in->encoding) ? in->encoding.substr(6, 4) : "";
+  std::transform(pattern.begin(), pattern.end(), pattern.begin(), ::toupper);
+  const auto codes_iter = DEMOSAIC_CODES.find(pattern);
+
+  if (codes_iter == DEMOSAIC_CODES.end()) {
+    ROS_WARN_STREAM_ONCE("camera_aravis::demosaicImg(): expects 8 or 16 bit Bayer input, got " << in->encoding);
+    out = in;
+    return;
+  }
+
+  const bool rgb = out_format == enc::RGB8 || out_format == enc::RGB16;
+  const DemosaicCodes &codes = codes_iter->second;
+  const int code = edge_aware ? (rgb ? codes.rgb_edge_aware : codes.bgr_edge_aware) : (rgb ? codes.rgb : codes.bgr);
+
+  const int in_depth = enc::bitDepth(in->encoding) == 16 ? CV_16U : CV_8U;
+  const int out_depth = enc::bitDepth(out_format) == 16 ? CV_16U : CV_8U;
+  const size_t out_pixel_size = out_depth == CV_16U ? 3 * sizeof(uint16_t) : 3 * sizeof(uint8_t);
+
+  if (!out)
+  {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::demosaicImg(): no output image given. Reserved a new one.");
+  }
+
+  out->header = in->header;
+  out->height = in->height;
+  out->width = in->width;
+  out->is_bigendian = in->is_bigendian;
+  out->step = out->width * out_pixel_size;
+  out->data.resize(out->height * out->step);
+
+  //wrap around input and output ROS Image data from buffer pool
+  //OpenCV demosaicing is SIMD vectorized and row-parallel
+  const cv::Mat bayer(in->height, in->width, in_depth, in->data.data(), in->step);
+  cv::Mat color(out->height, out->width, CV_MAKETYPE(out_depth, 3), out->data.data(), out->step);
+
+  if (in_depth == out_depth)
+    cv::cvtColor(bayer, color, code);
+  else
+  {
+    // change depth on single channel Bayer data, 3x less work than on color
+    thread_local cv::Mat bayer_scaled;
+    bayer.convertTo(bayer_scaled, out_depth, out_depth == CV_8U ? 1.0 / 256.0 : 257.0);
+    cv::cvtColor(bayer_scaled, color, code);
+  }
+
+  out->encoding = out_format;
+}
+
+int filterableCvType(const std::string &encoding)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (enc::isBayer(encoding) || encoding == enc::YUV422)
+    return -1;
+
+  const int channels = enc::numChannels(encoding);
+  // e.g. 32FC1, 16SC1
+  const bool is_float = encoding.find("FC") != std::string::npos;
+  const bool is_signed = encoding.find("SC") != std::string::npos;
+
+  switch (enc::bitDepth(encoding))
+  {
+    case 8:
+      return CV_MAKETYPE(is_signed ? CV_8S : CV_8U, channels);
+    case 16:
+      return CV_MAKETYPE(is_signed ? CV_16S : CV_16U, channels);
+    case 32:
+      return is_float ? CV_MAKETYPE(CV_32F, channels) : -1;
+    case 64:
+      return is_float ? CV_MAKETYPE(CV_64F, channels) : -1;
+    default:
+      return -1;
+  }
+}
+
+void pyrDownImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out)
+{
+  if (!in) {
+    ROS_WARN("camera_aravis::pyrDownImg(): no input image given.");
+    return;
+  }
+
+  const int type = filterableCvType(in->encoding);
+
+  if (type < 0)
+  {
+    ROS_WARN_STREAM_ONCE("camera_aravis::pyrDownImg(): can't downscale encoding " << in->encoding);
+    out.reset();
+    return;
+  }
+
+  if (!out)
+  {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::pyrDownImg(): no output image given. Reserved a new one.");
+  }
+
+  const size_t pixel_size = sensor_msgs::image_encodings::bitDepth(in->encoding) / 8 *
+                            sensor_msgs::image_encodings::numChannels(in->encoding);
+
+  out->header = in->header;
+  out->height = std::max<uint32_t>(in->height / 2, 1);
+  out->width = std::max<uint32_t>(in->width / 2, 1);
+  out->is_bigendian = in->is_bigendian;
+  out->step = out->width * pixel_size;
+  out->data.resize(out->height * out->step);
+
+  //area interpolation at exact 1/2 scale is SIMD vectorized, row-parallel 2x2 box filter
+  const cv::Mat full(in->height, in->width, type, in->data.data(), in->step);
+  cv::Mat half(out->height, out->width, type, out->data.data(), out->step);
+  cv::resize(full, half, half.size(), 0, 0, cv::INTER_AREA);
+
+  out->encoding = in->encoding;
+}
+
+void previewImg(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const size_t downscale)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (!in) {
+    ROS_WARN("camera_aravis::previewImg(): no input image given.");
+    return;
+  }
+
+  sensor_msgs::ImagePtr src = in;
+  if (enc::isBayer(in->encoding))
+  {
+    // cheap bilinear demosaicing, preview needs color but not quality
+    thread_local sensor_msgs::ImagePtr color(new sensor_msgs::Image);
+    demosaicImg(in, color, false, enc::BGR8);
+    src = color;
+  }
+
+  const int bit_depth = enc::bitDepth(src->encoding);
+  const int channels = enc::numChannels(src->encoding);
+  const bool has_preview = (bit_depth == 8 || bit_depth == 16) && (channels == 1 || channels == 3 || channels == 4) &&
+                           (enc::isColor(src->encoding) || enc::isMono(src->encoding) ||
+                            src->encoding == enc::TYPE_8UC1 || src->encoding == enc::TYPE_16UC1);
+
+  if (!has_preview)
+  {
+    ROS_WARN_STREAM_ONCE("camera_aravis::previewImg(): no preview for encoding " << in->encoding);
+    out.reset();
+    return;
+  }
+
+  if (!out)
+  {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::previewImg(): no output image given. Reserved a new one.");
+  }
+
+  std::string out_format = enc::MONO8;
+  if (enc::isColor(src->encoding))
+  {
+    const bool rgb = src->encoding == enc::RGB8 || src->encoding == enc::RGB16 ||
+                     src->encoding == enc::RGBA8 || src->encoding == enc::RGBA16;
+    if (channels == 4)
+      out_format = rgb ? enc::RGBA8 : enc::BGRA8;
+    else
+      out_format = rgb ? enc::RGB8 : enc::BGR8;
+  }
+
+  const size_t factor = std::max<size_t>(downscale, 1);
+
+  out->header = in->header;
+  out->height = std::max<size_t>(src->height / factor, 1);
+  out->width = std::max<size_t>(src->width / factor, 1);
+  out->is_bigendian = false;
+  out->step = out->width * channels;
+  out->data.resize(out->height * out->step);
+
+  const int depth = bit_depth == 16 ? CV_16U : CV_8U;
+  const cv::Mat full(src->height, src->width, CV_MAKETYPE(depth, channels), src->data.data(), src->step);
+  cv::Mat preview(out->height, out->width, CV_MAKETYPE(CV_8U, channels), out->data.data(), out->step);
+
+  if (depth == CV_8U)
+    cv::resize(full, preview, preview.size(), 0, 0, cv::INTER_AREA);
+  else
+  {
+    // downscale first, then change depth on fewer pixels
+    thread_local cv::Mat scaled;
+    cv::resize(full, scaled, preview.size(), 0, 0, cv::INTER_AREA);
+    scaled.convertTo(preview, CV_8U, 1.0 / 256.0);
+  }
+
+  out->encoding = out_format;
+}
+
+ConversionFunction getConversion(const std::string &pixel_format, bool *rename_only, bool *in_place)
+{
+  const auto rename_iter = RENAME_DICTIONARY.find(pixel_format);
+  const auto shift_iter = SHIFT_DICTIONARY.find(pixel_format);
+  const bool is_rename = rename_iter != RENAME_DICTIONARY.end();
+  const bool is_shift = shift_iter != SHIFT_DICTIONARY.end();
+
+  if (rename_only)
+    *rename_only = is_rename;
+
+  if (in_place)
+    *in_place = is_rename || is_shift;
+
+  if (is_rename)
+    return std::bind(&renameImg, std::placeholders::_1, std::placeholders::_2, rename_iter->second);
+
+  if (is_shift)
+    return std::bind(&shiftImg, std::placeholders::_1, std::placeholders::_2,
+                     shift_iter->second.first, shift_iter->second.second);
+
+  const auto conversion_iter = CONVERSIONS_DICTIONARY.find(pixel_format);
+
+  if (conversion_iter != CONVERSIONS_DICTIONARY.end())
+    return conversion_iter->second;
+
+  return ConversionFunction();
+}
+
 } // end namespace camera_aravis
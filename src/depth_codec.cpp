@@ -0,0 +1,179 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/depth_codec.h>
+
+#include <cstring> //std::memcpy
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+class NibbleWriter
+{
+public:
+  explicit NibbleWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+  inline void writeVLE(uint32_t value)
+  {
+    do
+    {
+      uint32_t nibble = value & 0x7;
+      value >>= 3;
+      if (value)
+        nibble |= 0x8;
+      word_ = (word_ << 4) | nibble;
+      if (++nibbles_ == 8)
+        flushWord();
+    } while (value);
+  }
+
+  void finish()
+  {
+    if (!nibbles_)
+      return;
+    word_ <<= 4 * (8 - nibbles_);
+    flushWord();
+  }
+
+private:
+  inline void flushWord()
+  {
+    const size_t size = out_.size();
+    out_.resize(size + sizeof(word_));
+    std::memcpy(out_.data() + size, &word_, sizeof(word_));
+    word_ = 0;
+    nibbles_ = 0;
+  }
+
+  std::vector<uint8_t> &out_;
+  uint32_t word_ = 0;
+  int nibbles_ = 0;
+};
+
+class NibbleReader
+{
+public:
+  NibbleReader(const uint8_t *in, size_t size) : in_(in), end_(in + size) {}
+
+  // false if stream ended or value doesn't fit 32 bits
+  inline bool readVLE(uint32_t &value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 32; shift += 3)
+    {
+      if (!nibbles_)
+      {
+        if (end_ - in_ < static_cast<ptrdiff_t>(sizeof(word_)))
+          return false;
+        std::memcpy(&word_, in_, sizeof(word_));
+        in_ += sizeof(word_);
+        nibbles_ = 8;
+      }
+
+      const uint32_t nibble = word_ >> 28;
+      word_ <<= 4;
+      --nibbles_;
+      value |= (nibble & 0x7) << shift;
+      if (!(nibble & 0x8))
+        return true;
+    }
+    return false;
+  }
+
+private:
+  const uint8_t *in_;
+  const uint8_t *end_;
+  uint32_t word_ = 0;
+  int nibbles_ = 0;
+};
+
+} // end anonymous namespace
+
+void encodeRVL(const uint16_t *pixels, size_t n_pixels, std::vector<uint8_t> &out)
+{
+  // worst case is 6 nibbles per pixel, reserve typical case to avoid most reallocations
+  out.reserve(out.size() + n_pixels + 16);
+
+  NibbleWriter writer(out);
+  const uint16_t *end = pixels + n_pixels;
+  int32_t previous = 0;
+
+  while (pixels != end)
+  {
+    const uint16_t *run = pixels;
+    while (pixels != end && !*pixels)
+      ++pixels;
+    writer.writeVLE(pixels - run);
+
+    run = pixels;
+    while (pixels != end && *pixels)
+      ++pixels;
+    writer.writeVLE(pixels - run);
+
+    for (; run != pixels; ++run)
+    {
+      const int32_t delta = int32_t(*run) - previous;
+      // zigzag, small deltas of both signs to small values
+      writer.writeVLE((uint32_t(delta) << 1) ^ uint32_t(delta >> 31));
+      previous = *run;
+    }
+  }
+
+  writer.finish();
+}
+
+bool decodeRVL(const uint8_t *in, size_t size, uint16_t *pixels, size_t n_pixels)
+{
+  NibbleReader reader(in, size);
+  const uint16_t *end = pixels + n_pixels;
+  int32_t previous = 0;
+
+  while (pixels != end)
+  {
+    uint32_t zeros, nonzeros;
+    if (!reader.readVLE(zeros) || zeros > size_t(end - pixels))
+      return false;
+    std::memset(pixels, 0, zeros * sizeof(uint16_t));
+    pixels += zeros;
+
+    if (!reader.readVLE(nonzeros) || nonzeros > size_t(end - pixels))
+      return false;
+
+    for (uint32_t i = 0; i < nonzeros; ++i)
+    {
+      uint32_t zigzag;
+      if (!reader.readVLE(zigzag))
+        return false;
+      previous += int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1);
+      *pixels++ = static_cast<uint16_t>(previous);
+    }
+  }
+
+  return true;
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,284 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/frame_recorder.h>
+
+#include <ros/ros.h>
+#include <opencv2/core/core.hpp>
+
+#include <algorithm> //std::min
+#include <chrono>
+#include <cerrno>
+#include <cstdlib> //posix_memalign
+#include <cstring> //std::memcpy, std::strerror
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace camera_aravis
+{
+
+FrameRecorder::FrameRecorder(const std::string &directory, const std::vector<RecordedSubstream> &substreams,
+                             size_t max_queued_bytes, size_t block_size) :
+    directory_(directory), max_queued_bytes_(max_queued_bytes),
+    block_size_(std::max<size_t>(ALIGNMENT, block_size / ALIGNMENT * ALIGNMENT))
+{
+  if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    ROS_ERROR("Frame recorder can't create %s: %s", directory_.c_str(), std::strerror(errno));
+    return;
+  }
+
+  if (!writeMetadata(substreams))
+  {
+    ROS_ERROR("Frame recorder can't write %s/recording.yaml", directory_.c_str());
+    return;
+  }
+
+  const std::string data_path = directory_ + "/frames.raw";
+  data_fd_ = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+  if (data_fd_ < 0 && errno == EINVAL)
+  {
+    ROS_WARN("File system of %s doesn't support O_DIRECT, frame recorder falls back to buffered writes",
+             directory_.c_str());
+    data_fd_ = open(data_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (data_fd_ < 0)
+  {
+    ROS_ERROR("Frame recorder can't open %s: %s", data_path.c_str(), std::strerror(errno));
+    return;
+  }
+
+  index_.open(directory_ + "/index.bin", std::ios::binary | std::ios::trunc);
+  if (!index_)
+  {
+    ROS_ERROR("Frame recorder can't open %s/index.bin", directory_.c_str());
+    ::close(data_fd_);
+    data_fd_ = -1;
+    return;
+  }
+
+  void *block = nullptr;
+  if (posix_memalign(&block, ALIGNMENT, block_size_) != 0)
+  {
+    ROS_ERROR("Frame recorder can't allocate %zu byte write block", block_size_);
+    ::close(data_fd_);
+    data_fd_ = -1;
+    return;
+  }
+  block_ = static_cast<uint8_t*>(block);
+
+  writer_ = std::thread(&FrameRecorder::writerMain, this);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_ready_.notify_all();
+
+  if (writer_.joinable())
+    writer_.join();
+
+  free(block_);
+}
+
+bool FrameRecorder::push(const FrameRecord &record, const sensor_msgs::ImageConstPtr &image)
+{
+  if (!image || failed_)
+  {
+    ++n_dropped_;
+    return false;
+  }
+
+  Job job;
+  job.record = record;
+  job.record.size = std::min<uint64_t>(image->data.size(), uint64_t(image->height) * image->step);
+  job.image = image;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // a single frame is always accepted so that frames larger than the limit are still recorded
+    if (!jobs_.empty() && queued_bytes_ + job.record.size > max_queued_bytes_)
+    {
+      ++n_dropped_;
+      return false;
+    }
+    queued_bytes_ += job.record.size;
+    jobs_.push_back(std::move(job));
+  }
+  job_ready_.notify_one();
+  return true;
+}
+
+FrameRecorderStatisticsSample FrameRecorder::sample() const
+{
+  FrameRecorderStatisticsSample sample;
+  sample.n_written = n_written_;
+  sample.n_dropped = n_dropped_;
+  sample.bytes_written = bytes_written_;
+  sample.write_ns = write_ns_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sample.queued_bytes = queued_bytes_;
+  }
+  return sample;
+}
+
+bool FrameRecorder::idle() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return jobs_.empty() && queued_bytes_ == 0;
+}
+
+bool FrameRecorder::writeMetadata(const std::vector<RecordedSubstream> &substreams) const
+{
+  cv::FileStorage fs(directory_ + "/recording.yaml", cv::FileStorage::WRITE);
+  if (!fs.isOpened())
+    return false;
+
+  fs << "version" << 1;
+  fs << "substreams" << "[";
+  for (const RecordedSubstream &substream : substreams)
+  {
+    fs << "{";
+    fs << "name" << substream.name;
+    fs << "frame_id" << substream.frame_id;
+    fs << "pixel_format" << substream.pixel_format;
+    fs << "bits_per_pixel" << int(substream.bits_per_pixel);
+    fs << "}";
+  }
+  fs << "]";
+  fs.release();
+  return true;
+}
+
+void FrameRecorder::writerMain()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      // stop only after queue is drained
+      if (jobs_.empty())
+        break;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    if (!failed_)
+    {
+      job.record.offset = data_offset_;
+      append(job.image->data.data(), job.record.size);
+      index_.write(reinterpret_cast<const char*>(&job.record), sizeof(job.record));
+      ++n_written_;
+    }
+    else
+    {
+      ++n_dropped_;
+    }
+
+    // releases camera buffer back to pool
+    const uint64_t size = job.record.size;
+    job.image.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_bytes_ -= size;
+  }
+
+  close();
+}
+
+void FrameRecorder::append(const uint8_t *data, size_t size)
+{
+  data_offset_ += size;
+  while (size > 0)
+  {
+    const size_t n = std::min(size, block_size_ - block_fill_);
+    std::memcpy(block_ + block_fill_, data, n);
+    block_fill_ += n;
+    data += n;
+    size -= n;
+
+    if (block_fill_ == block_size_)
+    {
+      writeBlock(block_size_);
+      block_fill_ = 0;
+      // index never points far ahead of data on disk
+      index_.flush();
+    }
+  }
+}
+
+void FrameRecorder::writeBlock(size_t size)
+{
+  if (failed_)
+    return;
+
+  const auto start = std::chrono::steady_clock::now();
+  size_t written = 0;
+  while (written < size)
+  {
+    const ssize_t n = write(data_fd_, block_ + written, size - written);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      ROS_ERROR("Frame recorder write to %s failed: %s, recording stopped",
+                directory_.c_str(), n < 0 ? std::strerror(errno) : "no space left");
+      failed_ = true;
+      return;
+    }
+    written += n;
+  }
+  write_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  bytes_written_ += size;
+}
+
+void FrameRecorder::close()
+{
+  if (block_fill_ > 0)
+  {
+    // O_DIRECT writes whole aligned blocks, padding is truncated below
+    const size_t padded = (block_fill_ + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    std::memset(block_ + block_fill_, 0, padded - block_fill_);
+    writeBlock(padded);
+    block_fill_ = 0;
+  }
+
+  if (ftruncate(data_fd_, data_offset_) != 0)
+    ROS_WARN("Frame recorder can't truncate %s/frames.raw: %s", directory_.c_str(), std::strerror(errno));
+  ::close(data_fd_);
+  data_fd_ = -1;
+  index_.close();
+
+  ROS_INFO("Frame recorder closed %s: %lu frames, %lu dropped", directory_.c_str(),
+           static_cast<unsigned long>(n_written_), static_cast<unsigned long>(n_dropped_));
+}
+
+} // end namespace camera_aravis
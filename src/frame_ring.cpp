@@ -0,0 +1,96 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/frame_ring.h>
+
+namespace camera_aravis
+{
+
+void FrameRing::push(const FrameRecord &record, const sensor_msgs::ImageConstPtr &image, size_t charge)
+{
+  // evicted images go back to their pool outside of the lock
+  std::deque<RingFrame> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    RingFrame frame;
+    frame.record = record;
+    frame.image = image;
+    frame.charge = charge;
+    frames_.push_back(std::move(frame));
+    bytes_ += charge;
+
+    while (!frames_.empty() &&
+           (bytes_ + frozenBytes() > max_bytes_ || (record.stamp_ns > frames_.front().record.stamp_ns &&
+                                    record.stamp_ns - frames_.front().record.stamp_ns > max_duration_ns_)))
+    {
+      bytes_ -= frames_.front().charge;
+      evicted.push_back(std::move(frames_.front()));
+      frames_.pop_front();
+    }
+  }
+}
+
+std::deque<RingFrame> FrameRing::freeze()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::deque<RingFrame> frames;
+  frames.swap(frames_);
+  bytes_ = 0;
+
+  // charge stays on the budget until flush releases the image
+  const std::shared_ptr<std::atomic<size_t>> frozen_bytes = frozen_bytes_;
+  for (RingFrame &frame : frames)
+  {
+    frozen_bytes->fetch_add(frame.charge, std::memory_order_relaxed);
+    sensor_msgs::ImageConstPtr image = frame.image;
+    const size_t charge = frame.charge;
+    frame.image = sensor_msgs::ImageConstPtr(image.get(), [image, charge, frozen_bytes](const sensor_msgs::Image*) mutable
+                                             {
+                                               image.reset();
+                                               frozen_bytes->fetch_sub(charge, std::memory_order_relaxed);
+                                             });
+  }
+  return frames;
+}
+
+size_t FrameRing::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_.size();
+}
+
+size_t FrameRing::bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+uint64_t FrameRing::durationNs() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_.empty() ? 0 : frames_.back().record.stamp_ns - frames_.front().record.stamp_ns;
+}
+
+} // end namespace camera_aravis
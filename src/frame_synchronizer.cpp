@@ -0,0 +1,128 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/frame_synchronizer.h>
+
+#include <algorithm> //std::all_of
+
+namespace camera_aravis
+{
+
+FrameSynchronizer::FrameSynchronizer(size_t n_cameras, uint64_t tolerance_ns, size_t queue_size, SetCallback on_set) :
+  tolerance_ns_(tolerance_ns), queue_size_(std::max<size_t>(queue_size, 1)), on_set_(on_set),
+  queues_(n_cameras), set_(n_cameras), n_dropped_(n_cameras, 0)
+{
+}
+
+void FrameSynchronizer::push(size_t camera, const SyncFrame &frame)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (camera >= queues_.size() || !frame.image)
+    return;
+
+  // camera without partners for a while, e.g. another camera stopped
+  std::deque<SyncFrame> &queue = queues_[camera];
+  if (queue.size() >= queue_size_)
+  {
+    queue.pop_front();
+    ++n_dropped_[camera];
+    ++n_incomplete_;
+  }
+
+  queue.push_back(frame);
+
+  match();
+}
+
+void FrameSynchronizer::match()
+{
+  while (std::all_of(queues_.begin(), queues_.end(), [](const std::deque<SyncFrame> &q) { return !q.empty(); }))
+  {
+    uint64_t earliest_ns = UINT64_MAX, latest_ns = 0;
+    for (const std::deque<SyncFrame> &queue : queues_)
+    {
+      const uint64_t stamp_ns = queue.front().image->header.stamp.toNSec();
+      earliest_ns = std::min(earliest_ns, stamp_ns);
+      latest_ns = std::max(latest_ns, stamp_ns);
+    }
+
+    const uint64_t skew_ns = latest_ns - earliest_ns;
+
+    if (skew_ns > tolerance_ns_)
+    {
+      dropIncomplete(earliest_ns);
+      continue;
+    }
+
+    for (size_t i = 0; i < queues_.size(); ++i)
+    {
+      set_[i] = queues_[i].front();
+      queues_[i].pop_front();
+    }
+
+    ++n_sets_;
+    skew_.add(skew_ns);
+
+    on_set_(set_, skew_ns);
+
+    // don't pin images until the next set
+    for (SyncFrame &frame : set_)
+      frame = SyncFrame();
+  }
+}
+
+void FrameSynchronizer::dropIncomplete(uint64_t earliest_ns)
+{
+  // frames that would have belonged to the set of the earliest head, its partner is missing
+  for (size_t i = 0; i < queues_.size(); ++i)
+  {
+    std::deque<SyncFrame> &queue = queues_[i];
+    if (!queue.empty() && queue.front().image->header.stamp.toNSec() - earliest_ns <= tolerance_ns_)
+    {
+      queue.pop_front();
+      ++n_dropped_[i];
+    }
+  }
+  ++n_incomplete_;
+}
+
+FrameSynchronizerStatisticsSample FrameSynchronizer::sample()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  FrameSynchronizerStatisticsSample sample;
+  sample.n_sets = n_sets_;
+  sample.n_incomplete = n_incomplete_;
+  sample.n_dropped = n_dropped_;
+  sample.skew_p50_ns = skew_.percentile(0.5);
+  sample.skew_p99_ns = skew_.percentile(0.99);
+  sample.skew_max_ns = skew_.max();
+
+  skew_.reset();
+
+  return sample;
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,171 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/frame_synchronizer_nodelet.h>
+
+#include <boost/algorithm/string/trim.hpp>
+
+#include <algorithm> //std::max
+#include <sstream>
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(camera_aravis::FrameSynchronizerNodelet, nodelet::Nodelet)
+
+namespace camera_aravis
+{
+
+FrameSynchronizerNodelet::FrameSynchronizerNodelet()
+{
+}
+
+FrameSynchronizerNodelet::~FrameSynchronizerNodelet()
+{
+  diagnostic_timer_.stop();
+
+  for (image_transport::CameraSubscriber &sub : camera_subs_)
+    sub.shutdown();
+}
+
+void FrameSynchronizerNodelet::onInit()
+{
+  ros::NodeHandle nh = getNodeHandle();
+  ros::NodeHandle pnh = getPrivateNodeHandle();
+
+  // camera namespaces, e.g. "cam0;cam1;cam2"
+  std::vector<std::string> cameras;
+  std::stringstream camera_args(pnh.param<std::string>("cameras", ""));
+  for (std::string camera; std::getline(camera_args, camera, ';');)
+  {
+    boost::trim(camera);
+    if (!camera.empty())
+      cameras.push_back(camera);
+  }
+
+  if (cameras.size() < 2)
+  {
+    ROS_ERROR("Frame synchronizer needs at least 2 cameras (e.g. cameras: \"cam0;cam1\"), got %zu", cameras.size());
+    return;
+  }
+
+  const double tolerance_ms = pnh.param<double>("tolerance_ms", 1.0);
+  const int queue_size = std::max(pnh.param<int>("queue_size", 4), 1);
+  const std::string output_namespace = pnh.param<std::string>("output_namespace", "synchronized");
+  diagnostic_rate_ = pnh.param<double>("diagnostic_rate", diagnostic_rate_);
+
+  synchronizer_.reset(new FrameSynchronizer(cameras.size(), tolerance_ms * 1e6, queue_size,
+                                            std::bind(&FrameSynchronizerNodelet::publishSet, this,
+                                                      std::placeholders::_1, std::placeholders::_2)));
+
+  p_transport_.reset(new image_transport::ImageTransport(nh));
+
+  for (const std::string &camera : cameras)
+  {
+    std::string name = camera.substr(0, camera.find_last_not_of('/') + 1);
+    name = name.substr(name.find_last_of('/') + 1);
+    camera_names_.push_back(name);
+
+    camera_pubs_.push_back(p_transport_->advertiseCamera(output_namespace + "/" + name + "/image_raw", 1));
+  }
+
+  bundle_pub_ = nh.advertise<FrameBundle>(output_namespace + "/bundle", 1);
+
+  // subscribe last, sets may be published right away
+  for (size_t i = 0; i < cameras.size(); ++i)
+    camera_subs_.push_back(p_transport_->subscribeCamera(
+      cameras[i] + "/image_raw", queue_size,
+      boost::bind(&FrameSynchronizerNodelet::frameCallback, this, i, _1, _2)));
+
+  if (diagnostic_rate_ > 0.0)
+  {
+    diagnostic_updater_.reset(new diagnostic_updater::Updater(nh, pnh, getName()));
+    diagnostic_updater_->setHardwareID("synchronizer");
+    diagnostic_updater_->add("Frame synchronizer",
+                             boost::bind(&FrameSynchronizerNodelet::produceDiagnostics, this, _1));
+    diagnostic_timer_ = pnh.createTimer(ros::Duration(1.0 / diagnostic_rate_),
+                                        &FrameSynchronizerNodelet::diagnosticTimerCallback, this);
+  }
+
+  ROS_INFO("Synchronizing %zu cameras within %.3f ms to %s", cameras.size(), tolerance_ms,
+           nh.resolveName(output_namespace).c_str());
+}
+
+void FrameSynchronizerNodelet::frameCallback(size_t camera, const sensor_msgs::ImageConstPtr &image,
+                                             const sensor_msgs::CameraInfoConstPtr &camera_info)
+{
+  synchronizer_->push(camera, {image, camera_info});
+}
+
+void FrameSynchronizerNodelet::publishSet(const std::vector<SyncFrame> &frames, uint64_t skew_ns)
+{
+  // same messages as received, intra-process subscribers get the pointers
+  for (size_t i = 0; i < frames.size(); ++i)
+    camera_pubs_[i].publish(frames[i].image, frames[i].camera_info);
+
+  if (bundle_pub_.getNumSubscribers() == 0)
+    return;
+
+  FrameBundlePtr bundle(new FrameBundle);
+  bundle->cameras = camera_names_;
+  bundle->skew = skew_ns * 1e-9;
+
+  for (const SyncFrame &frame : frames)
+  {
+    bundle->headers.push_back(frame.image->header);
+    if (bundle->headers.size() == 1 || frame.image->header.stamp < bundle->header.stamp)
+      bundle->header = frame.image->header;
+  }
+
+  bundle_pub_.publish(bundle);
+}
+
+void FrameSynchronizerNodelet::diagnosticTimerCallback(const ros::TimerEvent &event)
+{
+  // Updater::update() is rate limited by its own ~diagnostic_period, we use our rate instead
+  diagnostic_updater_->force_update();
+}
+
+void FrameSynchronizerNodelet::produceDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const FrameSynchronizerStatisticsSample sample = synchronizer_->sample();
+  const FrameSynchronizerStatisticsSample &last = last_statistics_;
+
+  stat.add("Sets", sample.n_sets);
+  stat.add("Incomplete sets", sample.n_incomplete);
+  for (size_t i = 0; i < camera_names_.size(); ++i)
+    stat.add("Dropped frames " + camera_names_[i], sample.n_dropped[i]);
+  stat.addf("Skew p50", "%.3f ms", sample.skew_p50_ns * 1e-6);
+  stat.addf("Skew p99", "%.3f ms", sample.skew_p99_ns * 1e-6);
+  stat.addf("Skew max", "%.3f ms", sample.skew_max_ns * 1e-6);
+
+  if (sample.n_sets == last.n_sets)
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "No sets");
+  else if (sample.n_incomplete != last.n_incomplete)
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "Incomplete sets");
+  else
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Synchronized");
+
+  last_statistics_ = sample;
+}
+
+} // end namespace camera_aravis
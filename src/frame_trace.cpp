@@ -0,0 +1,174 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/frame_trace.h>
+
+#include <algorithm>
+
+namespace camera_aravis
+{
+
+void FrameTrace::writeCsvHeader(std::ostream &out)
+{
+  out << "substream,frame_id,camera_ns,arrival_ns,delegate_ns,dequeue_ns,"
+         "convert_begin_ns,convert_end_ns,publish_ns\n";
+}
+
+void FrameTrace::writeCsv(std::ostream &out, const std::string &substream) const
+{
+  out << substream << ',' << frame_id << ',' << camera_ns << ',' << arrival_ns << ','
+      << delegate_ns << ',' << dequeue_ns << ',' << convert_begin_ns << ','
+      << convert_end_ns << ',' << publish_ns << '\n';
+}
+
+const char* frameTraceStageName(FrameTraceStage stage)
+{
+  switch(stage)
+  {
+    case TRACE_STAGE_DELIVERY:
+      return "delivery";
+    case TRACE_STAGE_QUEUE:
+      return "queue";
+    case TRACE_STAGE_PREPARE:
+      return "prepare";
+    case TRACE_STAGE_CONVERSION:
+      return "conversion";
+    case TRACE_STAGE_PUBLISH:
+      return "publish";
+    case TRACE_STAGE_TOTAL:
+      return "total";
+    default:
+      return "unknown";
+  }
+}
+
+FrameTraceRing::FrameTraceRing(size_t capacity)
+{
+  size_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+
+  ring_.resize(size);
+  mask_ = size - 1;
+}
+
+bool FrameTraceRing::push(const FrameTrace &trace)
+{
+  std::lock_guard<std::mutex> lock(push_mutex_);
+  const size_t head = head_.load(std::memory_order_relaxed);
+
+  if (head - tail_.load(std::memory_order_acquire) == ring_.size())
+  {
+    n_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  ring_[head & mask_] = trace;
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool FrameTraceRing::pop(FrameTrace &trace)
+{
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+
+  if (tail == head_.load(std::memory_order_acquire))
+    return false;
+
+  trace = ring_[tail & mask_];
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns)
+{
+  // values below SUB_BUCKETS map linearly, above by exponent and top mantissa bits
+  if (ns < SUB_BUCKETS)
+    return ns;
+
+  const int exponent = 63 - __builtin_clzll(ns);
+  const int shift = exponent - SUB_BUCKET_BITS;
+  const size_t mantissa = (ns >> shift) & (SUB_BUCKETS - 1);
+  return (shift + 1) * SUB_BUCKETS + mantissa;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+  if (index < SUB_BUCKETS)
+    return index;
+
+  const int shift = index / SUB_BUCKETS - 1;
+  const uint64_t mantissa = index % SUB_BUCKETS;
+  return ((SUB_BUCKETS + mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t ns)
+{
+  ++buckets_[bucketIndex(ns)];
+  ++count_;
+  max_ns_ = std::max(max_ns_, ns);
+}
+
+void LatencyHistogram::reset()
+{
+  buckets_.fill(0);
+  count_ = 0;
+  max_ns_ = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+  if (!count_)
+    return 0;
+
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count_ + 0.5));
+  uint64_t seen = 0;
+
+  for(size_t i = 0; i < buckets_.size(); ++i)
+  {
+    seen += buckets_[i];
+    if (seen >= rank)
+      return std::min(bucketUpperBound(i), max_ns_);
+  }
+
+  return max_ns_;
+}
+
+void FrameTraceStatistics::add(const FrameTrace &trace)
+{
+  stages[TRACE_STAGE_DELIVERY].add(frameTraceInterval(trace.arrival_ns, trace.delegate_ns));
+  stages[TRACE_STAGE_QUEUE].add(frameTraceInterval(trace.delegate_ns, trace.dequeue_ns));
+  stages[TRACE_STAGE_PREPARE].add(frameTraceInterval(trace.dequeue_ns, trace.convert_begin_ns));
+  stages[TRACE_STAGE_CONVERSION].add(frameTraceInterval(trace.convert_begin_ns, trace.convert_end_ns));
+  stages[TRACE_STAGE_PUBLISH].add(frameTraceInterval(trace.convert_end_ns, trace.publish_ns));
+  stages[TRACE_STAGE_TOTAL].add(frameTraceInterval(trace.arrival_ns, trace.publish_ns));
+}
+
+void FrameTraceStatistics::reset()
+{
+  for(LatencyHistogram &histogram : stages)
+    histogram.reset();
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,339 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/gvsp_receiver.h>
+#include <camera_aravis/frame_trace.h>
+
+#include <ros/ros.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm> //std::max
+#include <cerrno>
+#include <cstring> //memcpy, strerror
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+// GigE Vision stream protocol, all fields big endian
+const size_t GVSP_HEADER_SIZE = 8;
+const size_t GVSP_EXTENDED_HEADER_SIZE = 20;
+const size_t IP_UDP_HEADER_SIZE = 20 + 8;
+const size_t GVSP_IMAGE_LEADER_SIZE = 36;
+
+const uint8_t GVSP_EXTENDED_ID_FLAG = 0x80;
+const uint8_t GVSP_PACKET_FORMAT_MASK = 0x0f;
+
+enum GvspPacketFormat
+{
+  GVSP_LEADER = 1,
+  GVSP_TRAILER = 2,
+  GVSP_DATA = 3
+};
+
+const uint16_t GVSP_PAYLOAD_IMAGE = 0x0001;
+const uint16_t GVSP_PAYLOAD_IMAGE_EXTENDED_CHUNK = 0x4001;
+
+// sanity bound of reassembled block, packets beyond are malformed
+const size_t MAX_BLOCK_SIZE = 512 * 1024 * 1024;
+
+uint16_t be16(const uint8_t *p)
+{
+  return uint16_t(p[0]) << 8 | p[1];
+}
+
+uint32_t be24(const uint8_t *p)
+{
+  return uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2];
+}
+
+uint32_t be32(const uint8_t *p)
+{
+  return uint32_t(be16(p)) << 16 | be16(p + 2);
+}
+
+uint64_t be64(const uint8_t *p)
+{
+  return uint64_t(be32(p)) << 32 | be32(p + 4);
+}
+
+} // end anonymous namespace
+
+GvspReceiver::GvspReceiver(const std::string &group, const std::string &interface_address, uint16_t port,
+                           uint32_t packet_size, FrameCallback on_frame, LossCallback on_loss) :
+  group_(group), interface_address_(interface_address), port_(port), packet_size_(packet_size),
+  on_frame_(on_frame), on_loss_(on_loss)
+{
+}
+
+GvspReceiver::~GvspReceiver()
+{
+  stop();
+}
+
+bool GvspReceiver::start()
+{
+  in_addr group_addr;
+  if (inet_pton(AF_INET, group_.c_str(), &group_addr) != 1 || !IN_MULTICAST(ntohl(group_addr.s_addr)))
+  {
+    ROS_ERROR("%s is not an IPv4 multicast address", group_.c_str());
+    return false;
+  }
+
+  in_addr interface_addr;
+  interface_addr.s_addr = htonl(INADDR_ANY);
+  if (!interface_address_.empty() && inet_pton(AF_INET, interface_address_.c_str(), &interface_addr) != 1)
+  {
+    ROS_ERROR("%s is not an IPv4 interface address", interface_address_.c_str());
+    return false;
+  }
+
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0)
+  {
+    ROS_ERROR("Failed to create GVSP socket: %s", strerror(errno));
+    return false;
+  }
+
+  // monitors on the same host share the port
+  const int reuse = 1;
+  setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  // frames arrive in bursts at link rate, capped by net.core.rmem_max
+  const int receive_buffer = 16 * 1024 * 1024;
+  setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+
+  // short enough to notice termination timely
+  timeval timeout = {0, 100000};
+  setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // bound to group address, other datagrams to the port are not received
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_);
+  address.sin_addr = group_addr;
+
+  ip_mreq membership;
+  membership.imr_multiaddr = group_addr;
+  membership.imr_interface = interface_addr;
+
+  if (bind(socket_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+      setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0)
+  {
+    ROS_ERROR("Failed to join %s:%u for GVSP: %s", group_.c_str(), port_, strerror(errno));
+    close(socket_);
+    socket_ = -1;
+    return false;
+  }
+
+  ROS_INFO("Receiving GVSP from %s:%u", group_.c_str(), port_);
+
+  active_ = true;
+  thread_ = std::thread(&GvspReceiver::threadMain, this);
+  return true;
+}
+
+void GvspReceiver::stop()
+{
+  active_ = false;
+
+  if (thread_.joinable())
+    thread_.join();
+
+  // leaves the group as well
+  if (socket_ >= 0)
+    close(socket_);
+  socket_ = -1;
+}
+
+GvspReceiverStatisticsSample GvspReceiver::sample() const
+{
+  GvspReceiverStatisticsSample sample;
+  sample.n_completed = n_completed_;
+  sample.n_incomplete = n_incomplete_;
+  sample.n_ignored = n_ignored_;
+  return sample;
+}
+
+void GvspReceiver::threadMain()
+{
+  // largest UDP payload, jumbo frames included
+  std::vector<uint8_t> packet(65536);
+
+  while (active_)
+  {
+    const ssize_t size = recv(socket_, packet.data(), packet.size(), 0);
+
+    if (size < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        continue;
+      ROS_ERROR("GVSP receive from %s:%u failed: %s", group_.c_str(), port_, strerror(errno));
+      break;
+    }
+
+    handlePacket(packet.data(), size);
+  }
+}
+
+void GvspReceiver::handlePacket(const uint8_t *packet, size_t size)
+{
+  if (size < GVSP_HEADER_SIZE || be16(packet) != 0)
+  {
+    ++n_ignored_;
+    return;
+  }
+
+  const bool extended_id = packet[4] & GVSP_EXTENDED_ID_FLAG;
+  const uint8_t format = packet[4] & GVSP_PACKET_FORMAT_MASK;
+  const size_t header_size = extended_id ? GVSP_EXTENDED_HEADER_SIZE : GVSP_HEADER_SIZE;
+
+  if (size < header_size)
+  {
+    ++n_ignored_;
+    return;
+  }
+
+  const uint64_t block_id = extended_id ? be64(packet + 8) : be16(packet + 2);
+  const uint32_t packet_id = extended_id ? be32(packet + 16) : be24(packet + 5);
+  const uint8_t *payload = packet + header_size;
+  const size_t payload_size = size - header_size;
+
+  if (!block_open_ || block_id != frame_.block_id)
+  {
+    // late packet of a previous block, 16 bit ids wrap around
+    const bool older = extended_id ? block_id < frame_.block_id : int16_t(block_id - frame_.block_id) < 0;
+    if (block_open_ && older)
+      return;
+
+    finishBlock();
+
+    block_open_ = true;
+    block_done_ = false;
+    leader_received_ = false;
+    trailer_received_ = false;
+    n_data_packets_ = 0;
+    n_received_ = 0;
+    extent_ = 0;
+    std::fill(received_.begin(), received_.end(), false);
+    frame_.block_id = block_id;
+    frame_.arrival_ns = frameTraceNow();
+    data_size_ = packet_size_ > IP_UDP_HEADER_SIZE + header_size ? packet_size_ - IP_UDP_HEADER_SIZE - header_size : 0;
+  }
+
+  if (block_done_)
+    return;
+
+  if (format == GVSP_LEADER)
+  {
+    const uint16_t payload_type = payload_size >= 4 ? be16(payload + 2) : 0;
+
+    if (payload_size < GVSP_IMAGE_LEADER_SIZE ||
+        (payload_type != GVSP_PAYLOAD_IMAGE && payload_type != GVSP_PAYLOAD_IMAGE_EXTENDED_CHUNK))
+    {
+      ++n_ignored_;
+      block_done_ = true;
+      return;
+    }
+
+    leader_received_ = true;
+    frame_.arrival_ns = frameTraceNow();
+    frame_.timestamp = be64(payload + 4);
+    frame_.pixel_format = be32(payload + 12);
+    frame_.width = be32(payload + 16);
+    frame_.height = be32(payload + 20);
+    frame_.x = be32(payload + 24);
+    frame_.y = be32(payload + 28);
+
+    // effective bits per pixel are encoded in pixel format (PFNC)
+    const size_t bits_per_pixel = (frame_.pixel_format >> 16) & 0xff;
+    const size_t expected = (size_t(frame_.width) * frame_.height * bits_per_pixel + 7) / 8;
+    if (expected <= MAX_BLOCK_SIZE && frame_.data.size() < expected)
+      frame_.data.resize(expected);
+  }
+  else if (format == GVSP_TRAILER)
+  {
+    trailer_received_ = true;
+    n_data_packets_ = packet_id > 0 ? packet_id - 1 : 0;
+  }
+  else if (format == GVSP_DATA)
+  {
+    if (!data_size_)
+      data_size_ = payload_size;
+
+    const size_t offset = size_t(packet_id - 1) * data_size_;
+
+    if (packet_id == 0 || payload_size > data_size_ || offset + payload_size > MAX_BLOCK_SIZE)
+    {
+      ++n_ignored_;
+      return;
+    }
+
+    if (received_.size() < packet_id)
+      received_.resize(packet_id, false);
+    if (received_[packet_id - 1])
+      return;
+    received_[packet_id - 1] = true;
+    ++n_received_;
+
+    if (frame_.data.size() < offset + payload_size)
+      frame_.data.resize(offset + payload_size);
+    memcpy(frame_.data.data() + offset, payload, payload_size);
+    extent_ = std::max(extent_, offset + payload_size);
+  }
+  else
+  {
+    // all-in, H.264, multi-zone and multipart payloads
+    ++n_ignored_;
+    block_done_ = true;
+    return;
+  }
+
+  if (leader_received_ && trailer_received_ && n_received_ == n_data_packets_)
+  {
+    block_done_ = true;
+    ++n_completed_;
+
+    frame_.data.resize(extent_);
+    on_frame_(frame_);
+  }
+}
+
+void GvspReceiver::finishBlock()
+{
+  if (!block_open_ || block_done_)
+    return;
+
+  ++n_incomplete_;
+  on_loss_(frame_.block_id);
+}
+
+} // end namespace camera_aravis
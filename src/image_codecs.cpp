@@ -0,0 +1,415 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/image_codecs.h>
+#include <camera_aravis/depth_codec.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp> //cv::imencode, cv::imdecode
+#include <opencv2/imgproc.hpp> //cv::cvtColor
+
+#ifdef CAMERA_ARAVIS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm> //std::min
+#include <cmath> //std::isfinite, std::round
+#include <cstring> //std::memcpy
+#include <stdexcept>
+#include <vector>
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+namespace enc = sensor_msgs::image_encodings;
+
+// channel order of OpenCV codecs is BGR, RGB images are swapped before encoding
+bool rgbOrder(const std::string &encoding)
+{
+  return encoding == enc::RGB8 || encoding == enc::RGBA8 || encoding == enc::RGB16 || encoding == enc::RGBA16;
+}
+
+std::string bgrEncoding(const std::string &encoding)
+{
+  if (encoding == enc::RGB8)
+    return enc::BGR8;
+  if (encoding == enc::RGBA8)
+    return enc::BGRA8;
+  if (encoding == enc::RGB16)
+    return enc::BGR16;
+  if (encoding == enc::RGBA16)
+    return enc::BGRA16;
+  return encoding;
+}
+
+// OpenCV type of image OpenCV codecs can store, -1 otherwise
+int codecCvType(const std::string &encoding)
+{
+  try
+  {
+    const int channels = enc::numChannels(encoding);
+    const int depth = enc::bitDepth(encoding);
+    if ((channels != 1 && channels != 3 && channels != 4) || (depth != 8 && depth != 16) ||
+        encoding.find("SC") != std::string::npos)
+      return -1;
+    return CV_MAKETYPE(depth == 8 ? CV_8U : CV_16U, channels);
+  }
+  catch (const std::runtime_error &)
+  {
+    // unknown encoding
+    return -1;
+  }
+}
+
+bool is16Bit(const std::string &encoding)
+{
+  try
+  {
+    return enc::bitDepth(encoding) == 16;
+  }
+  catch (const std::runtime_error &)
+  {
+    return false;
+  }
+}
+
+bool encodeOpenCV(const sensor_msgs::Image &image, const std::string &codec, const std::vector<int> &codec_params,
+                  sensor_msgs::CompressedImage &compressed)
+{
+  const int type = codecCvType(image.encoding);
+  if (type < 0)
+  {
+    ROS_WARN_STREAM_ONCE("camera_aravis::encodeImage(): " << codec << " can't compress encoding " << image.encoding);
+    return false;
+  }
+
+  const cv::Mat mat(image.height, image.width, type, const_cast<uint8_t*>(image.data.data()), image.step);
+  const std::string target = codec == "jpeg" ? (CV_MAT_CN(type) == 1 ? enc::MONO8 : enc::BGR8) :
+                                               bgrEncoding(image.encoding);
+  cv::Mat bgr = mat;
+  if (rgbOrder(image.encoding))
+    cv::cvtColor(mat, bgr, CV_MAT_CN(type) == 4 ? cv::COLOR_RGBA2BGRA : cv::COLOR_RGB2BGR);
+
+  compressed.format = image.encoding + "; " + codec + " compressed " + target;
+  return cv::imencode("." + codec, bgr, compressed.data, codec_params);
+}
+
+bool decodeOpenCV(const sensor_msgs::CompressedImage &compressed, const std::string &encoding, sensor_msgs::Image &image)
+{
+  cv::Mat mat = cv::imdecode(compressed.data, cv::IMREAD_UNCHANGED);
+  if (mat.empty())
+    return false;
+
+  if (rgbOrder(encoding) && mat.channels() >= 3)
+    cv::cvtColor(mat, mat, mat.channels() == 4 ? cv::COLOR_BGRA2RGBA : cv::COLOR_BGR2RGB);
+
+  image.header = compressed.header;
+  image.encoding = encoding;
+  image.height = mat.rows;
+  image.width = mat.cols;
+  image.is_bigendian = false;
+  image.step = mat.cols * mat.elemSize();
+  image.data.resize(image.height * image.step);
+  for (int r = 0; r < mat.rows; ++r)
+    std::memcpy(image.data.data() + r * image.step, mat.ptr<uint8_t>(r), image.step);
+  return true;
+}
+
+bool isDepth(const std::string &encoding)
+{
+  return encoding == enc::TYPE_16UC1 || encoding == enc::TYPE_32FC1;
+}
+
+// per thread 16 bit depth, for quantized float and padded rows
+thread_local std::vector<uint16_t> rvl_pixels;
+
+bool encodeRvl(const sensor_msgs::Image &image, double depth_scale, sensor_msgs::CompressedImage &compressed)
+{
+  const bool is_float = image.encoding == enc::TYPE_32FC1;
+  const size_t row_size = image.width * (is_float ? sizeof(float) : sizeof(uint16_t));
+  if (image.is_bigendian || image.step < row_size || image.data.size() < size_t(image.height) * image.step ||
+      (is_float && depth_scale <= 0.0))
+    return false;
+
+  RvlHeader header;
+  header.width = image.width;
+  header.height = image.height;
+  header.depth_scale = is_float ? depth_scale : 0.0f;
+
+  compressed.format = image.encoding + "; rvl compressed";
+  compressed.data.resize(sizeof(header));
+  std::memcpy(compressed.data.data(), &header, sizeof(header));
+
+  const size_t n_pixels = size_t(image.width) * image.height;
+  if (!is_float && image.step == row_size)
+  {
+    encodeRVL(reinterpret_cast<const uint16_t*>(image.data.data()), n_pixels, compressed.data);
+    return true;
+  }
+
+  rvl_pixels.resize(n_pixels);
+  for (uint32_t r = 0; r < image.height; ++r)
+  {
+    const uint8_t *row = image.data.data() + r * image.step;
+    uint16_t *to = rvl_pixels.data() + size_t(r) * image.width;
+
+    if (!is_float)
+    {
+      std::memcpy(to, row, row_size);
+      continue;
+    }
+
+    const float *from = reinterpret_cast<const float*>(row);
+    for (uint32_t x = 0; x < image.width; ++x)
+    {
+      // NaN, infinite and non-positive depth is invalid
+      const double value = from[x] * depth_scale;
+      to[x] = std::isfinite(value) && value > 0.0 ? static_cast<uint16_t>(std::min(std::round(value), 65535.0)) : 0;
+    }
+  }
+
+  encodeRVL(rvl_pixels.data(), n_pixels, compressed.data);
+  return true;
+}
+
+bool decodeRvl(const sensor_msgs::CompressedImage &compressed, const std::string &encoding, sensor_msgs::Image &image)
+{
+  RvlHeader header;
+  if (compressed.data.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, compressed.data.data(), sizeof(header));
+
+  const bool is_float = header.depth_scale > 0.0f;
+  if (header.magic != RvlHeader::MAGIC || is_float != (encoding == enc::TYPE_32FC1))
+    return false;
+
+  const size_t n_pixels = size_t(header.width) * header.height;
+  image.header = compressed.header;
+  image.encoding = encoding;
+  image.height = header.height;
+  image.width = header.width;
+  image.is_bigendian = false;
+  image.step = header.width * (is_float ? sizeof(float) : sizeof(uint16_t));
+  image.data.resize(image.height * image.step);
+
+  uint16_t *pixels = reinterpret_cast<uint16_t*>(image.data.data());
+  if (is_float)
+  {
+    rvl_pixels.resize(n_pixels);
+    pixels = rvl_pixels.data();
+  }
+
+  if (!decodeRVL(compressed.data.data() + sizeof(header), compressed.data.size() - sizeof(header), pixels, n_pixels))
+    return false;
+
+  if (is_float)
+  {
+    float *depth = reinterpret_cast<float*>(image.data.data());
+    const float unit = 1.0f / header.depth_scale;
+    for (size_t i = 0; i < n_pixels; ++i)
+      depth[i] = pixels[i] * unit;
+  }
+
+  return true;
+}
+
+#ifdef CAMERA_ARAVIS_HAVE_ZSTD
+
+// per thread contexts, compression workers reuse them for every frame
+struct ZstdContexts
+{
+  ZSTD_CCtx *compression = ZSTD_createCCtx();
+  ZSTD_DCtx *decompression = ZSTD_createDCtx();
+  std::vector<uint8_t> planes;
+
+  ~ZstdContexts()
+  {
+    ZSTD_freeCCtx(compression);
+    ZSTD_freeDCtx(decompression);
+  }
+};
+
+thread_local ZstdContexts zstd_contexts;
+
+// 16 bit pixels to low and high byte planes, high bytes compress much better when separate
+void splitBytePlanes(const uint8_t *in, uint8_t *out, size_t n_pixels)
+{
+  for (size_t i = 0; i < n_pixels; ++i)
+  {
+    out[i] = in[2 * i];
+    out[n_pixels + i] = in[2 * i + 1];
+  }
+}
+
+void mergeBytePlanes(const uint8_t *in, uint8_t *out, size_t n_pixels)
+{
+  for (size_t i = 0; i < n_pixels; ++i)
+  {
+    out[2 * i] = in[i];
+    out[2 * i + 1] = in[n_pixels + i];
+  }
+}
+
+bool encodeZstd(const sensor_msgs::Image &image, int level, sensor_msgs::CompressedImage &compressed)
+{
+  ZstdHeader header;
+  header.width = image.width;
+  header.height = image.height;
+  header.step = image.step;
+
+  const size_t size = size_t(image.height) * image.step;
+  if (image.data.size() < size)
+    return false;
+
+  const uint8_t *src = image.data.data();
+  if (is16Bit(image.encoding) && !image.is_bigendian && size % 2 == 0)
+  {
+    header.flags |= ZstdHeader::FLAG_BYTE_PLANES;
+    zstd_contexts.planes.resize(size);
+    splitBytePlanes(src, zstd_contexts.planes.data(), size / 2);
+    src = zstd_contexts.planes.data();
+  }
+
+  compressed.format = image.encoding + "; zstd compressed";
+  compressed.data.resize(sizeof(header) + ZSTD_compressBound(size));
+  std::memcpy(compressed.data.data(), &header, sizeof(header));
+
+  const size_t n = ZSTD_compressCCtx(zstd_contexts.compression, compressed.data.data() + sizeof(header),
+                                     compressed.data.size() - sizeof(header), src, size, level);
+  if (ZSTD_isError(n))
+  {
+    ROS_WARN_THROTTLE(10, "camera_aravis::encodeImage(): zstd failed: %s", ZSTD_getErrorName(n));
+    return false;
+  }
+
+  compressed.data.resize(sizeof(header) + n);
+  return true;
+}
+
+bool decodeZstd(const sensor_msgs::CompressedImage &compressed, const std::string &encoding, sensor_msgs::Image &image)
+{
+  ZstdHeader header;
+  if (compressed.data.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, compressed.data.data(), sizeof(header));
+
+  const size_t size = size_t(header.height) * header.step;
+  const uint8_t *frame = compressed.data.data() + sizeof(header);
+  const size_t frame_size = compressed.data.size() - sizeof(header);
+  if (header.magic != ZstdHeader::MAGIC || ZSTD_getFrameContentSize(frame, frame_size) != size)
+    return false;
+
+  image.header = compressed.header;
+  image.encoding = encoding;
+  image.height = header.height;
+  image.width = header.width;
+  image.step = header.step;
+  image.is_bigendian = false;
+  image.data.resize(size);
+
+  const bool planes = header.flags & ZstdHeader::FLAG_BYTE_PLANES;
+  if (planes)
+    zstd_contexts.planes.resize(size);
+  uint8_t *dst = planes ? zstd_contexts.planes.data() : image.data.data();
+
+  const size_t n = ZSTD_decompressDCtx(zstd_contexts.decompression, dst, size, frame, frame_size);
+  if (ZSTD_isError(n) || n != size)
+    return false;
+
+  if (planes)
+    mergeBytePlanes(dst, image.data.data(), size / 2);
+  return true;
+}
+
+#endif
+
+} // end anonymous namespace
+
+bool codecAvailable(const std::string &codec)
+{
+  if (codec == "jpeg" || codec == "png" || codec == "rvl")
+    return true;
+#ifdef CAMERA_ARAVIS_HAVE_ZSTD
+  if (codec == "zstd")
+    return true;
+#endif
+  return false;
+}
+
+bool encodeImage(const sensor_msgs::Image &image, const CodecParameters &params, sensor_msgs::CompressedImage &compressed)
+{
+  compressed.header = image.header;
+
+  const bool lossy = params.codec == "jpeg" &&
+                     (image.encoding == enc::MONO8 || image.encoding == enc::BGR8 || image.encoding == enc::RGB8);
+
+  if (lossy)
+    return encodeOpenCV(image, "jpeg", {cv::IMWRITE_JPEG_QUALITY, params.jpeg_quality}, compressed);
+
+  if (params.depth_codec == "rvl" && isDepth(image.encoding))
+    return encodeRvl(image, params.depth_scale, compressed);
+
+  if (params.lossless_codec == "png")
+    return encodeOpenCV(image, "png", {cv::IMWRITE_PNG_COMPRESSION, params.png_level}, compressed);
+
+#ifdef CAMERA_ARAVIS_HAVE_ZSTD
+  if (params.lossless_codec == "zstd")
+    return encodeZstd(image, params.zstd_level, compressed);
+#endif
+
+  ROS_WARN_STREAM_ONCE("camera_aravis::encodeImage(): codec " << params.lossless_codec << " is not available");
+  return false;
+}
+
+bool decodeImage(const sensor_msgs::CompressedImage &compressed, sensor_msgs::Image &image)
+{
+  // "<encoding>; <codec> compressed [<target>]"
+  const size_t separator = compressed.format.find("; ");
+  if (separator == std::string::npos)
+    return false;
+
+  const std::string encoding = compressed.format.substr(0, separator);
+  const std::string codec = compressed.format.substr(separator + 2, compressed.format.find(' ', separator + 2) - separator - 2);
+
+  if (codec == "jpeg" || codec == "png")
+    return decodeOpenCV(compressed, encoding, image);
+
+  if (codec == "rvl")
+    return decodeRvl(compressed, encoding, image);
+
+#ifdef CAMERA_ARAVIS_HAVE_ZSTD
+  if (codec == "zstd")
+    return decodeZstd(compressed, encoding, image);
+#endif
+
+  return false;
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,413 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/pixel_correction.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <algorithm> //std::min, std::max
+#include <chrono>
+#include <cmath> //std::sqrt, std::round
+#include <stdexcept>
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+// bits of single channel encoding, native images carry unpacked GenICam format (e.g. Mono12), 0 otherwise
+int singleChannelBits(const std::string &encoding)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  try
+  {
+    return enc::numChannels(encoding) == 1 ? enc::bitDepth(encoding) : 0;
+  }
+  catch (const std::runtime_error &)
+  {
+    const bool single = encoding.compare(0, 4, "Mono") == 0 || encoding.compare(0, 5, "Bayer") == 0;
+    const size_t digits_pos = encoding.find_first_of("0123456789");
+    if (!single || digits_pos == std::string::npos ||
+        encoding.find_first_not_of("0123456789", digits_pos) != std::string::npos)
+      return 0;
+    return std::stoi(encoding.substr(digits_pos));
+  }
+}
+
+// bytes per pixel of single channel 8 or 16 bit container with rows fitting its data, 0 otherwise
+size_t pixelSize(const sensor_msgs::Image &image)
+{
+  const int bits = singleChannelBits(image.encoding);
+  if (bits < 1 || bits > 16)
+    return 0;
+
+  const size_t pixel_size = bits <= 8 ? 1 : 2;
+  if (image.step < image.width * pixel_size || image.data.size() < size_t(image.height) * image.step)
+    return 0;
+  return pixel_size;
+}
+
+cv::Mat pointsToMat(const std::vector<cv::Point> &points)
+{
+  cv::Mat mat(points.size(), 2, CV_32SC1);
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    mat.at<int>(i, 0) = points[i].x;
+    mat.at<int>(i, 1) = points[i].y;
+  }
+  return mat;
+}
+
+std::vector<cv::Point> matToPoints(const cv::Mat &mat)
+{
+  std::vector<cv::Point> points;
+  if (mat.empty() || mat.cols != 2 || mat.type() != CV_32SC1)
+    return points;
+
+  for (int i = 0; i < mat.rows; ++i)
+    points.push_back(cv::Point(mat.at<int>(i, 0), mat.at<int>(i, 1)));
+  return points;
+}
+
+} // end anonymous namespace
+
+bool PixelCorrection::load(const std::string &path)
+{
+  cv::FileStorage fs(path, cv::FileStorage::READ);
+  if (!fs.isOpened())
+    return false;
+
+  cv::Mat dark, gain, hot_pixels, dead_pixels;
+  fs["dark"] >> dark;
+  fs["gain"] >> gain;
+  fs["hot_pixels"] >> hot_pixels;
+  fs["dead_pixels"] >> dead_pixels;
+
+  if (dark.empty() && gain.empty())
+  {
+    ROS_WARN("Pixel correction file %s has neither dark nor gain map", path.c_str());
+    return false;
+  }
+
+  if (!dark.empty() && !gain.empty() && (dark.rows != gain.rows || dark.cols != gain.cols))
+  {
+    ROS_WARN("Pixel correction file %s has dark and gain maps of different size", path.c_str());
+    return false;
+  }
+
+  if (!dark.empty())
+    dark.convertTo(dark, CV_16U);
+  if (!gain.empty())
+    gain.convertTo(gain, CV_16U, 1 << GAIN_FRACTION_BITS);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  dark_ = dark;
+  gain_ = gain;
+  hot_pixels_ = matToPoints(hot_pixels);
+  dead_pixels_ = matToPoints(dead_pixels);
+  ensureMaps(dark.empty() ? gain.rows : dark.rows, dark.empty() ? gain.cols : dark.cols);
+
+  ROS_INFO("Loaded %dx%d pixel correction from %s, %zu hot and %zu dead pixels", dark_.cols, dark_.rows,
+           path.c_str(), hot_pixels_.size(), dead_pixels_.size());
+  return true;
+}
+
+bool PixelCorrection::save(const std::string &path) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (dark_.empty())
+    return false;
+
+  cv::FileStorage fs(path, cv::FileStorage::WRITE);
+  if (!fs.isOpened())
+    return false;
+
+  cv::Mat gain;
+  gain_.convertTo(gain, CV_32F, 1.0 / (1 << GAIN_FRACTION_BITS));
+
+  fs << "dark" << dark_;
+  fs << "gain" << gain;
+  fs << "hot_pixels" << pointsToMat(hot_pixels_);
+  fs << "dead_pixels" << pointsToMat(dead_pixels_);
+  fs.release();
+  return true;
+}
+
+bool PixelCorrection::empty() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dark_.empty();
+}
+
+bool PixelCorrection::apply(const sensor_msgs::Image &in, sensor_msgs::Image &out, uint32_t max_value, bool bayer) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (dark_.empty() || !in.width)
+    return false;
+
+  if (dark_.rows != int(in.height) || dark_.cols != int(in.width))
+  {
+    ROS_WARN_ONCE("Pixel correction maps %dx%d don't match image %ux%u, not applied",
+                  dark_.cols, dark_.rows, in.width, in.height);
+    return false;
+  }
+
+  out.header = in.header;
+  out.height = in.height;
+  out.width = in.width;
+  out.encoding = in.encoding;
+  out.is_bigendian = in.is_bigendian;
+  out.step = in.step;
+  out.data.resize(in.data.size());
+
+  switch (pixelSize(in))
+  {
+    case 1:
+      applyRows<uint8_t>(in, out, std::min<uint32_t>(max_value, 0xFF), bayer);
+      return true;
+    case 2:
+      applyRows<uint16_t>(in, out, std::min<uint32_t>(max_value, 0xFFFF), bayer);
+      return true;
+    default:
+      ROS_WARN_ONCE("Pixel correction supports only single channel 8 or 16 bit images, not applied");
+      return false;
+  }
+}
+
+template<typename T>
+void PixelCorrection::applyRows(const sensor_msgs::Image &in, sensor_msgs::Image &out, uint32_t max_value, bool bayer) const
+{
+  const uint32_t ROUNDING = 1u << (GAIN_FRACTION_BITS - 1);
+  const int width = in.width;
+
+  // dark subtraction, gain and clamping fused in single pass, plain loop over
+  // contiguous rows is auto-vectorized by compiler, rows are processed in parallel
+  cv::parallel_for_(cv::Range(0, in.height), [&](const cv::Range &rows) {
+    for (int r = rows.start; r < rows.end; ++r)
+    {
+      const T *from = reinterpret_cast<const T*>(in.data.data() + r * in.step);
+      T *to = reinterpret_cast<T*>(out.data.data() + r * out.step);
+      const uint16_t *dark = dark_.ptr<uint16_t>(r);
+      const uint16_t *gain = gain_.ptr<uint16_t>(r);
+
+      for (int x = 0; x < width; ++x)
+      {
+        uint32_t value = from[x] > dark[x] ? from[x] - dark[x] : 0;
+        value = (value * gain[x] + ROUNDING) >> GAIN_FRACTION_BITS;
+        to[x] = static_cast<T>(std::min(value, max_value));
+      }
+    }
+  });
+
+  // defects are sparse, replace by horizontal neighbours of same color
+  const int step = bayer ? 2 : 1;
+  for (const std::vector<cv::Point> *defects : {&hot_pixels_, &dead_pixels_})
+  {
+    for (const cv::Point &p : *defects)
+    {
+      if (p.x < 0 || p.y < 0 || p.x >= width || p.y >= int(in.height))
+        continue;
+
+      // at row edges only the existing neighbour is used
+      const bool has_left = p.x - step >= 0;
+      const bool has_right = p.x + step < width;
+      if (!has_left && !has_right)
+        continue;
+
+      T *row = reinterpret_cast<T*>(out.data.data() + p.y * out.step);
+      const uint32_t left = has_left ? row[p.x - step] : row[p.x + step];
+      const uint32_t right = has_right ? row[p.x + step] : left;
+      row[p.x] = static_cast<T>((left + right + 1) / 2);
+    }
+  }
+}
+
+void PixelCorrection::startCapture(CaptureKind kind, size_t n_frames)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  capturing_ = true;
+  capture_kind_ = kind;
+  capture_frames_ = std::max<size_t>(n_frames, 1);
+  captured_frames_ = 0;
+  capture_sum_.clear();
+}
+
+bool PixelCorrection::addCaptureFrame(const sensor_msgs::Image &image)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!capturing_)
+    return false;
+
+  const size_t pixel_size = pixelSize(image);
+  if (!pixel_size)
+  {
+    ROS_WARN_ONCE("Pixel correction capture supports only single channel 8 or 16 bit images");
+    return true;
+  }
+
+  if (capture_sum_.empty() || capture_rows_ != int(image.height) || capture_cols_ != int(image.width))
+  {
+    // first frame or size changed, (re)start averaging
+    capture_rows_ = image.height;
+    capture_cols_ = image.width;
+    capture_sum_.assign(size_t(capture_rows_) * capture_cols_, 0.0);
+    captured_frames_ = 0;
+  }
+
+  for (int r = 0; r < capture_rows_; ++r)
+  {
+    const uint8_t *row = image.data.data() + r * image.step;
+    double *sum = capture_sum_.data() + size_t(r) * capture_cols_;
+    if (pixel_size == 1)
+      for (int x = 0; x < capture_cols_; ++x)
+        sum[x] += row[x];
+    else
+      for (int x = 0; x < capture_cols_; ++x)
+        sum[x] += reinterpret_cast<const uint16_t*>(row)[x];
+  }
+
+  if (++captured_frames_ >= capture_frames_)
+  {
+    finishCapture();
+    capturing_ = false;
+    capture_done_.notify_all();
+  }
+
+  return true;
+}
+
+bool PixelCorrection::capturing() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return capturing_;
+}
+
+bool PixelCorrection::waitCapture(double timeout_s)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  const bool done = capture_done_.wait_for(lock, std::chrono::duration<double>(timeout_s),
+                                           [this] { return !capturing_; });
+  capturing_ = false;
+  return done;
+}
+
+void PixelCorrection::finishCapture()
+{
+  const size_t n_pixels = capture_sum_.size();
+  const double n_frames = captured_frames_;
+
+  ensureMaps(capture_rows_, capture_cols_);
+
+  if (capture_kind_ == CAPTURE_DARK)
+  {
+    double mean = 0.0, square_mean = 0.0;
+    for (size_t i = 0; i < n_pixels; ++i)
+    {
+      const double value = capture_sum_[i] / n_frames;
+      mean += value;
+      square_mean += value * value;
+    }
+    mean /= n_pixels;
+    const double sigma = std::sqrt(std::max(square_mean / n_pixels - mean * mean, 0.0));
+    const double hot_threshold = mean + HOT_PIXEL_SIGMA * std::max(sigma, 1.0);
+
+    hot_pixels_.clear();
+    for (int r = 0; r < capture_rows_; ++r)
+    {
+      uint16_t *dark = dark_.ptr<uint16_t>(r);
+      const double *sum = capture_sum_.data() + size_t(r) * capture_cols_;
+      for (int x = 0; x < capture_cols_; ++x)
+      {
+        const double value = sum[x] / n_frames;
+        dark[x] = static_cast<uint16_t>(std::min(std::round(value), 65535.0));
+        if (value > hot_threshold)
+          hot_pixels_.push_back(cv::Point(x, r));
+      }
+    }
+
+    ROS_INFO("Captured dark map from %zu frames, mean %.1f, %zu hot pixels", captured_frames_, mean, hot_pixels_.size());
+    return;
+  }
+
+  // flat, response above dark
+  double mean = 0.0;
+  for (int r = 0; r < capture_rows_; ++r)
+  {
+    const uint16_t *dark = dark_.ptr<uint16_t>(r);
+    const double *sum = capture_sum_.data() + size_t(r) * capture_cols_;
+    for (int x = 0; x < capture_cols_; ++x)
+      mean += std::max(sum[x] / n_frames - dark[x], 0.0);
+  }
+  mean /= n_pixels;
+
+  if (mean <= 0.0)
+  {
+    ROS_WARN("Flat frame is not brighter than dark frame, flat map not updated");
+    return;
+  }
+
+  const double unit_gain = 1 << GAIN_FRACTION_BITS;
+  dead_pixels_.clear();
+  for (int r = 0; r < capture_rows_; ++r)
+  {
+    const uint16_t *dark = dark_.ptr<uint16_t>(r);
+    uint16_t *gain = gain_.ptr<uint16_t>(r);
+    const double *sum = capture_sum_.data() + size_t(r) * capture_cols_;
+    for (int x = 0; x < capture_cols_; ++x)
+    {
+      const double response = std::max(sum[x] / n_frames - dark[x], 0.0) / mean;
+      if (response < DEAD_PIXEL_LOW || response > DEAD_PIXEL_HIGH)
+      {
+        dead_pixels_.push_back(cv::Point(x, r));
+        gain[x] = unit_gain;
+      }
+      else
+        gain[x] = static_cast<uint16_t>(std::min(std::round(unit_gain / response), 65535.0));
+    }
+  }
+
+  ROS_INFO("Captured flat map from %zu frames, mean response %.1f, %zu dead pixels",
+           captured_frames_, mean, dead_pixels_.size());
+}
+
+void PixelCorrection::ensureMaps(int rows, int cols)
+{
+  if (dark_.rows != rows || dark_.cols != cols || dark_.empty())
+    dark_ = cv::Mat::zeros(rows, cols, CV_16UC1);
+
+  if (gain_.rows != rows || gain_.cols != cols || gain_.empty())
+  {
+    gain_ = cv::Mat(rows, cols, CV_16UC1);
+    for (int r = 0; r < rows; ++r)
+      std::fill(gain_.ptr<uint16_t>(r), gain_.ptr<uint16_t>(r) + cols, uint16_t(1 << GAIN_FRACTION_BITS));
+  }
+}
+
+} // end namespace camera_aravis
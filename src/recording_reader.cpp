@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/recording_reader.h>
+#include <camera_aravis/conversion_utils.h>
+
+#include <ros/ros.h>
+#include <opencv2/core/core.hpp>
+
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace camera_aravis
+{
+
+RecordingReader::~RecordingReader()
+{
+  close();
+}
+
+bool RecordingReader::open(const std::string &directory)
+{
+  close();
+
+  if (!readMetadata(directory + "/recording.yaml"))
+  {
+    ROS_ERROR("Recording %s has no readable recording.yaml", directory.c_str());
+    return false;
+  }
+
+  const std::string data_path = directory + "/frames.raw";
+  const int fd = ::open(data_path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    ROS_ERROR("Recording %s has no readable frames.raw", directory.c_str());
+    if (fd >= 0)
+      ::close(fd);
+    return false;
+  }
+
+  data_size_ = st.st_size;
+  if (data_size_ > 0)
+  {
+    void *data = mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      ROS_ERROR("Can't map %s", data_path.c_str());
+      ::close(fd);
+      data_size_ = 0;
+      return false;
+    }
+    data_ = static_cast<const uint8_t*>(data);
+    madvise(data, data_size_, MADV_SEQUENTIAL);
+  }
+  // mapping stays valid after closing descriptor
+  ::close(fd);
+
+  std::ifstream index(directory + "/index.bin", std::ios::binary);
+  FrameRecord record;
+  while (index.read(reinterpret_cast<char*>(&record), sizeof(record)))
+  {
+    // index of interrupted recording may point past data on disk
+    if (record.offset + record.size > data_size_ || record.substream >= substreams_.size())
+    {
+      ROS_WARN("Recording %s is truncated after %zu frames", directory.c_str(), records_.size());
+      break;
+    }
+    records_.push_back(record);
+  }
+  return true;
+}
+
+void RecordingReader::close()
+{
+  if (data_)
+    munmap(const_cast<uint8_t*>(data_), data_size_);
+  data_ = nullptr;
+  data_size_ = 0;
+  records_.clear();
+  substreams_.clear();
+}
+
+sensor_msgs::ImagePtr RecordingReader::nativeImage(size_t i) const
+{
+  const FrameRecord &record = records_[i];
+  const RecordedSubstream &substream = substreams_[record.substream];
+
+  sensor_msgs::ImagePtr msg(new sensor_msgs::Image);
+  msg->header.stamp.fromNSec(record.stamp_ns);
+  msg->header.seq = record.frame_id;
+  msg->header.frame_id = substream.frame_id;
+  msg->width = record.width;
+  msg->height = record.height;
+  msg->step = record.step;
+  msg->encoding = substream.pixel_format;
+  msg->data.assign(payload(i), payload(i) + record.size);
+  return msg;
+}
+
+sensor_msgs::ImagePtr RecordingReader::image(size_t i) const
+{
+  const ConversionFunction convert = getConversion(substreams_[records_[i].substream].pixel_format);
+  if (!convert)
+    return sensor_msgs::ImagePtr();
+
+  sensor_msgs::ImagePtr in = nativeImage(i);
+  sensor_msgs::ImagePtr out(new sensor_msgs::Image);
+  convert(in, out);
+  return out;
+}
+
+bool RecordingReader::readMetadata(const std::string &path)
+{
+  cv::FileStorage fs(path, cv::FileStorage::READ);
+  if (!fs.isOpened())
+    return false;
+
+  const cv::FileNode substreams = fs["substreams"];
+  for (size_t i = 0; i < substreams.size(); ++i)
+  {
+    RecordedSubstream substream;
+    int bits_per_pixel = 0;
+    substreams[i]["name"] >> substream.name;
+    substreams[i]["frame_id"] >> substream.frame_id;
+    substreams[i]["pixel_format"] >> substream.pixel_format;
+    substreams[i]["bits_per_pixel"] >> bits_per_pixel;
+    substream.bits_per_pixel = bits_per_pixel;
+    substreams_.push_back(substream);
+  }
+  return !substreams_.empty();
+}
+
+} // end namespace camera_aravis
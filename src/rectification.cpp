@@ -0,0 +1,181 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/rectification.h>
+#include <camera_aravis/conversion_utils.h> //filterableCvType
+
+#include <ros/ros.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <opencv2/calib3d.hpp> //cv::fisheye
+#include <opencv2/imgproc.hpp> //cv::initUndistortRectifyMap, cv::remap
+
+#include <algorithm> //std::min, std::max
+
+namespace camera_aravis
+{
+
+bool Rectifier::update(const sensor_msgs::CameraInfo &info, uint32_t width, uint32_t height,
+                       uint32_t x_offset, uint32_t y_offset)
+{
+  if (sameCalibration(info) && size_ == cv::Size(width, height) && x_offset_ == x_offset && y_offset_ == y_offset)
+    return valid_;
+
+  info_ = info;
+  size_ = cv::Size(width, height);
+  x_offset_ = x_offset;
+  y_offset_ = y_offset;
+  valid_ = false;
+  map_xy_.release();
+  map_fraction_.release();
+
+  const bool equidistant = info.distortion_model == "equidistant";
+  if (info.K[0] == 0.0 || info.P[0] == 0.0 || !width || !height)
+    return false;
+
+  if (!equidistant && info.distortion_model != "plumb_bob" && info.distortion_model != "rational_polynomial")
+  {
+    ROS_WARN_STREAM("Rectification: unsupported distortion model " << info.distortion_model);
+    return false;
+  }
+
+  if (equidistant && info.D.size() != 4)
+  {
+    ROS_WARN("Rectification: equidistant model needs 4 distortion coefficients, got %zu", info.D.size());
+    return false;
+  }
+
+  // calibrated camera matrices adapted to offset and binning of actual image (as image_geometry does)
+  cv::Mat K = cv::Mat(3, 3, CV_64FC1, const_cast<double*>(info.K.data())).clone();
+  cv::Mat P = cv::Mat(3, 4, CV_64FC1, const_cast<double*>(info.P.data())).clone();
+  cv::Mat R = cv::Mat(3, 3, CV_64FC1, const_cast<double*>(info.R.data())).clone();
+  cv::Mat D = info.D.empty() ? cv::Mat::zeros(1, 5, CV_64FC1) :
+                               cv::Mat(1, info.D.size(), CV_64FC1, const_cast<double*>(info.D.data())).clone();
+
+  const double binning_x = std::max<uint32_t>(info.binning_x, 1);
+  const double binning_y = std::max<uint32_t>(info.binning_y, 1);
+
+  K.at<double>(0, 2) -= x_offset;
+  K.at<double>(1, 2) -= y_offset;
+  P.at<double>(0, 2) -= x_offset;
+  P.at<double>(1, 2) -= y_offset;
+  for (int c = 0; c < 3; ++c)
+  {
+    K.at<double>(0, c) /= binning_x;
+    K.at<double>(1, c) /= binning_y;
+  }
+  for (int c = 0; c < 4; ++c)
+  {
+    P.at<double>(0, c) /= binning_x;
+    P.at<double>(1, c) /= binning_y;
+  }
+
+  // fixed point tables, 16 bit integer coordinates and interpolation table index
+  if (equidistant)
+    cv::fisheye::initUndistortRectifyMap(K, D, R, P, size_, CV_16SC2, map_xy_, map_fraction_);
+  else
+    cv::initUndistortRectifyMap(K, D, R, P, size_, CV_16SC2, map_xy_, map_fraction_);
+
+  ROS_INFO("Rectification: built %dx%d remap tables (%s)", size_.width, size_.height, info.distortion_model.c_str());
+  valid_ = true;
+  return true;
+}
+
+void Rectifier::rectify(const sensor_msgs::ImagePtr &in, sensor_msgs::ImagePtr &out) const
+{
+  if (!in)
+  {
+    ROS_WARN("camera_aravis::Rectifier::rectify(): no input image given.");
+    out.reset();
+    return;
+  }
+
+  const int type = filterableCvType(in->encoding);
+
+  if (type < 0)
+  {
+    ROS_WARN_STREAM_ONCE("camera_aravis::Rectifier::rectify(): can't rectify encoding " << in->encoding);
+    out.reset();
+    return;
+  }
+
+  if (!valid_ || int(in->width) != size_.width || int(in->height) != size_.height)
+  {
+    out.reset();
+    return;
+  }
+
+  if (!out)
+  {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::Rectifier::rectify(): no output image given. Reserved a new one.");
+  }
+
+  const size_t pixel_size = sensor_msgs::image_encodings::bitDepth(in->encoding) / 8 *
+                            sensor_msgs::image_encodings::numChannels(in->encoding);
+
+  out->header = in->header;
+  out->height = in->height;
+  out->width = in->width;
+  out->encoding = in->encoding;
+  out->is_bigendian = in->is_bigendian;
+  out->step = in->width * pixel_size;
+  out->data.resize(out->height * out->step);
+
+  const cv::Mat src(in->height, in->width, type, in->data.data(), in->step);
+  cv::Mat dst(out->height, out->width, type, out->data.data(), out->step);
+
+  // bands of output rows in parallel, remap of band runs in single thread on its slice of tables
+  const int n_bands = (size_.height + BAND_ROWS - 1) / BAND_ROWS;
+  cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range &bands) {
+    for (int b = bands.start; b < bands.end; ++b)
+    {
+      const cv::Rect band(0, b * BAND_ROWS, size_.width, std::min(BAND_ROWS, size_.height - b * BAND_ROWS));
+      cv::Mat dst_band = dst(band);
+      cv::remap(src, dst_band, map_xy_(band), map_fraction_(band), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    }
+  });
+}
+
+sensor_msgs::CameraInfoPtr Rectifier::rectifiedCameraInfo(const sensor_msgs::CameraInfo &info)
+{
+  sensor_msgs::CameraInfoPtr rectified(new sensor_msgs::CameraInfo(info));
+
+  std::fill(rectified->D.begin(), rectified->D.end(), 0.0);
+  rectified->R = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+      rectified->K[r * 3 + c] = info.P[r * 4 + c];
+
+  return rectified;
+}
+
+bool Rectifier::sameCalibration(const sensor_msgs::CameraInfo &info) const
+{
+  return info.distortion_model == info_.distortion_model && info.D == info_.D && info.K == info_.K &&
+         info.R == info_.R && info.P == info_.P && info.binning_x == info_.binning_x &&
+         info.binning_y == info_.binning_y;
+}
+
+} // end namespace camera_aravis
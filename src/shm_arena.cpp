@@ -0,0 +1,262 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/shm_arena.h>
+
+#include <ros/ros.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring> //strerror
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+const size_t PAGE_ALIGNMENT = 4096;
+
+size_t alignUp(size_t value)
+{
+  return (value + PAGE_ALIGNMENT - 1) / PAGE_ALIGNMENT * PAGE_ALIGNMENT;
+}
+
+ShmSlot *slotArray(void *base)
+{
+  return reinterpret_cast<ShmSlot *>(static_cast<uint8_t *>(base) + sizeof(ShmArenaHeader));
+}
+
+} // end anonymous namespace
+
+std::unique_ptr<ShmArena> ShmArena::create(const std::string &name, uint32_t n_slots, size_t slot_size)
+{
+  if (n_slots == 0 || n_slots >= WRITER_BIT || slot_size == 0)
+    return nullptr;
+
+  slot_size = alignUp(slot_size);
+  const size_t data_offset = alignUp(sizeof(ShmArenaHeader) + n_slots * sizeof(ShmSlot));
+  const size_t length = data_offset + n_slots * slot_size;
+
+  // stale object of crashed publisher with the same name
+  shm_unlink(name.c_str());
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+  if (fd < 0)
+  {
+    ROS_ERROR("Failed to create shared memory arena %s: %s", name.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, length) == 0)
+    base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  const int err = errno;
+  close(fd);
+
+  if (base == MAP_FAILED)
+  {
+    ROS_ERROR("Failed to map %zu bytes of shared memory arena %s: %s", length, name.c_str(), strerror(err));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  ShmSlot *slots = slotArray(base);
+  for (uint32_t i = 0; i < n_slots; ++i)
+  {
+    slots[i].refs.store(0, std::memory_order_relaxed);
+    slots[i].generation.store(0, std::memory_order_relaxed);
+    slots[i].size = 0;
+  }
+
+  ShmArenaHeader *header = static_cast<ShmArenaHeader *>(base);
+  header->version = VERSION;
+  header->n_slots = n_slots;
+  header->reserved = 0;
+  header->slot_size = slot_size;
+  header->data_offset = data_offset;
+  // readers validate magic last
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = MAGIC;
+
+  return std::unique_ptr<ShmArena>(new ShmArena(name, base, length, true));
+}
+
+std::unique_ptr<ShmArena> ShmArena::open(const std::string &name)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmArenaHeader))
+    base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED)
+    return nullptr;
+
+  const size_t length = st.st_size;
+  const ShmArenaHeader *header = static_cast<const ShmArenaHeader *>(base);
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  const bool valid = header->magic == MAGIC && header->version == VERSION &&
+                     header->n_slots > 0 && header->n_slots < WRITER_BIT &&
+                     header->data_offset >= sizeof(ShmArenaHeader) + header->n_slots * sizeof(ShmSlot) &&
+                     header->data_offset <= length &&
+                     header->slot_size <= (length - header->data_offset) / header->n_slots;
+
+  if (!valid)
+  {
+    ROS_ERROR("Shared memory object %s is not a valid image arena", name.c_str());
+    munmap(base, length);
+    return nullptr;
+  }
+
+  return std::unique_ptr<ShmArena>(new ShmArena(name, base, length, false));
+}
+
+ShmArena::ShmArena(const std::string &name, void *base, size_t length, bool owner) :
+  name_(name), base_(base), length_(length), owner_(owner), header_(static_cast<ShmArenaHeader *>(base))
+{
+}
+
+ShmArena::~ShmArena()
+{
+  // readers keep their mappings, the object is freed when the last one unmaps
+  if (owner_)
+    shm_unlink(name_.c_str());
+  munmap(base_, length_);
+}
+
+ShmSlot &ShmArena::slot(uint32_t index) const
+{
+  return slotArray(base_)[index];
+}
+
+int32_t ShmArena::beginWrite(uint32_t &generation)
+{
+  const uint32_t n = header_->n_slots;
+  for (uint32_t k = 0; k < n; ++k)
+  {
+    const uint32_t index = (next_slot_ + k) % n;
+    uint32_t expected = 0;
+
+    // only slots without readers, acquire pairs with release of the last reader
+    if (!slot(index).refs.compare_exchange_strong(expected, WRITER_BIT, std::memory_order_acq_rel))
+      continue;
+
+    generation = slot(index).generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    next_slot_ = (index + 1) % n;
+    return index;
+  }
+  return -1;
+}
+
+uint8_t *ShmArena::slotData(uint32_t index)
+{
+  return static_cast<uint8_t *>(base_) + header_->data_offset + index * header_->slot_size;
+}
+
+void ShmArena::endWrite(uint32_t index, size_t size)
+{
+  slot(index).size = size;
+  slot(index).refs.fetch_and(~WRITER_BIT, std::memory_order_release);
+}
+
+bool ShmArena::acquire(uint32_t index, uint32_t generation)
+{
+  if (index >= header_->n_slots)
+    return false;
+
+  ShmSlot &s = slot(index);
+  const uint32_t refs = s.refs.fetch_add(1, std::memory_order_acquire);
+
+  // while pinned the publisher can't claim the slot, so generation is stable
+  if ((refs & WRITER_BIT) || s.generation.load(std::memory_order_relaxed) != generation)
+  {
+    s.refs.fetch_sub(1, std::memory_order_release);
+    return false;
+  }
+  return true;
+}
+
+void ShmArena::release(uint32_t index)
+{
+  slot(index).refs.fetch_sub(1, std::memory_order_release);
+}
+
+const uint8_t *ShmArena::slotData(uint32_t index) const
+{
+  return static_cast<const uint8_t *>(base_) + header_->data_offset + index * header_->slot_size;
+}
+
+size_t ShmArena::dataSize(uint32_t index) const
+{
+  return slot(index).size;
+}
+
+std::shared_ptr<const ShmLease> ShmReader::acquire(const ShmImage &image)
+{
+  std::shared_ptr<ShmArena> arena;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!arena_ || arena_->name() != image.arena)
+    {
+      if (image.arena == unreachable_)
+        return nullptr;
+
+      // leases of the previous arena keep it mapped until released
+      std::unique_ptr<ShmArena> opened = ShmArena::open(image.arena);
+      if (!opened)
+      {
+        ROS_WARN("Failed to map shared memory arena %s, publisher on another host?", image.arena.c_str());
+        unreachable_ = image.arena;
+        return nullptr;
+      }
+      arena_ = std::move(opened);
+    }
+    arena = arena_;
+  }
+
+  if (!arena->acquire(image.slot, image.generation))
+    return nullptr;
+
+  if (image.size > arena->dataSize(image.slot))
+  {
+    arena->release(image.slot);
+    return nullptr;
+  }
+
+  return std::make_shared<ShmLease>(arena, image.slot, image.size);
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,131 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/shm_transport.h>
+
+#include <pluginlib/class_list_macros.h>
+
+#include <unistd.h> //getpid
+
+#include <cstring> //memcpy
+
+namespace camera_aravis
+{
+
+bool ShmPublisher::initArena(size_t slot_size) const
+{
+  // POSIX shm names take a single leading slash
+  std::string name = "/camera_aravis" + getTopic();
+  for (size_t i = 1; i < name.size(); ++i)
+    if (name[i] == '/')
+      name[i] = '_';
+
+  // unique per publisher instance, subscribers still reading the old arena keep it mapped
+  name += "_" + std::to_string(getpid()) + "_" + std::to_string(arena_count_++);
+
+  int slots = nh().param("shm_slots", 8);
+  if (slots < 2)
+    slots = 2;
+
+  arena_.reset();
+  arena_ = ShmArena::create(name, slots, slot_size);
+
+  if (arena_)
+    ROS_INFO("Publishing %s through shared memory arena %s with %d slots of %zu bytes",
+             getTopic().c_str(), name.c_str(), slots, arena_->slotSize());
+
+  return arena_ != nullptr;
+}
+
+void ShmPublisher::publish(const sensor_msgs::Image &image, const PublishFn &publish_fn) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const size_t size = image.data.size();
+
+  if ((!arena_ || arena_->slotSize() < size) && !initArena(size))
+  {
+    ROS_ERROR_THROTTLE(1.0, "No shared memory arena for %s, frame dropped", getTopic().c_str());
+    return;
+  }
+
+  uint32_t generation = 0;
+  const int32_t slot = arena_->beginWrite(generation);
+
+  if (slot < 0)
+  {
+    ROS_WARN_THROTTLE(1.0, "All %u shared memory slots of %s are held by readers, frame dropped",
+                      arena_->slots(), getTopic().c_str());
+    return;
+  }
+
+  if (size)
+    std::memcpy(arena_->slotData(slot), image.data.data(), size);
+  arena_->endWrite(slot, size);
+
+  ShmImage msg;
+  msg.header = image.header;
+  msg.arena = arena_->name();
+  msg.slot = slot;
+  msg.generation = generation;
+  msg.height = image.height;
+  msg.width = image.width;
+  msg.encoding = image.encoding;
+  msg.is_bigendian = image.is_bigendian;
+  msg.step = image.step;
+  msg.size = size;
+
+  publish_fn(msg);
+}
+
+void ShmSubscriber::internalCallback(const ShmImage::ConstPtr &message, const Callback &user_cb)
+{
+  std::shared_ptr<const ShmLease> lease = reader_.acquire(*message);
+
+  if (!lease)
+  {
+    ROS_WARN_THROTTLE(1.0, "Shared memory frame of %s was recycled or is not reachable, frame dropped",
+                      getTopic().c_str());
+    return;
+  }
+
+  sensor_msgs::ImagePtr image(new sensor_msgs::Image);
+  image->header = message->header;
+  image->height = message->height;
+  image->width = message->width;
+  image->encoding = message->encoding;
+  image->is_bigendian = message->is_bigendian;
+  image->step = message->step;
+  image->data.assign(lease->data(), lease->data() + lease->size());
+
+  // slot goes back to the publisher before user callback runs
+  lease.reset();
+
+  user_cb(image);
+}
+
+} // end namespace camera_aravis
+
+PLUGINLIB_EXPORT_CLASS(camera_aravis::ShmPublisher, image_transport::PublisherPlugin)
+PLUGINLIB_EXPORT_CLASS(camera_aravis::ShmSubscriber, image_transport::SubscriberPlugin)
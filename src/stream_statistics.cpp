@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/stream_statistics.h>
+
+namespace camera_aravis
+{
+
+void SubstreamStatistics::addPublished(uint64_t conversion_ns, uint64_t latency_ns)
+{
+  n_published_.fetch_add(1, std::memory_order_relaxed);
+  conversion_ns_.fetch_add(conversion_ns, std::memory_order_relaxed);
+  publish_latency_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+
+  uint64_t max_ns = publish_latency_max_ns_.load(std::memory_order_relaxed);
+  while (latency_ns > max_ns &&
+         !publish_latency_max_ns_.compare_exchange_weak(max_ns, latency_ns, std::memory_order_relaxed))
+    ;
+}
+
+SubstreamStatisticsSample SubstreamStatistics::sample()
+{
+  SubstreamStatisticsSample s;
+  s.n_published = n_published_.load(std::memory_order_relaxed);
+  s.n_queue_drops = n_queue_drops_.load(std::memory_order_relaxed);
+  s.conversion_ns = conversion_ns_.load(std::memory_order_relaxed);
+  s.publish_latency_ns = publish_latency_ns_.load(std::memory_order_relaxed);
+  s.publish_latency_max_ns = publish_latency_max_ns_.exchange(0, std::memory_order_relaxed);
+  return s;
+}
+
+uint64_t FrameIdTracker::update(uint64_t frame_id)
+{
+  if (frame_id > MAX_ID_16BIT)
+    wide_ids_ = true;
+
+  if (!has_last_)
+  {
+    has_last_ = true;
+    last_ = frame_id;
+    return 0;
+  }
+
+  uint64_t gap = 0;
+
+  if (frame_id > last_)
+    gap = frame_id - last_ - 1;
+  else if (!wide_ids_ && frame_id < WRAP_WINDOW && last_ > MAX_ID_16BIT - WRAP_WINDOW)
+    gap = (MAX_ID_16BIT - last_) + (frame_id ? frame_id - 1 : 0); // 16 bit wraparound skips 0
+  // else duplicate or device counter reset, nothing to report
+
+  last_ = frame_id;
+  return gap;
+}
+
+const char* frameLossReasonName(FrameLossReason reason)
+{
+  switch(reason)
+  {
+    case LOSS_TIMEOUT:
+      return "timeout";
+    case LOSS_MISSING_PACKETS:
+      return "missing packets";
+    case LOSS_SIZE_MISMATCH:
+      return "size mismatch";
+    case LOSS_OTHER:
+      return "other failure";
+    case LOSS_GAP:
+      return "frame id gap";
+    case LOSS_QUEUE_DROP:
+      return "queue drop";
+    case LOSS_NO_SUBSCRIBER:
+      return "no subscriber";
+    default:
+      return "unknown";
+  }
+}
+
+uint64_t FrameLossStatistics::addReceived(uint64_t frame_id, bool track_id)
+{
+  n_received_.fetch_add(1, std::memory_order_relaxed);
+
+  const uint64_t gap = track_id ? id_tracker_.update(frame_id) : 0;
+
+  if (gap)
+    addLost(LOSS_GAP, gap);
+
+  return gap;
+}
+
+void FrameLossStatistics::addDelivered()
+{
+  n_delivered_.fetch_add(1, std::memory_order_relaxed);
+  burst_length_ = 0;
+}
+
+void FrameLossStatistics::addLost(FrameLossReason reason, uint64_t n)
+{
+  n_lost_[reason].fetch_add(n, std::memory_order_relaxed);
+
+  // queue drops and unsubscribed frames are not lost on the receive path
+  if (reason != LOSS_QUEUE_DROP && reason != LOSS_NO_SUBSCRIBER)
+    extendBurst(n);
+}
+
+void FrameLossStatistics::extendBurst(uint64_t n)
+{
+  if (!burst_length_)
+    n_bursts_.fetch_add(1, std::memory_order_relaxed);
+
+  burst_length_ += n;
+
+  uint64_t max_burst = max_burst_.load(std::memory_order_relaxed);
+  while (burst_length_ > max_burst &&
+         !max_burst_.compare_exchange_weak(max_burst, burst_length_, std::memory_order_relaxed))
+    ;
+}
+
+FrameLossSample FrameLossStatistics::sample()
+{
+  FrameLossSample s;
+  s.n_received = n_received_.load(std::memory_order_relaxed);
+  s.n_delivered = n_delivered_.load(std::memory_order_relaxed);
+  for(size_t i = 0; i < s.n_lost.size(); ++i)
+    s.n_lost[i] = n_lost_[i].load(std::memory_order_relaxed);
+  s.n_bursts = n_bursts_.load(std::memory_order_relaxed);
+  s.max_burst = max_burst_.exchange(0, std::memory_order_relaxed);
+  return s;
+}
+
+} // end namespace camera_aravis
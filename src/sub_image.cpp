@@ -0,0 +1,80 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/sub_image.h>
+
+#include <sensor_msgs/image_encodings.h>
+
+#include <algorithm> //std::min
+#include <stdexcept> //std::runtime_error
+
+namespace camera_aravis
+{
+
+SubImage::Ptr cropImage(const sensor_msgs::ImageConstPtr &image,
+                        uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (!image)
+    return SubImage::Ptr();
+
+  size_t pixel_size = 0;
+  try
+  {
+    pixel_size = enc::bitDepth(image->encoding) / 8 * enc::numChannels(image->encoding);
+  }
+  catch (const std::runtime_error &)
+  {
+    // unknown encoding, pixel size can't be derived
+  }
+
+  if (!pixel_size)
+    return SubImage::Ptr();
+
+  // keep color filter / chroma pattern of region same as of full image
+  if (enc::isBayer(image->encoding) || image->encoding == enc::YUV422)
+  {
+    x_offset &= ~1u;
+    y_offset &= ~1u;
+  }
+
+  if (x_offset >= image->width || y_offset >= image->height)
+    return SubImage::Ptr();
+
+  SubImage::Ptr sub(new SubImage);
+  sub->parent = image;
+  sub->x_offset = x_offset;
+  sub->y_offset = y_offset;
+  sub->width = std::min(width, image->width - x_offset);
+  sub->height = std::min(height, image->height - y_offset);
+  sub->step = sub->width * pixel_size;
+
+  if (!sub->width || !sub->height)
+    return SubImage::Ptr();
+
+  return sub;
+}
+
+} // end namespace camera_aravis
@@ -0,0 +1,316 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/tone_mapping.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <opencv2/core/core.hpp> //cv::parallel_for_
+
+#include <algorithm> //std::min, std::max
+#include <cmath> //std::pow, std::abs
+#include <map>
+
+namespace camera_aravis
+{
+
+namespace
+{
+
+// 8 bit counterpart of 16 bit unsigned encoding, empty if there is none
+std::string eightBitEncoding(const std::string &encoding)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (encoding == enc::YUV422 || encoding.find("16SC") != std::string::npos || enc::bitDepth(encoding) != 16)
+    return "";
+
+  // mono16 -> mono8, bayer_rggb16 -> bayer_rggb8, 16UC1 -> 8UC1
+  std::string eight_bit = encoding;
+  return eight_bit.replace(eight_bit.find("16"), 2, "8");
+}
+
+struct FusedFormat
+{
+  bool gige_packed;
+  std::string encoding;
+};
+
+const std::map<std::string, FusedFormat> FUSED_FORMATS =
+{
+  { "Mono12p", { false, sensor_msgs::image_encodings::MONO8 } },
+  { "RGB12p", { false, sensor_msgs::image_encodings::RGB8 } },
+  { "RGBa12p", { false, sensor_msgs::image_encodings::RGBA8 } },
+  { "BGR12p", { false, sensor_msgs::image_encodings::BGR8 } },
+  { "BGRa12p", { false, sensor_msgs::image_encodings::BGRA8 } },
+  { "BayerRG12p", { false, sensor_msgs::image_encodings::BAYER_RGGB8 } },
+  { "BayerBG12p", { false, sensor_msgs::image_encodings::BAYER_BGGR8 } },
+  { "BayerGB12p", { false, sensor_msgs::image_encodings::BAYER_GBRG8 } },
+  { "BayerGR12p", { false, sensor_msgs::image_encodings::BAYER_GRBG8 } },
+  { "Mono12Packed", { true, sensor_msgs::image_encodings::MONO8 } },
+  { "BayerRG12Packed", { true, sensor_msgs::image_encodings::BAYER_RGGB8 } },
+  { "BayerBG12Packed", { true, sensor_msgs::image_encodings::BAYER_BGGR8 } },
+  { "BayerGB12Packed", { true, sensor_msgs::image_encodings::BAYER_GBRG8 } },
+  { "BayerGR12Packed", { true, sensor_msgs::image_encodings::BAYER_GRBG8 } },
+};
+
+// two 12 bit values from 3 bytes
+//  12p (GenICam, LSB first)   byte 2 | byte 1 | byte 0 = BBBBBBBB BBBBAAAA AAAAAAAA
+//  12Packed (GigE Vision)     A = byte 0 << 4 | byte 1 low nibble, B = byte 2 << 4 | byte 1 high nibble
+inline void unpackPair(const uint8_t *from, const bool gige_packed, uint16_t &a, uint16_t &b)
+{
+  if (gige_packed)
+  {
+    a = (from[0] << 4) | (from[1] & 0x0F);
+    b = (from[2] << 4) | (from[1] >> 4);
+  }
+  else
+  {
+    a = from[0] | ((from[1] & 0x0F) << 8);
+    b = (from[1] >> 4) | (from[2] << 4);
+  }
+}
+
+} // end anonymous namespace
+
+ToneMapper::ToneMapper(const Parameters &parameters) :
+  parameters_(parameters), low_(parameters.low), high_(parameters.high)
+{
+  rebuild();
+}
+
+void ToneMapper::map(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (!in) {
+    ROS_WARN("camera_aravis::ToneMapper::map(): no input image given.");
+    return;
+  }
+
+  if (enc::bitDepth(in->encoding) == 8)
+  {
+    out = in;
+    return;
+  }
+
+  const std::string out_format = eightBitEncoding(in->encoding);
+
+  if (out_format.empty())
+  {
+    ROS_WARN_STREAM_ONCE("camera_aravis::ToneMapper::map(): can't tone map encoding " << in->encoding);
+    out.reset();
+    return;
+  }
+
+  if (!out)
+  {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::ToneMapper::map(): no output image given. Reserved a new one.");
+  }
+
+  const size_t row_values = in->width * enc::numChannels(in->encoding);
+
+  if (parameters_.auto_range)
+  {
+    Histogram histogram = {};
+    const uint16_t *values = reinterpret_cast<const uint16_t*>(in->data.data());
+    const size_t n_values = in->data.size() / sizeof(uint16_t);
+    for (size_t i = 0; i < n_values; i += HISTOGRAM_SAMPLE_STRIDE)
+      ++histogram[values[i] >> 8];
+    updateRange(histogram);
+  }
+
+  out->header = in->header;
+  out->height = in->height;
+  out->width = in->width;
+  out->is_bigendian = false;
+  out->step = row_values;
+  out->data.resize(out->height * out->step);
+
+  // 64 KiB table lookups, gather is no faster than scalar loads here, so parallelize over rows
+  const uint8_t *lut = lut_.data();
+  cv::parallel_for_(cv::Range(0, in->height), [&](const cv::Range &rows) {
+    for (int r = rows.start; r < rows.end; ++r)
+    {
+      const uint16_t *from = reinterpret_cast<const uint16_t*>(in->data.data() + r * in->step);
+      uint8_t *to = out->data.data() + r * out->step;
+      for (size_t i = 0; i < row_values; ++i)
+        to[i] = lut[from[i]];
+    }
+  });
+
+  out->encoding = out_format;
+}
+
+ConversionFunction ToneMapper::getFusedConversion(const std::string &pixel_format)
+{
+  const auto iter = FUSED_FORMATS.find(pixel_format);
+
+  if (iter == FUSED_FORMATS.end())
+    return ConversionFunction();
+
+  return std::bind(&ToneMapper::unpack12p, this, std::placeholders::_1, std::placeholders::_2,
+                   iter->second.gige_packed, iter->second.encoding);
+}
+
+void ToneMapper::unpack12p(sensor_msgs::ImagePtr& in, sensor_msgs::ImagePtr& out, const bool gige_packed,
+                           const std::string out_format)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  if (!in) {
+    ROS_WARN("camera_aravis::ToneMapper::unpack12p(): no input image given.");
+    return;
+  }
+
+  if (!out) {
+    out.reset(new sensor_msgs::Image);
+    ROS_INFO("camera_aravis::ToneMapper::unpack12p(): no output image given. Reserved a new one.");
+  }
+
+  // 2 values per 3 bytes, packed row is ceil(1.5 * values) bytes, in->step may add padding
+  const size_t row_values = size_t(in->width) * enc::numChannels(out_format);
+  const size_t row_pairs = row_values / 2;
+  const bool odd_tail = row_values % 2;
+  if (in->step < (3 * row_values + 1) / 2 || in->data.size() < size_t(in->height) * in->step) {
+    ROS_WARN_THROTTLE(10, "camera_aravis::ToneMapper::unpack12p(): image data is smaller than %ux%u %s.",
+                      in->width, in->height, out_format.c_str());
+    out.reset();
+    return;
+  }
+
+  if (parameters_.auto_range)
+  {
+    Histogram histogram = {};
+    uint16_t a, b;
+    for (size_t r = 0; r < in->height; ++r)
+    {
+      const uint8_t *row = in->data.data() + r * in->step;
+      for (size_t i = r % HISTOGRAM_SAMPLE_STRIDE; i < row_pairs; i += HISTOGRAM_SAMPLE_STRIDE)
+      {
+        unpackPair(row + 3 * i, gige_packed, a, b);
+        ++histogram[a >> 4];
+        ++histogram[b >> 4];
+      }
+    }
+    updateRange(histogram);
+  }
+
+  out->header = in->header;
+  out->height = in->height;
+  out->width = in->width;
+  out->is_bigendian = false;
+  out->step = row_values;
+  out->data.resize(out->height * out->step);
+
+  // unpacked 12 bit values index L1 resident table, no 16 bit intermediate
+  const uint8_t *lut = lut12_.data();
+  cv::parallel_for_(cv::Range(0, in->height), [&](const cv::Range &rows) {
+    for (int r = rows.start; r < rows.end; ++r)
+    {
+      const uint8_t *from = in->data.data() + r * in->step;
+      uint8_t *to = out->data.data() + r * out->step;
+      uint16_t a, b;
+      for (size_t i = 0; i < row_pairs; ++i, from += 3, to += 2)
+      {
+        unpackPair(from, gige_packed, a, b);
+        to[0] = lut[a];
+        to[1] = lut[b];
+      }
+      // odd value count ends with half pair of 2 bytes, first value needs only those
+      if (odd_tail)
+      {
+        a = gige_packed ? ((from[0] << 4) | (from[1] & 0x0F)) : (from[0] | ((from[1] & 0x0F) << 8));
+        to[0] = lut[a];
+      }
+    }
+  });
+
+  out->encoding = out_format;
+}
+
+void ToneMapper::updateRange(const Histogram &histogram)
+{
+  uint64_t n_samples = 0;
+  for (uint32_t count : histogram)
+    n_samples += count;
+
+  if (!n_samples)
+    return;
+
+  const uint64_t low_samples = parameters_.auto_low_percentile * n_samples;
+  const uint64_t high_samples = parameters_.auto_high_percentile * n_samples;
+
+  size_t low_bin = 0, high_bin = N_HISTOGRAM_BINS - 1;
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < N_HISTOGRAM_BINS; ++i)
+  {
+    cumulative += histogram[i];
+    if (cumulative <= low_samples)
+      low_bin = i + 1;
+    if (cumulative >= high_samples)
+    {
+      high_bin = i;
+      break;
+    }
+  }
+
+  const double low = double(std::min(low_bin, high_bin)) / N_HISTOGRAM_BINS;
+  const double high = double(high_bin + 1) / N_HISTOGRAM_BINS;
+
+  // rebuild only on change of at least histogram bin
+  const double tolerance = 0.5 / N_HISTOGRAM_BINS;
+  if (std::abs(low - low_) > tolerance || std::abs(high - high_) > tolerance)
+  {
+    low_ = low;
+    high_ = high;
+    rebuild();
+  }
+}
+
+void ToneMapper::rebuild()
+{
+  const double FULL_SCALE = 65535.0;
+  const double low = std::max(0.0, std::min(low_, 1.0)) * FULL_SCALE;
+  const double high = std::max(low_ + 1.0 / FULL_SCALE, std::min(high_, 1.0)) * FULL_SCALE;
+  const double inverse_gamma = parameters_.gamma > 0.0 ? 1.0 / parameters_.gamma : 1.0;
+
+  lut_.resize(65536);
+  for (size_t v = 0; v < lut_.size(); ++v)
+  {
+    double x = std::max(0.0, std::min((v - low) / (high - low), 1.0));
+    if (inverse_gamma != 1.0)
+      x = std::pow(x, inverse_gamma);
+    lut_[v] = static_cast<uint8_t>(x * 255.0 + 0.5);
+  }
+
+  // 12 bit values are MSB aligned in 16 bit
+  lut12_.resize(4096);
+  for (size_t v = 0; v < lut12_.size(); ++v)
+    lut12_[v] = lut_[v << 4];
+}
+
+} // end namespace camera_aravis
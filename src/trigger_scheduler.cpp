@@ -0,0 +1,154 @@
+/****************************************************************************
+ *
+ * camera_aravis
+ *
+ * Copyright © 2022 Fraunhofer IOSB and contributors
+ * Copyright © 2023 Extend Robotics Limited and contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+#include <camera_aravis/trigger_scheduler.h>
+
+#include <ros/ros.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cmath> //std::floor, std::llround
+#include <cstring> //strerror
+
+namespace camera_aravis
+{
+
+TriggerScheduler::TriggerScheduler(double rate_hz, uint64_t spin_ns, int priority, TickCallback on_tick) :
+    spin_ns_(spin_ns), priority_(priority), on_tick_(on_tick), period_ns_(1e9 / rate_hz)
+{
+}
+
+TriggerScheduler::~TriggerScheduler()
+{
+  stop();
+}
+
+void TriggerScheduler::start()
+{
+  active_ = true;
+  thread_ = std::thread(&TriggerScheduler::threadMain, this);
+}
+
+void TriggerScheduler::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    active_ = false;
+  }
+  wake_.notify_all();
+
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void TriggerScheduler::setRate(double rate_hz)
+{
+  period_ns_ = 1e9 / rate_hz;
+}
+
+TriggerSchedulerStatisticsSample TriggerScheduler::sample()
+{
+  TriggerSchedulerStatisticsSample sample;
+  sample.n_fired = n_fired_;
+  sample.n_skipped = n_skipped_;
+
+  std::lock_guard<std::mutex> lock(lateness_mutex_);
+  sample.lateness_p50_ns = lateness_.percentile(0.5);
+  sample.lateness_p99_ns = lateness_.percentile(0.99);
+  sample.lateness_max_ns = lateness_.max();
+  lateness_.reset();
+  return sample;
+}
+
+bool TriggerScheduler::waitUntil(Clock::time_point deadline)
+{
+  // sleep is interrupted by stop, low rates would block it for a whole period otherwise
+  {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    if (wake_.wait_until(lock, deadline - std::chrono::nanoseconds(spin_ns_), [this] { return !active_; }))
+      return false;
+  }
+
+  while (Clock::now() < deadline)
+    if (!active_)
+      return false;
+
+  return true;
+}
+
+void TriggerScheduler::threadMain()
+{
+  if (priority_ > 0)
+  {
+    sched_param param;
+    param.sched_priority = priority_;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0)
+      ROS_WARN("Could not set trigger thread priority %d (needs rtprio limit or CAP_SYS_NICE): %s",
+               priority_, strerror(error));
+  }
+
+  double period_ns = period_ns_;
+  Clock::time_point origin = Clock::now();
+  Clock::time_point deadline = origin;
+  uint64_t tick = 0;
+
+  while (active_)
+  {
+    // rate change restarts the grid at the last deadline
+    const double requested_period_ns = period_ns_;
+    if (requested_period_ns != period_ns)
+    {
+      period_ns = requested_period_ns;
+      origin = deadline;
+      tick = 0;
+    }
+
+    deadline = origin + std::chrono::nanoseconds(std::llround(++tick * period_ns));
+    if (!waitUntil(deadline))
+      break;
+
+    const Clock::time_point now = Clock::now();
+    const double late_ns = std::chrono::duration<double, std::nano>(now - deadline).count();
+    if (late_ns >= period_ns)
+    {
+      // fire the latest missed tick, drop the ones before it
+      const uint64_t missed = uint64_t(std::floor(late_ns / period_ns));
+      tick += missed;
+      n_skipped_ += missed;
+      deadline = origin + std::chrono::nanoseconds(std::llround(tick * period_ns));
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(lateness_mutex_);
+      lateness_.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+    }
+
+    on_tick_();
+    n_fired_++;
+  }
+}
+
+} // end namespace camera_aravis